@@ -49,6 +49,7 @@ const PegInfo pegs[]
 {
     { "bad checksum (ip4)", "nonzero tcp over ip checksums" },
     { "bad checksum (ip6)", "nonzero tcp over ipv6 checksums" },
+    { "offloaded checksum", "tcp checksums verified by hardware" },
     { nullptr, nullptr }
 };
 
@@ -56,6 +57,7 @@ struct Stats
 {
     PegCount bad_ip4_cksum;
     PegCount bad_ip6_cksum;
+    PegCount offloaded_cksum;
 };
 
 static THREAD_LOCAL Stats stats;
@@ -166,7 +168,15 @@ bool TcpCodec::decode(const RawData& raw, CodecData& codec, DecodeData& snort)
     /* Checksum code moved in front of the other decoder alerts.
        If it's a bad checksum (maybe due to encrypted ESP traffic), the other
        alerts could be false positives. */
-    if ( SnortConfig::tcp_checksums() )
+    bool verify = SnortConfig::tcp_checksums();
+
+    if ( verify and SnortConfig::tcp_checksum_offloaded(raw.pkth) )
+    {
+        stats.offloaded_cksum++;
+        verify = false;
+    }
+
+    if ( verify )
     {
         uint16_t csum;
         PegCount* bad_cksum_cnt;
@@ -22,8 +22,14 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <cstddef>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CKSUM_X86
+#include <immintrin.h>
+#endif
+
 #include <protocols/protocol_ids.h>
 
 namespace checksum
@@ -89,84 +95,158 @@ struct Psuedoheader6Union
     };
 };
 
-inline uint16_t cksum_add(const uint16_t* buf, std::size_t len, uint32_t cksum)
+/*
+ *  The data is summed in a 64 bit accumulator, 4 bytes at a time or 16 / 32
+ *  bytes at a time with SSE2 / AVX2 when the CPU has it, and then folded.
+ *  Summing wider words gives the same one's complement result as summing
+ *  16 bit words since 2^16 == 1 mod 2^16-1.  The vector kernels widen 16 bit
+ *  words into 32 bit lanes which are flushed to 64 bits well before they
+ *  can overflow.  The kernel is selected at runtime on first use.
+ */
+inline uint64_t sum_scalar(const uint8_t* p, std::size_t len, uint64_t sum)
+{
+    while ( len >= 8 )
+    {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        sum += (uint32_t)w;
+        sum += w >> 32;
+        p += 8;
+        len -= 8;
+    }
+
+    if ( len >= 4 )
+    {
+        uint32_t w;
+        memcpy(&w, p, sizeof(w));
+        sum += w;
+        p += 4;
+        len -= 4;
+    }
+
+    if ( len >= 2 )
+    {
+        uint16_t w;
+        memcpy(&w, p, sizeof(w));
+        sum += w;
+        p += 2;
+        len -= 2;
+    }
+
+    if ( len )
+        sum += *p;
+
+    return sum;
+}
+
+#ifdef CKSUM_X86
+// 32 bit lanes get 2 words per block so this many blocks can't overflow
+#define CKSUM_MAX_BLOCKS 16384
+
+__attribute__((target("sse2")))
+inline uint64_t sum_sse2(const uint8_t* p, std::size_t len, uint64_t sum)
 {
-    const uint16_t* sp = buf;
-    std::size_t n, sn;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
 
-    if (len > 1 )
+    while ( len >= 16 )
     {
-        sn = ((len / 2) & 0xF);  // == len/2 % 16
-        n = (((len / 2) + 15) / 16);   // ceiling of (len / 2) / 16
+        std::size_t n = len / 16;
 
-        switch (sn)
+        if ( n > CKSUM_MAX_BLOCKS )
+            n = CKSUM_MAX_BLOCKS;
+
+        __m128i a = zero;
+        len -= n * 16;
+
+        while ( n-- )
         {
-        case 0:
-            sn = 16;
-            cksum += sp[15];
-        case 15:
-            cksum += sp[14];
-        case 14:
-            cksum += sp[13];
-        case 13:
-            cksum += sp[12];
-        case 12:
-            cksum += sp[11];
-        case 11:
-            cksum += sp[10];
-        case 10:
-            cksum += sp[9];
-        case 9:
-            cksum += sp[8];
-        case 8:
-            cksum  += sp[7];
-        case 7:
-            cksum += sp[6];
-        case 6:
-            cksum += sp[5];
-        case 5:
-            cksum += sp[4];
-        case 4:
-            cksum += sp[3];
-        case 3:
-            cksum += sp[2];
-        case 2:
-            cksum += sp[1];
-        case 1:
-            cksum += sp[0];
+            __m128i x = _mm_loadu_si128((const __m128i*)p);
+            a = _mm_add_epi32(a, _mm_unpacklo_epi16(x, zero));
+            a = _mm_add_epi32(a, _mm_unpackhi_epi16(x, zero));
+            p += 16;
         }
-        sp += sn;
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(a, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(a, zero));
+    }
+
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, acc);
+
+    return sum_scalar(p, len, sum + lanes[0] + lanes[1]);
+}
 
-        /* XXX - unroll loop using Duff's device. */
-        while (--n > 0)
+__attribute__((target("avx2")))
+inline uint64_t sum_avx2(const uint8_t* p, std::size_t len, uint64_t sum)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+
+    while ( len >= 32 )
+    {
+        std::size_t n = len / 32;
+
+        if ( n > CKSUM_MAX_BLOCKS )
+            n = CKSUM_MAX_BLOCKS;
+
+        __m256i a = zero;
+        len -= n * 32;
+
+        while ( n-- )
         {
-            cksum += sp[0];
-            cksum += sp[1];
-            cksum += sp[2];
-            cksum += sp[3];
-            cksum += sp[4];
-            cksum += sp[5];
-            cksum += sp[6];
-            cksum += sp[7];
-            cksum += sp[8];
-            cksum += sp[9];
-            cksum += sp[10];
-            cksum += sp[11];
-            cksum += sp[12];
-            cksum += sp[13];
-            cksum += sp[14];
-            cksum += sp[15];
-            sp += 16;
+            __m256i x = _mm256_loadu_si256((const __m256i*)p);
+            a = _mm256_add_epi32(a, _mm256_unpacklo_epi16(x, zero));
+            a = _mm256_add_epi32(a, _mm256_unpackhi_epi16(x, zero));
+            p += 32;
         }
+        acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(a, zero));
+        acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(a, zero));
     }
 
-    if (len & 1)
-        cksum += (*(unsigned char*)sp);
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, acc);
 
-    cksum  = (cksum >> 16) + (cksum & 0x0000ffff);
-    cksum += (cksum >> 16);
+    return sum_scalar(p, len, sum + lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+#endif
+
+typedef uint64_t (* SumFunc)(const uint8_t*, std::size_t, uint64_t);
+
+inline SumFunc select_sum()
+{
+#ifdef CKSUM_X86
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports("avx2") )
+        return sum_avx2;
 
-    return (uint16_t)(~cksum);
+    if ( __builtin_cpu_supports("sse2") )
+        return sum_sse2;
+#endif
+    return sum_scalar;
+}
+
+inline uint64_t sum_words(const uint8_t* p, std::size_t len, uint64_t sum)
+{
+    // headers are too short to pay for the call
+    if ( len < 64 )
+        return sum_scalar(p, len, sum);
+
+    static const SumFunc sum_func = select_sum();
+    return sum_func(p, len, sum);
+}
+
+inline uint16_t fold_cksum(uint64_t sum)
+{
+    while ( sum >> 16 )
+        sum = (sum & 0xffff) + (sum >> 16);
+
+    return (uint16_t)(~sum);
+}
+
+inline uint16_t cksum_add(const uint16_t* buf, std::size_t len, uint32_t cksum)
+{
+    return fold_cksum(sum_words((const uint8_t*)buf, len, cksum));
 }
 
 inline void add_ipv4_pseudoheader(const Pseudoheader* const ph4,
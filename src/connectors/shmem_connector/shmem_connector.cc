@@ -0,0 +1,361 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "shmem_connector.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "shmem_connector_module.h"
+#include "log/messages.h"
+#include "main/snort_debug.h"
+#include "main/thread.h"
+#include "profiler/profiler.h"
+#include "utils/util.h"
+
+THREAD_LOCAL ShmemConnectorStats shmem_connector_stats;
+THREAD_LOCAL ProfileStats shmem_connector_perfstats;
+
+// while the peer hasn't set up the ring, only try to attach this often
+#define ATTACH_INTERVAL 1024
+
+ShmemConnectorCommon::ShmemConnectorCommon(
+    ShmemConnectorConfig::ShmemConnectorConfigSet* conf)
+{
+    config_set = (ConnectorConfig::ConfigSet*)conf;
+}
+
+ShmemConnectorCommon::~ShmemConnectorCommon()
+{
+    for ( auto conf : *config_set )
+        delete conf;
+
+    config_set->clear();
+    delete config_set;
+}
+
+ShmemConnector::ShmemConnector(ShmemConnectorConfig* cfg, const std::string& name) :
+    shm_name(name)
+{
+    config = cfg;
+    ring = nullptr;
+    map = nullptr;
+    map_size = 0;
+    created = false;
+    retry = 0;
+}
+
+ShmemConnector::~ShmemConnector()
+{
+    for ( auto* h : free_handles )
+        delete h;
+
+    delete ring;
+
+    if ( map )
+        munmap(map, map_size);
+
+    // the peer keeps its mapping; this just lets the next run start clean
+    if ( created )
+        shm_unlink(shm_name.c_str());
+}
+
+// whoever gets here first creates and initializes the ring; the other
+// side maps it once it is valid.
+bool ShmemConnector::attach()
+{
+    const ShmemConnectorConfig* cfg = (const ShmemConnectorConfig*)config;
+    size_t len = ShmemRing::footprint(cfg->size);
+
+    int fd = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+    if ( fd >= 0 )
+    {
+        if ( ftruncate(fd, len) )
+        {
+            ErrorMessage("shmem_connector: can't size %s: %s\n",
+                shm_name.c_str(), get_error(errno));
+            close(fd);
+            shm_unlink(shm_name.c_str());
+            return false;
+        }
+        created = true;
+    }
+    else if ( errno == EEXIST )
+    {
+        fd = shm_open(shm_name.c_str(), O_RDWR, 0);
+
+        if ( fd < 0 )
+            return false;
+
+        // use the size chosen by the creator
+        struct stat st;
+
+        if ( fstat(fd, &st) or (size_t)st.st_size < sizeof(ShmemRingHdr) )
+        {
+            close(fd);
+            return false;
+        }
+        len = st.st_size;
+    }
+    else
+    {
+        ErrorMessage("shmem_connector: can't open %s: %s\n",
+            shm_name.c_str(), get_error(errno));
+        return false;
+    }
+
+    void* mem = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if ( mem == MAP_FAILED )
+        return false;
+
+    if ( created )
+        ShmemRing::init(mem, cfg->size);
+
+    else if ( !ShmemRing::valid(mem, len) )
+    {
+        munmap(mem, len);
+        return false;
+    }
+
+    map = mem;
+    map_size = len;
+    ring = new ShmemRing(mem);
+
+    DebugFormat(DEBUG_CONNECTORS, "shmem_connector: attached %s (%zu bytes)\n",
+        shm_name.c_str(), len);
+
+    return true;
+}
+
+bool ShmemConnector::ready()
+{
+    if ( ring )
+        return true;
+
+    if ( ++retry < ATTACH_INTERVAL )
+        return false;
+
+    retry = 0;
+    return attach();
+}
+
+ShmemConnectorMsgHandle* ShmemConnector::get_handle()
+{
+    if ( free_handles.empty() )
+        return new ShmemConnectorMsgHandle;
+
+    ShmemConnectorMsgHandle* h = free_handles.back();
+    free_handles.pop_back();
+    return h;
+}
+
+void ShmemConnector::put_handle(ShmemConnectorMsgHandle* h)
+{
+    if ( h->on_heap )
+        delete[] h->connector_msg.data;
+
+    free_handles.push_back(h);
+}
+
+// the message is built in place in the ring when there is room.
+// otherwise it goes on the heap and is copied in on transmit.
+ConnectorMsgHandle* ShmemConnector::alloc_message(const uint32_t length, const uint8_t** data)
+{
+    ShmemConnectorMsgHandle* h = get_handle();
+    uint8_t* buf = ready() ? ring->reserve(length) : nullptr;
+
+    if ( buf )
+        h->on_heap = false;
+
+    else
+    {
+        buf = new uint8_t[length];
+        h->on_heap = true;
+        shmem_connector_stats.overflows++;
+    }
+
+    h->connector_msg.data = buf;
+    h->connector_msg.length = length;
+    h->end = 0;
+
+    *data = buf;
+    return h;
+}
+
+void ShmemConnector::discard_message(ConnectorMsgHandle* handle)
+{
+    ShmemConnectorMsgHandle* h = (ShmemConnectorMsgHandle*)handle;
+
+    if ( !h->on_heap )
+    {
+        if ( get_connector_direction() == CONN_TRANSMIT )
+            ring->cancel();
+        else
+            ring->release(h->end);
+    }
+    put_handle(h);
+}
+
+bool ShmemConnector::transmit_message(ConnectorMsgHandle* handle)
+{
+    ShmemConnectorMsgHandle* h = (ShmemConnectorMsgHandle*)handle;
+    bool ok = true;
+
+    if ( !h->on_heap )
+        ring->commit();
+
+    else
+    {
+        uint8_t* buf = ready() ? ring->reserve(h->connector_msg.length) : nullptr;
+
+        if ( buf )
+        {
+            memcpy(buf, h->connector_msg.data, h->connector_msg.length);
+            ring->commit();
+        }
+        else
+            ok = false;
+    }
+
+    if ( ok )
+        shmem_connector_stats.transmitted++;
+    else
+        shmem_connector_stats.dropped++;
+
+    put_handle(h);
+    return ok;
+}
+
+// the message data stays in the ring until the handle is discarded.
+// like the file connector this never blocks.
+ConnectorMsgHandle* ShmemConnector::receive_message(bool)
+{
+    if ( !ready() )
+        return nullptr;
+
+    uint32_t length;
+    uint64_t end;
+    const uint8_t* buf = ring->read(length, end);
+
+    if ( !buf )
+        return nullptr;
+
+    ShmemConnectorMsgHandle* h = get_handle();
+    h->connector_msg.data = (uint8_t*)buf;
+    h->connector_msg.length = length;
+    h->end = end;
+    h->on_heap = false;
+
+    shmem_connector_stats.received++;
+    return h;
+}
+
+//-------------------------------------------------------------------------
+// api stuff
+//-------------------------------------------------------------------------
+
+static Module* mod_ctor()
+{ return new ShmemConnectorModule; }
+
+static void mod_dtor(Module* m)
+{ delete m; }
+
+// each packet thread gets its own ring so there is only one producer
+static Connector* shmem_connector_tinit(ConnectorConfig* config)
+{
+    ShmemConnectorConfig* cfg = (ShmemConnectorConfig*)config;
+
+    if ( cfg->direction != Connector::CONN_TRANSMIT and
+        cfg->direction != Connector::CONN_RECEIVE )
+        return nullptr;
+
+    std::string name = "/snort.";
+    name += cfg->name;
+    name += ".";
+    name += std::to_string(get_instance_id());
+
+    ShmemConnector* shmem_connector = new ShmemConnector(cfg, name);
+
+    if ( !shmem_connector->attach() )
+        ErrorMessage("shmem_connector: %s is not ready, will retry\n", name.c_str());
+
+    return shmem_connector;
+}
+
+static void shmem_connector_tterm(Connector* connector)
+{
+    ShmemConnector* shmem_connector = (ShmemConnector*)connector;
+    delete shmem_connector;
+}
+
+static ConnectorCommon* shmem_connector_ctor(Module* m)
+{
+    ShmemConnectorModule* mod = (ShmemConnectorModule*)m;
+    return new ShmemConnectorCommon(mod->get_and_clear_config());
+}
+
+static void shmem_connector_dtor(ConnectorCommon* c)
+{
+    ShmemConnectorCommon* sc = (ShmemConnectorCommon*)c;
+    delete sc;
+}
+
+const ConnectorApi shmem_connector_api =
+{
+    {
+        PT_CONNECTOR,
+        sizeof(ConnectorApi),
+        CONNECTOR_API_VERSION,
+        0,
+        API_RESERVED,
+        API_OPTIONS,
+        SHMEM_CONNECTOR_NAME,
+        SHMEM_CONNECTOR_HELP,
+        mod_ctor,
+        mod_dtor
+    },
+    0,
+    nullptr,
+    nullptr,
+    shmem_connector_tinit,
+    shmem_connector_tterm,
+    shmem_connector_ctor,
+    shmem_connector_dtor
+};
+
+#ifdef BUILDING_SO
+SO_PUBLIC const BaseApi* snort_plugins[] =
+{
+    &shmem_connector_api.base,
+    nullptr
+};
+#else
+const BaseApi* shmem_connector = &shmem_connector_api.base;
+#endif
+
@@ -0,0 +1,85 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef SHMEM_CONNECTOR_H
+#define SHMEM_CONNECTOR_H
+
+#include <string>
+#include <vector>
+
+#include "shmem_connector_config.h"
+#include "shmem_ring.h"
+#include "framework/connector.h"
+
+//-------------------------------------------------------------------------
+// class stuff
+//-------------------------------------------------------------------------
+
+class ShmemConnectorMsgHandle : public ConnectorMsgHandle
+{
+public:
+    ConnectorMsg connector_msg;
+    uint64_t end;       // ring position released on discard
+    bool on_heap;       // data is a copy because the ring was full
+};
+
+class ShmemConnectorCommon : public ConnectorCommon
+{
+public:
+    ShmemConnectorCommon(ShmemConnectorConfig::ShmemConnectorConfigSet*);
+    ~ShmemConnectorCommon();
+};
+
+class ShmemConnector : public Connector
+{
+public:
+    ShmemConnector(ShmemConnectorConfig*, const std::string& shm_name);
+    ~ShmemConnector();
+
+    ConnectorMsgHandle* alloc_message(const uint32_t, const uint8_t**) override;
+    void discard_message(ConnectorMsgHandle*) override;
+    bool transmit_message(ConnectorMsgHandle*) override;
+    ConnectorMsgHandle* receive_message(bool) override;
+
+    ConnectorMsg* get_connector_msg(ConnectorMsgHandle* handle) override
+    { return &((ShmemConnectorMsgHandle*)handle)->connector_msg; }
+
+    Direction get_connector_direction() override
+    { return ((const ShmemConnectorConfig*)config)->direction; }
+
+    bool attach();
+
+private:
+    bool ready();
+    ShmemConnectorMsgHandle* get_handle();
+    void put_handle(ShmemConnectorMsgHandle*);
+
+private:
+    std::string shm_name;
+    ShmemRing* ring;
+
+    void* map;
+    size_t map_size;
+    bool created;
+    unsigned retry;
+
+    std::vector<ShmemConnectorMsgHandle*> free_handles;
+};
+
+#endif
+
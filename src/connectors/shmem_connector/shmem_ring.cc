@@ -0,0 +1,175 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "shmem_ring.h"
+
+#include <assert.h>
+#include <string.h>
+
+#define SHMEM_RING_MAGIC   0x534E5247  // "SNRG"
+#define SHMEM_RING_VERSION 1
+
+// marks the unused end of the ring when a message starts over at zero
+static const uint32_t wrap_len = 0xFFFFFFFF;
+
+uint32_t ShmemRing::ring_size(uint32_t size)
+{
+    uint32_t n = 4096;
+
+    while ( n < size and n < 0x80000000 )
+        n <<= 1;
+
+    return n;
+}
+
+void ShmemRing::init(void* mem, uint32_t size)
+{
+    ShmemRingHdr* hdr = (ShmemRingHdr*)mem;
+
+    hdr->version = SHMEM_RING_VERSION;
+    hdr->size = ring_size(size);
+    hdr->reserved = 0;
+    hdr->head.store(0, std::memory_order_relaxed);
+    hdr->tail.store(0, std::memory_order_relaxed);
+
+    // the other side may be polling for this
+    hdr->magic.store(SHMEM_RING_MAGIC, std::memory_order_release);
+}
+
+bool ShmemRing::valid(const void* mem, size_t len)
+{
+    const ShmemRingHdr* hdr = (const ShmemRingHdr*)mem;
+
+    if ( len < sizeof(*hdr) )
+        return false;
+
+    if ( hdr->magic.load(std::memory_order_acquire) != SHMEM_RING_MAGIC )
+        return false;
+
+    if ( hdr->version != SHMEM_RING_VERSION )
+        return false;
+
+    if ( hdr->size != ring_size(hdr->size) )
+        return false;
+
+    return len >= footprint(hdr->size);
+}
+
+ShmemRing::ShmemRing(void* mem)
+{
+    assert(valid(mem, footprint(((ShmemRingHdr*)mem)->size)));
+
+    hdr = (ShmemRingHdr*)mem;
+    data = (uint8_t*)mem + sizeof(*hdr);
+    size = hdr->size;
+    mask = size - 1;
+
+    pending = 0;
+    pending_len = 0;
+    reserved = false;
+
+    // pick up where the last user left off
+    cursor = hdr->tail.load(std::memory_order_acquire);
+}
+
+//-------------------------------------------------------------------------
+// producer
+//-------------------------------------------------------------------------
+
+uint8_t* ShmemRing::reserve(uint32_t len)
+{
+    if ( reserved or len > get_max_message() )
+        return nullptr;
+
+    uint64_t head = hdr->head.load(std::memory_order_relaxed);
+    uint64_t tail = hdr->tail.load(std::memory_order_acquire);
+
+    uint32_t pos = head & mask;
+    uint32_t need = rec_size + pad(len);
+    uint32_t skip = (size - pos < need) ? size - pos : 0;
+
+    if ( skip + need > size - (head - tail) )
+        return nullptr;
+
+    // the wrap record isn't visible until commit moves the head past it
+    if ( skip )
+        memcpy(data + pos, &wrap_len, sizeof(wrap_len));
+
+    pending = head + skip;
+    pending_len = len;
+    reserved = true;
+
+    return data + (pending & mask) + rec_size;
+}
+
+void ShmemRing::commit()
+{
+    assert(reserved);
+
+    memcpy(data + (pending & mask), &pending_len, sizeof(pending_len));
+    hdr->head.store(pending + rec_size + pad(pending_len), std::memory_order_release);
+
+    reserved = false;
+}
+
+void ShmemRing::cancel()
+{
+    reserved = false;
+}
+
+//-------------------------------------------------------------------------
+// consumer
+//-------------------------------------------------------------------------
+
+const uint8_t* ShmemRing::read(uint32_t& len, uint64_t& end)
+{
+    uint64_t head = hdr->head.load(std::memory_order_acquire);
+
+    while ( cursor != head )
+    {
+        uint32_t pos = cursor & mask;
+        memcpy(&len, data + pos, sizeof(len));
+
+        if ( len == wrap_len )
+        {
+            cursor += size - pos;
+            continue;
+        }
+
+        // the other side is another process so don't trust it
+        if ( len > size - pos - rec_size )
+            return nullptr;
+
+        end = cursor + rec_size + pad(len);
+        cursor = end;
+
+        return data + pos + rec_size;
+    }
+    return nullptr;
+}
+
+void ShmemRing::release(uint64_t end)
+{
+    if ( end > hdr->tail.load(std::memory_order_relaxed) )
+        hdr->tail.store(end, std::memory_order_release);
+}
+
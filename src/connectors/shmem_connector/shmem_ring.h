@@ -0,0 +1,97 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef SHMEM_RING_H
+#define SHMEM_RING_H
+
+// ShmemRing is a single producer, single consumer ring of variable length
+// messages in memory that may be shared with another process.  The
+// producer and consumer each own one free running cursor in the header
+// and only read the other, so neither side needs a lock or a syscall.
+//
+// Each message is an 8 byte record header holding the length followed by
+// the data padded to 8 bytes.  A message never wraps; if it doesn't fit at
+// the end of the ring a wrap record is written and it starts over at zero.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared cursors must be lock free");
+
+struct ShmemRingHdr
+{
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t size;      // bytes of data, a power of 2
+    uint32_t reserved;
+
+    alignas(64) std::atomic<uint64_t> head;  // written by the producer
+    alignas(64) std::atomic<uint64_t> tail;  // written by the consumer
+};
+
+class ShmemRing
+{
+public:
+    // size is rounded up to a power of 2
+    static uint32_t ring_size(uint32_t size);
+    static size_t footprint(uint32_t size)
+    { return sizeof(ShmemRingHdr) + ring_size(size); }
+
+    // init is done once by whoever creates the memory
+    static void init(void*, uint32_t size);
+    static bool valid(const void*, size_t len);
+
+    ShmemRing(void*);
+
+    // producer
+    // at most one reservation may be outstanding
+    uint8_t* reserve(uint32_t len);
+    void commit();
+    void cancel();
+
+    // consumer
+    // messages must be released in the order read; end is where the next
+    // message starts and releasing it frees this one and any before it
+    const uint8_t* read(uint32_t& len, uint64_t& end);
+    void release(uint64_t end);
+
+    uint32_t get_max_message() const
+    { return size - rec_size; }
+
+private:
+    static const uint32_t rec_size = 8;
+
+    static uint32_t pad(uint32_t len)
+    { return (len + 7) & ~7u; }
+
+private:
+    ShmemRingHdr* hdr;
+    uint8_t* data;
+    uint32_t size;
+    uint32_t mask;
+
+    uint64_t pending;       // start of reserved record
+    uint32_t pending_len;
+    bool reserved;
+
+    uint64_t cursor;        // next record to read
+};
+
+#endif
+
@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// shmem_ring_test.cc
+// unit test main
+
+#include "connectors/shmem_connector/shmem_ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+TEST_GROUP(shmem_ring)
+{
+    void* mem;
+
+    void setup()
+    {
+        size_t len = ShmemRing::footprint(4096);
+        mem = aligned_alloc(64, len);
+        memset(mem, 0, len);
+        ShmemRing::init(mem, 4096);
+    }
+
+    void teardown()
+    {
+        free(mem);
+    }
+};
+
+TEST(shmem_ring, size)
+{
+    CHECK(ShmemRing::ring_size(1) == 4096);
+    CHECK(ShmemRing::ring_size(5000) == 8192);
+    CHECK(ShmemRing::valid(mem, ShmemRing::footprint(4096)));
+    CHECK(!ShmemRing::valid(mem, ShmemRing::footprint(4096) - 1));
+}
+
+TEST(shmem_ring, transmit_receive)
+{
+    ShmemRing tx(mem);
+    ShmemRing rx(mem);
+    uint32_t len;
+    uint64_t end;
+
+    CHECK(rx.read(len, end) == nullptr);
+
+    uint8_t* p = tx.reserve(5);
+    CHECK(p != nullptr);
+    memcpy(p, "hello", 5);
+
+    // not visible until committed and only one reservation at a time
+    CHECK(rx.read(len, end) == nullptr);
+    CHECK(tx.reserve(5) == nullptr);
+    tx.commit();
+
+    const uint8_t* q = rx.read(len, end);
+    CHECK(q != nullptr);
+    CHECK(len == 5);
+    CHECK(!memcmp(q, "hello", 5));
+    CHECK(end == 16);
+    CHECK(rx.read(len, end) == nullptr);
+    rx.release(end);
+
+    p = tx.reserve(3);
+    tx.cancel();
+    CHECK(rx.read(len, end) == nullptr);
+}
+
+TEST(shmem_ring, full_and_wrap)
+{
+    ShmemRing tx(mem);
+    ShmemRing rx(mem);
+    uint32_t len;
+    uint64_t end;
+
+    CHECK(tx.reserve(tx.get_max_message() + 1) == nullptr);
+
+    // 3 x 1024 byte records leave 1024 at the end
+    for ( int i = 0; i < 3; ++i )
+    {
+        uint8_t* p = tx.reserve(1016);
+        CHECK(p != nullptr);
+        memset(p, i, 1016);
+        tx.commit();
+    }
+
+    // doesn't fit at the end and nothing released yet
+    CHECK(tx.reserve(2000) == nullptr);
+
+    CHECK(rx.read(len, end) != nullptr);
+    CHECK(rx.read(len, end) != nullptr);
+    rx.release(end);
+
+    // wraps to the start
+    uint8_t* p = tx.reserve(2000);
+    CHECK(p != nullptr);
+    memset(p, 9, 2000);
+    tx.commit();
+
+    const uint8_t* q = rx.read(len, end);
+    CHECK(q != nullptr);
+    CHECK(len == 1016 and q[0] == 2);
+
+    q = rx.read(len, end);
+    CHECK(q != nullptr);
+    CHECK(len == 2000 and q[0] == 9 and q[1999] == 9);
+    CHECK(end == 4096 + 2008);
+    rx.release(end);
+
+    CHECK(rx.read(len, end) == nullptr);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
@@ -0,0 +1,612 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "tcp_connector.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include "tcp_connector_module.h"
+#include "log/messages.h"
+#include "main/snort_debug.h"
+#include "main/thread.h"
+#include "profiler/profiler.h"
+
+THREAD_LOCAL TcpConnectorStats tcp_connector_stats;
+THREAD_LOCAL ProfileStats tcp_connector_perfstats;
+
+// the I/O thread checks for stop at least this often
+static const int POLL_MS = 100;
+
+// time allowed for connect and accept, and between connect attempts
+static const int RETRY_MS = 1000;
+
+// larger frames mean the stream is garbage
+static const uint32_t MAX_MESSAGE = 1 << 24;
+
+TcpConnectorMsgHdr::TcpConnectorMsgHdr(uint32_t length)
+{
+    version = htons(TCP_FORMAT_VERSION);
+    connector_msg_length = htonl(length);
+}
+
+uint16_t TcpConnectorMsgHdr::get_version() const
+{ return ntohs(version); }
+
+uint32_t TcpConnectorMsgHdr::get_length() const
+{ return ntohl(connector_msg_length); }
+
+TcpConnectorMsgHandle::TcpConnectorMsgHandle(const uint32_t length)
+{
+    connector_msg.length = length;
+    connector_msg.data = new uint8_t[length];
+}
+
+TcpConnectorMsgHandle::~TcpConnectorMsgHandle()
+{
+    delete[] connector_msg.data;
+}
+
+TcpConnectorCommon::TcpConnectorCommon(TcpConnectorConfig::TcpConnectorConfigSet* conf)
+{
+    config_set = (ConnectorConfig::ConfigSet*)conf;
+}
+
+TcpConnectorCommon::~TcpConnectorCommon()
+{
+    for ( auto conf : *config_set )
+        delete conf;
+
+    config_set->clear();
+    delete config_set;
+}
+
+//-------------------------------------------------------------------------
+// packet thread
+//-------------------------------------------------------------------------
+
+TcpConnector::TcpConnector(TcpConnectorConfig* cfg, unsigned instance)
+{
+    config = cfg;
+    sock = listener = -1;
+    queue_limit = cfg->queue_limit;
+    thread = nullptr;
+    done = false;
+    io_idle = false;
+    connects = 0;
+    receive_drops = 0;
+
+    memset(&addr, 0, sizeof(addr));
+    addr_len = 0;
+
+    if ( !cfg->path.empty() )
+    {
+        struct sockaddr_un* sun = (struct sockaddr_un*)&addr;
+        peer = cfg->path + "." + std::to_string(instance);
+
+        if ( peer.size() < sizeof(sun->sun_path) )
+        {
+            sun->sun_family = AF_UNIX;
+            strcpy(sun->sun_path, peer.c_str());
+            addr_len = sizeof(*sun);
+        }
+        return;
+    }
+
+    uint16_t port = cfg->port + instance;
+    peer = cfg->address + ":" + std::to_string(port);
+
+    struct sockaddr_in* sin = (struct sockaddr_in*)&addr;
+    struct sockaddr_in6* sin6 = (struct sockaddr_in6*)&addr;
+
+    if ( inet_pton(AF_INET, cfg->address.c_str(), &sin->sin_addr) == 1 )
+    {
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons(port);
+        addr_len = sizeof(*sin);
+    }
+    else if ( inet_pton(AF_INET6, cfg->address.c_str(), &sin6->sin6_addr) == 1 )
+    {
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons(port);
+        addr_len = sizeof(*sin6);
+    }
+}
+
+TcpConnector::~TcpConnector()
+{
+    stop();
+
+    for ( auto* h : queue )
+        delete h;
+}
+
+void TcpConnector::start()
+{
+    if ( !addr_len )
+    {
+        ErrorMessage("%s: bad address %s\n", TCP_CONNECTOR_NAME, peer.c_str());
+        return;
+    }
+    thread = new std::thread(&TcpConnector::io_loop, this);
+}
+
+void TcpConnector::stop()
+{
+    if ( !thread )
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    cv.notify_one();
+    thread->join();
+
+    delete thread;
+    thread = nullptr;
+}
+
+// the I/O thread's counters are moved here when the packet thread is idle
+void TcpConnector::update_stats()
+{
+    tcp_connector_stats.connects += connects.exchange(0);
+    tcp_connector_stats.dropped += receive_drops.exchange(0);
+}
+
+ConnectorMsgHandle* TcpConnector::alloc_message(const uint32_t length, const uint8_t** data)
+{
+    TcpConnectorMsgHandle* h = new TcpConnectorMsgHandle(length);
+    *data = (uint8_t*)h->connector_msg.data;
+    return h;
+}
+
+void TcpConnector::discard_message(ConnectorMsgHandle* msg)
+{
+    delete (TcpConnectorMsgHandle*)msg;
+}
+
+// messages are queued while disconnected and dropped when the queue is full
+bool TcpConnector::transmit_message(ConnectorMsgHandle* msg)
+{
+    TcpConnectorMsgHandle* h = (TcpConnectorMsgHandle*)msg;
+    size_t depth;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if ( queue.size() >= queue_limit )
+            depth = 0;
+        else
+        {
+            queue.push_back(h);
+            depth = queue.size();
+        }
+    }
+
+    if ( !depth )
+    {
+        tcp_connector_stats.dropped++;
+        delete h;
+        return false;
+    }
+
+    if ( io_idle )
+        cv.notify_one();
+
+    tcp_connector_stats.transmitted++;
+
+    if ( depth > tcp_connector_stats.max_queue )
+        tcp_connector_stats.max_queue = depth;
+
+    return true;
+}
+
+// never waits for the I/O thread
+ConnectorMsgHandle* TcpConnector::receive_message(bool)
+{
+    TcpConnectorMsgHandle* h = nullptr;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+
+        if ( lock.owns_lock() and !queue.empty() )
+        {
+            h = queue.front();
+            queue.pop_front();
+        }
+    }
+
+    if ( !h )
+    {
+        update_stats();
+        return nullptr;
+    }
+
+    tcp_connector_stats.received++;
+    return h;
+}
+
+//-------------------------------------------------------------------------
+// I/O thread
+//-------------------------------------------------------------------------
+
+void TcpConnector::io_loop()
+{
+    const TcpConnectorConfig* cfg = (const TcpConnectorConfig*)config;
+
+    while ( !done )
+    {
+        if ( sock < 0 and !open_socket() )
+        {
+            // answering already waited
+            if ( !cfg->answer )
+                pause(RETRY_MS);
+            continue;
+        }
+
+        bool ok = ( cfg->direction == CONN_TRANSMIT ) ? send_queue() : receive_queue();
+
+        if ( !ok )
+            close_socket();
+    }
+
+    close_socket();
+
+    if ( listener >= 0 )
+    {
+        close(listener);
+        listener = -1;
+
+        if ( !cfg->path.empty() )
+            unlink(peer.c_str());
+    }
+}
+
+void TcpConnector::pause(unsigned ms)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_for(lock, std::chrono::milliseconds(ms), [this]() { return done.load(); });
+}
+
+bool TcpConnector::open_listener()
+{
+    listener = socket(addr.ss_family, SOCK_STREAM, 0);
+
+    if ( listener < 0 )
+        return false;
+
+    int on = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    if ( addr.ss_family == AF_UNIX )
+        unlink(peer.c_str());
+
+    if ( bind(listener, (struct sockaddr*)&addr, addr_len) or listen(listener, 1) )
+    {
+        close(listener);
+        listener = -1;
+        return false;
+    }
+    return true;
+}
+
+bool TcpConnector::open_socket()
+{
+    const TcpConnectorConfig* cfg = (const TcpConnectorConfig*)config;
+
+    if ( cfg->answer )
+    {
+        if ( listener < 0 and !open_listener() )
+        {
+            pause(RETRY_MS);
+            return false;
+        }
+
+        struct pollfd pfd = { listener, POLLIN, 0 };
+
+        if ( poll(&pfd, 1, RETRY_MS) <= 0 )
+            return false;
+
+        sock = accept(listener, nullptr, nullptr);
+
+        if ( sock < 0 )
+            return false;
+    }
+    else
+    {
+        sock = socket(addr.ss_family, SOCK_STREAM, 0);
+
+        if ( sock < 0 )
+            return false;
+
+        // don't let an unreachable peer hold up stop
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+
+        if ( connect(sock, (struct sockaddr*)&addr, addr_len) )
+        {
+            struct pollfd pfd = { sock, POLLOUT, 0 };
+            int err = 0;
+            socklen_t len = sizeof(err);
+
+            if ( errno != EINPROGRESS or poll(&pfd, 1, RETRY_MS) <= 0 or
+                getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &len) or err )
+            {
+                close_socket();
+                return false;
+            }
+        }
+    }
+
+    if ( addr.ss_family != AF_UNIX )
+    {
+        int on = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+
+    connects++;
+    return true;
+}
+
+void TcpConnector::close_socket()
+{
+    if ( sock >= 0 )
+    {
+        close(sock);
+        sock = -1;
+    }
+}
+
+bool TcpConnector::send_all(const void* buf, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)buf;
+
+    while ( len )
+    {
+        if ( done )
+            return false;
+
+        ssize_t n = send(sock, p, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+        if ( n > 0 )
+        {
+            p += n;
+            len -= n;
+            continue;
+        }
+
+        if ( n < 0 and errno != EAGAIN and errno != EWOULDBLOCK and errno != EINTR )
+            return false;
+
+        struct pollfd pfd = { sock, POLLOUT, 0 };
+
+        if ( poll(&pfd, 1, POLL_MS) < 0 and errno != EINTR )
+            return false;
+    }
+    return true;
+}
+
+bool TcpConnector::recv_all(void* buf, size_t len)
+{
+    uint8_t* p = (uint8_t*)buf;
+
+    while ( len )
+    {
+        if ( done )
+            return false;
+
+        ssize_t n = recv(sock, p, len, MSG_DONTWAIT);
+
+        if ( n > 0 )
+        {
+            p += n;
+            len -= n;
+            continue;
+        }
+
+        // the peer closed
+        if ( !n )
+            return false;
+
+        if ( errno != EAGAIN and errno != EWOULDBLOCK and errno != EINTR )
+            return false;
+
+        struct pollfd pfd = { sock, POLLIN, 0 };
+
+        if ( poll(&pfd, 1, POLL_MS) < 0 and errno != EINTR )
+            return false;
+    }
+    return true;
+}
+
+// sends everything queued.  if the connection fails, the unsent messages
+// go back on the front of the queue for the next connection.
+bool TcpConnector::send_queue()
+{
+    std::deque<TcpConnectorMsgHandle*> work;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        io_idle = true;
+
+        cv.wait_for(lock, std::chrono::milliseconds(POLL_MS),
+            [this]() { return !queue.empty() or done; });
+
+        io_idle = false;
+        work.swap(queue);
+    }
+
+    while ( !work.empty() )
+    {
+        TcpConnectorMsgHandle* h = work.front();
+        TcpConnectorMsgHdr hdr(h->connector_msg.length);
+
+        if ( !send_all(&hdr, sizeof(hdr)) or
+            !send_all(h->connector_msg.data, h->connector_msg.length) )
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.insert(queue.begin(), work.begin(), work.end());
+            return false;
+        }
+
+        work.pop_front();
+        delete h;
+    }
+    return true;
+}
+
+// reads at most one message
+bool TcpConnector::receive_queue()
+{
+    struct pollfd pfd = { sock, POLLIN, 0 };
+    int n = poll(&pfd, 1, POLL_MS);
+
+    if ( n < 0 )
+        return errno == EINTR;
+
+    if ( !n )
+        return true;
+
+    TcpConnectorMsgHdr hdr;
+
+    if ( !recv_all(&hdr, sizeof(hdr)) )
+        return false;
+
+    // there's no way to find the next message in a bad stream
+    if ( hdr.get_version() != TCP_FORMAT_VERSION or hdr.get_length() > MAX_MESSAGE )
+        return false;
+
+    TcpConnectorMsgHandle* h = new TcpConnectorMsgHandle(hdr.get_length());
+
+    if ( !recv_all(h->connector_msg.data, h->connector_msg.length) )
+    {
+        delete h;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if ( queue.size() < queue_limit )
+        {
+            queue.push_back(h);
+            h = nullptr;
+        }
+    }
+
+    if ( h )
+    {
+        receive_drops++;
+        delete h;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// api stuff
+//-------------------------------------------------------------------------
+
+static Module* mod_ctor()
+{ return new TcpConnectorModule; }
+
+static void mod_dtor(Module* m)
+{ delete m; }
+
+// each packet thread gets its own connection
+static Connector* tcp_connector_tinit(ConnectorConfig* config)
+{
+    TcpConnectorConfig* cfg = (TcpConnectorConfig*)config;
+
+    if ( cfg->direction != Connector::CONN_TRANSMIT and
+        cfg->direction != Connector::CONN_RECEIVE )
+        return nullptr;
+
+    TcpConnector* tcp_connector = new TcpConnector(cfg, get_instance_id());
+    tcp_connector->start();
+
+    return tcp_connector;
+}
+
+static void tcp_connector_tterm(Connector* connector)
+{
+    TcpConnector* tcp_connector = (TcpConnector*)connector;
+
+    tcp_connector->stop();
+    tcp_connector->update_stats();
+
+    delete tcp_connector;
+}
+
+static ConnectorCommon* tcp_connector_ctor(Module* m)
+{
+    TcpConnectorModule* mod = (TcpConnectorModule*)m;
+    return new TcpConnectorCommon(mod->get_and_clear_config());
+}
+
+static void tcp_connector_dtor(ConnectorCommon* c)
+{
+    TcpConnectorCommon* tc = (TcpConnectorCommon*)c;
+    delete tc;
+}
+
+const ConnectorApi tcp_connector_api =
+{
+    {
+        PT_CONNECTOR,
+        sizeof(ConnectorApi),
+        CONNECTOR_API_VERSION,
+        0,
+        API_RESERVED,
+        API_OPTIONS,
+        TCP_CONNECTOR_NAME,
+        TCP_CONNECTOR_HELP,
+        mod_ctor,
+        mod_dtor
+    },
+    0,
+    nullptr,
+    nullptr,
+    tcp_connector_tinit,
+    tcp_connector_tterm,
+    tcp_connector_ctor,
+    tcp_connector_dtor
+};
+
+#ifdef BUILDING_SO
+SO_PUBLIC const BaseApi* snort_plugins[] =
+{
+    &tcp_connector_api.base,
+    nullptr
+};
+#else
+const BaseApi* tcp_connector = &tcp_connector_api.base;
+#endif
+
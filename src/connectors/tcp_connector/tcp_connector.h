@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef TCP_CONNECTOR_H
+#define TCP_CONNECTOR_H
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "tcp_connector_config.h"
+#include "framework/connector.h"
+#include "framework/counts.h"
+
+#define TCP_FORMAT_VERSION (1)
+
+//-------------------------------------------------------------------------
+// class stuff
+//-------------------------------------------------------------------------
+
+// precedes each message on the wire; fields are in network order
+class __attribute__((__packed__)) TcpConnectorMsgHdr
+{
+public:
+    TcpConnectorMsgHdr() { }
+    TcpConnectorMsgHdr(uint32_t length);
+
+    uint16_t get_version() const;
+    uint32_t get_length() const;
+
+    uint16_t version;
+    uint32_t connector_msg_length;
+};
+
+class TcpConnectorMsgHandle : public ConnectorMsgHandle
+{
+public:
+    TcpConnectorMsgHandle(const uint32_t length);
+    ~TcpConnectorMsgHandle();
+    ConnectorMsg connector_msg;
+};
+
+class TcpConnectorCommon : public ConnectorCommon
+{
+public:
+    TcpConnectorCommon(TcpConnectorConfig::TcpConnectorConfigSet*);
+    ~TcpConnectorCommon();
+};
+
+// The packet thread only queues and dequeues messages; all socket work is
+// done by a per connector I/O thread which also reconnects as needed.
+class TcpConnector : public Connector
+{
+public:
+    TcpConnector(TcpConnectorConfig*, unsigned instance);
+    ~TcpConnector();
+
+    ConnectorMsgHandle* alloc_message(const uint32_t, const uint8_t**) override;
+    void discard_message(ConnectorMsgHandle*) override;
+    bool transmit_message(ConnectorMsgHandle*) override;
+    ConnectorMsgHandle* receive_message(bool) override;
+
+    ConnectorMsg* get_connector_msg(ConnectorMsgHandle* handle) override
+    { return &((TcpConnectorMsgHandle*)handle)->connector_msg; }
+
+    Direction get_connector_direction() override
+    { return ((const TcpConnectorConfig*)config)->direction; }
+
+    void start();
+    void stop();
+    void update_stats();
+
+private:
+    void io_loop();
+    bool open_socket();
+    bool open_listener();
+    void close_socket();
+
+    bool send_queue();
+    bool receive_queue();
+
+    bool send_all(const void*, size_t);
+    bool recv_all(void*, size_t);
+    void pause(unsigned ms);
+
+private:
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    std::string peer;
+
+    int sock;
+    int listener;
+
+    std::deque<TcpConnectorMsgHandle*> queue;
+    uint32_t queue_limit;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread* thread;
+    std::atomic<bool> done;
+
+    std::atomic<bool> io_idle;
+    std::atomic<PegCount> connects;
+    std::atomic<PegCount> receive_drops;
+};
+
+#endif
+
@@ -0,0 +1,49 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef TCP_CONNECTOR_CONFIG_H
+#define TCP_CONNECTOR_CONFIG_H
+
+#include <string>
+#include <vector>
+
+#include "framework/connector.h"
+
+class TcpConnectorConfig : public ConnectorConfig
+{
+public:
+    TcpConnectorConfig()
+    {
+        direction = Connector::CONN_UNDEFINED;
+        answer = false;
+        address = "127.0.0.1";
+        port = 0;
+        queue_limit = 1024;
+    }
+
+    bool answer;            // listen for the peer instead of calling it
+    std::string address;
+    uint16_t port;
+    std::string path;       // unix domain socket instead of address:port
+    uint32_t queue_limit;
+
+    typedef std::vector<TcpConnectorConfig*> TcpConnectorConfigSet;
+};
+
+#endif
+
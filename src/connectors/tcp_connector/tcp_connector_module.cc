@@ -0,0 +1,171 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "tcp_connector_module.h"
+
+#include "log/messages.h"
+#include "main/snort_debug.h"
+
+static const Parameter tcp_connector_params[] =
+{
+    { "connector", Parameter::PT_STRING, nullptr, nullptr,
+      "connector name" },
+
+    { "name", Parameter::PT_STRING, nullptr, nullptr,
+      "channel name" },
+
+    { "direction", Parameter::PT_ENUM, "receive | transmit", nullptr,
+      "usage" },
+
+    { "setup", Parameter::PT_ENUM, "call | answer", "call",
+      "connect to the peer or wait for the peer to connect" },
+
+    { "address", Parameter::PT_STRING, nullptr, "127.0.0.1",
+      "ip4 or ip6 address of the peer, or to listen on" },
+
+    { "port", Parameter::PT_PORT, nullptr, nullptr,
+      "base port; each packet thread adds its instance id" },
+
+    { "path", Parameter::PT_STRING, nullptr, nullptr,
+      "unix socket path used instead of address and port; "
+      "each packet thread appends .<instance id>" },
+
+    { "queue_limit", Parameter::PT_INT, "1:65536", "1024",
+      "maximum messages queued for the connection" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
+static const PegInfo tcp_connector_pegs[] =
+{
+    { "transmitted", "messages queued for transmit" },
+    { "received", "messages received" },
+    { "dropped", "messages dropped because the queue was full" },
+    { "connects", "connections established" },
+    { "max queue", "maximum messages queued" },
+    { nullptr, nullptr }
+};
+
+extern THREAD_LOCAL TcpConnectorStats tcp_connector_stats;
+extern THREAD_LOCAL ProfileStats tcp_connector_perfstats;
+
+//-------------------------------------------------------------------------
+// tcp_connector module
+//-------------------------------------------------------------------------
+
+TcpConnectorModule::TcpConnectorModule() :
+    Module(TCP_CONNECTOR_NAME, TCP_CONNECTOR_HELP, tcp_connector_params)
+{
+    config = nullptr;
+    config_set = new TcpConnectorConfig::TcpConnectorConfigSet;
+}
+
+TcpConnectorModule::~TcpConnectorModule()
+{
+    delete config;
+    delete config_set;
+}
+
+ProfileStats* TcpConnectorModule::get_profile() const
+{ return &tcp_connector_perfstats; }
+
+bool TcpConnectorModule::set(const char*, Value& v, SnortConfig*)
+{
+    if ( v.is("connector") )
+        config->connector_name = v.get_string();
+
+    else if ( v.is("name") )
+        config->name = v.get_string();
+
+    else if ( v.is("direction") )
+    {
+        switch ( v.get_long() )
+        {
+        case 0:
+            config->direction = Connector::CONN_RECEIVE;
+            break;
+        case 1:
+            config->direction = Connector::CONN_TRANSMIT;
+            break;
+        default:
+            return false;
+        }
+    }
+    else if ( v.is("setup") )
+        config->answer = ( v.get_long() == 1 );
+
+    else if ( v.is("address") )
+        config->address = v.get_string();
+
+    else if ( v.is("port") )
+        config->port = (uint16_t)v.get_long();
+
+    else if ( v.is("path") )
+        config->path = v.get_string();
+
+    else if ( v.is("queue_limit") )
+        config->queue_limit = (uint32_t)v.get_long();
+
+    else
+        return false;
+
+    return true;
+}
+
+// clear my working config and hand-over the compiled list to the caller
+TcpConnectorConfig::TcpConnectorConfigSet* TcpConnectorModule::get_and_clear_config()
+{
+    TcpConnectorConfig::TcpConnectorConfigSet* temp_config = config_set;
+    config = nullptr;
+    config_set = nullptr;
+    return temp_config;
+}
+
+bool TcpConnectorModule::begin(const char*, int, SnortConfig*)
+{
+    if ( !config )
+        config = new TcpConnectorConfig;
+
+    return true;
+}
+
+bool TcpConnectorModule::end(const char*, int idx, SnortConfig*)
+{
+    if ( idx != 0 )
+    {
+        if ( config->path.empty() and !config->port )
+        {
+            ParseError("%s requires a port or path", TCP_CONNECTOR_NAME);
+            return false;
+        }
+        config_set->push_back(config);
+        config = nullptr;
+    }
+    return true;
+}
+
+const PegInfo* TcpConnectorModule::get_pegs() const
+{ return tcp_connector_pegs; }
+
+PegCount* TcpConnectorModule::get_counts() const
+{ return (PegCount*)&tcp_connector_stats; }
+
@@ -0,0 +1,270 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// tcp_connector_test.cc
+// unit test main
+
+#include "connectors/tcp_connector/tcp_connector.h"
+#include "connectors/tcp_connector/tcp_connector_module.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+#include "main/snort_debug.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+extern const BaseApi* tcp_connector;
+extern THREAD_LOCAL TcpConnectorStats tcp_connector_stats;
+
+ConnectorApi* tc_api = nullptr;
+
+void show_stats(PegCount*, const PegInfo*, unsigned, const char*) { }
+
+void show_stats(PegCount*, const PegInfo*, IndexVec&, const char*) { }
+
+void show_stats(PegCount*, const PegInfo*, IndexVec&, const char*, FILE*) { }
+
+void Debug::print(const char*, int, uint64_t, const char*, ...) { }
+void ErrorMessage(const char*, ...) { }
+unsigned get_instance_id() { return 0; }
+
+TcpConnectorModule::TcpConnectorModule() :
+    Module("TC", "TC Help", nullptr)
+{ }
+
+TcpConnectorConfig::TcpConnectorConfigSet* TcpConnectorModule::get_and_clear_config()
+{ return new TcpConnectorConfig::TcpConnectorConfigSet; }
+
+TcpConnectorModule::~TcpConnectorModule() { }
+
+ProfileStats* TcpConnectorModule::get_profile() const { return nullptr; }
+
+bool TcpConnectorModule::set(const char*, Value&, SnortConfig*) { return true; }
+
+bool TcpConnectorModule::begin(const char*, int, SnortConfig*) { return true; }
+
+bool TcpConnectorModule::end(const char*, int, SnortConfig*) { return true; }
+
+const PegInfo* TcpConnectorModule::get_pegs() const { return nullptr; }
+
+PegCount* TcpConnectorModule::get_counts() const { return nullptr; }
+
+// returns a listening socket on an ephemeral loopback port
+static int listen_any(uint16_t& port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in sin;
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t len = sizeof(sin);
+
+    if ( bind(fd, (struct sockaddr*)&sin, len) or listen(fd, 1) or
+        getsockname(fd, (struct sockaddr*)&sin, &len) )
+    {
+        close(fd);
+        return -1;
+    }
+    port = ntohs(sin.sin_port);
+    return fd;
+}
+
+static int accept_wait(int fd)
+{
+    struct pollfd pfd = { fd, POLLIN, 0 };
+
+    if ( poll(&pfd, 1, 5000) <= 0 )
+        return -1;
+
+    return accept(fd, nullptr, nullptr);
+}
+
+static bool read_all(int fd, void* buf, size_t len)
+{
+    uint8_t* p = (uint8_t*)buf;
+
+    while ( len )
+    {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+
+        if ( poll(&pfd, 1, 5000) <= 0 )
+            return false;
+
+        ssize_t n = read(fd, p, len);
+
+        if ( n <= 0 )
+            return false;
+
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+TEST_GROUP(tcp_connector)
+{
+    TcpConnectorConfig config;
+    int listener;
+    uint16_t port;
+
+    void setup()
+    {
+        // FIXIT-L workaround for CppUTest mem leak detector issue
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+        tc_api = (ConnectorApi*)tcp_connector;
+        memset(&tcp_connector_stats, 0, sizeof(tcp_connector_stats));
+
+        listener = listen_any(port);
+        config.connector_name = "tcp";
+        config.name = "tcp";
+        config.address = "127.0.0.1";
+        config.port = port;
+        config.answer = false;
+        config.queue_limit = 4;
+    }
+
+    void teardown()
+    {
+        if ( listener >= 0 )
+            close(listener);
+
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+TEST(tcp_connector, mod_instance_ctor_dtor)
+{
+    CHECK(tcp_connector != nullptr);
+    Module* mod = tcp_connector->mod_ctor();
+    CHECK(mod != nullptr);
+    ConnectorCommon* connector_common = tc_api->ctor(mod);
+    CHECK(connector_common != nullptr);
+    tc_api->dtor(connector_common);
+    tcp_connector->mod_dtor(mod);
+}
+
+TEST(tcp_connector, transmit)
+{
+    CHECK(listener >= 0);
+    config.direction = Connector::CONN_TRANSMIT;
+
+    Connector* connector = tc_api->tinit(&config);
+    CHECK(connector != nullptr);
+
+    const uint8_t* data = nullptr;
+    ConnectorMsgHandle* handle = connector->alloc_message(5, &data);
+    memcpy((uint8_t*)data, "hello", 5);
+    CHECK(connector->transmit_message(handle));
+
+    int fd = accept_wait(listener);
+    CHECK(fd >= 0);
+
+    TcpConnectorMsgHdr hdr;
+    uint8_t buf[5];
+
+    CHECK(read_all(fd, &hdr, sizeof(hdr)));
+    CHECK(hdr.get_version() == TCP_FORMAT_VERSION);
+    CHECK(hdr.get_length() == 5);
+    CHECK(read_all(fd, buf, sizeof(buf)));
+    CHECK(!memcmp(buf, "hello", 5));
+
+    tc_api->tterm(connector);
+    close(fd);
+
+    CHECK(tcp_connector_stats.transmitted == 1);
+    CHECK(tcp_connector_stats.connects == 1);
+    CHECK(tcp_connector_stats.max_queue == 1);
+}
+
+TEST(tcp_connector, queue_full)
+{
+    // nobody answers so everything stays queued
+    close(listener);
+    listener = -1;
+    config.direction = Connector::CONN_TRANSMIT;
+
+    Connector* connector = tc_api->tinit(&config);
+    CHECK(connector != nullptr);
+
+    for ( int i = 0; i < 6; ++i )
+    {
+        const uint8_t* data = nullptr;
+        ConnectorMsgHandle* handle = connector->alloc_message(8, &data);
+        connector->transmit_message(handle);
+    }
+
+    tc_api->tterm(connector);
+
+    CHECK(tcp_connector_stats.transmitted == 4);
+    CHECK(tcp_connector_stats.dropped == 2);
+    CHECK(tcp_connector_stats.max_queue == 4);
+}
+
+TEST(tcp_connector, receive)
+{
+    CHECK(listener >= 0);
+    config.direction = Connector::CONN_RECEIVE;
+
+    Connector* connector = tc_api->tinit(&config);
+    CHECK(connector != nullptr);
+
+    int fd = accept_wait(listener);
+    CHECK(fd >= 0);
+
+    TcpConnectorMsgHdr hdr(3);
+    CHECK(write(fd, &hdr, sizeof(hdr)) == sizeof(hdr));
+    CHECK(write(fd, "abc", 3) == 3);
+
+    ConnectorMsgHandle* handle = nullptr;
+
+    for ( int i = 0; i < 500 and !handle; ++i )
+    {
+        handle = connector->receive_message(false);
+
+        if ( !handle )
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(handle != nullptr);
+
+    ConnectorMsg* msg = connector->get_connector_msg(handle);
+    CHECK(msg->length == 3);
+    CHECK(!memcmp(msg->data, "abc", 3));
+    connector->discard_message(handle);
+
+    tc_api->tterm(connector);
+    close(fd);
+
+    CHECK(tcp_connector_stats.received == 1);
+    CHECK(tcp_connector_stats.connects == 1);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
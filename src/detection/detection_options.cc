@@ -32,6 +32,8 @@
 #include "config.h"
 #endif
 
+#include <vector>
+
 #include "detection_defines.h"
 #include "detection_util.h"
 #include "treenodes.h"
@@ -337,14 +339,15 @@ void* add_detection_option_tree(
 }
 
 int detection_option_node_evaluate(
-    detection_option_tree_node_t* node, detection_option_eval_data_t* eval_data,
+    const detection_option_op_t* node, detection_option_eval_data_t* eval_data,
     Cursor& orig_cursor)
 {
     // need node->state to do perf profiling
     if ( !node )
         return 0;
 
-    auto& state = node->state[get_instance_id()];
+    unsigned instance_id = get_instance_id();
+    auto& state = node->state[instance_id];
     RuleContext profile(state);
 
     int result = 0;
@@ -365,7 +368,7 @@ int detection_option_node_evaluate(
     auto pomd = eval_data->pomd;
 
     // see if evaluated it before ...
-    if ( !node->is_relative )
+    if ( !(node->flags & DOT_OP_RELATIVE) )
     {
         auto last_check = state.last_check;
 
@@ -389,19 +392,9 @@ int detection_option_node_evaluate(
     state.last_check.rebuild_flag = p->packet_flags & PKT_REBUILT_STREAM;
 
     // Save some stuff off for repeated pattern tests
-    bool try_again = false;
-    PmdLastCheck* content_last = nullptr;
-
-    if ( node->option_type != RULE_OPTION_TYPE_LEAF_NODE )
-    {
-        IpsOption* opt = (IpsOption*)node->option_data;
-        try_again = opt->retry();
-
-        PatternMatchData* pmd = opt->get_pattern();
-
-        if ( pmd and pmd->last_check )
-            content_last = pmd->last_check + get_instance_id();
-    }
+    bool try_again = (node->flags & DOT_OP_RETRY) != 0;
+    PmdLastCheck* content_last = node->content_last ?
+        node->content_last + instance_id : nullptr;
 
     // No, haven't evaluated this one before... Check it.
     do
@@ -459,7 +452,7 @@ int detection_option_node_evaluate(
 
                 if ( f_result )
                 {
-                    otn->state[get_instance_id()].matches++;
+                    otn->state[instance_id].matches++;
 
                     if ( !eval_data->flowbit_noalert )
                     {
@@ -502,8 +495,7 @@ int detection_option_node_evaluate(
         case RULE_OPTION_TYPE_FLOWBIT:
             if ( node->evaluate )
             {
-                flowbits_setoperation =
-                    FlowBits_SetOperation(node->option_data);
+                flowbits_setoperation = (node->flags & DOT_OP_SET_FLOWBITS) != 0;
 
                 if ( flowbits_setoperation )
                     // set to match so we don't bail early
@@ -564,11 +556,8 @@ int detection_option_node_evaluate(
             {
                 for ( int i = 0; i < node->num_children; ++i )
                 {
-                    detection_option_tree_node_t* child_node =
-                        node->children[i];
-
-                    dot_node_state_t* child_state =
-                        child_node->state + get_instance_id();
+                    const detection_option_op_t* child_node = node->children + i;
+                    dot_node_state_t* child_state = child_node->state + instance_id;
 
                     for ( int j = 0; j < NUM_BYTE_EXTRACT_VARS; ++j )
                         SetByteExtractValue(tmp_byte_extract_vars[j], (int8_t)j);
@@ -577,7 +566,7 @@ int detection_option_node_evaluate(
                     {
                         if ( child_state->result == DETECTION_OPTION_NO_MATCH )
                         {
-                            if ( !child_node->is_relative )
+                            if ( !(child_node->flags & DOT_OP_RELATIVE) )
                             {
                                 if ( child_node->option_type == RULE_OPTION_TYPE_CONTENT )
                                 {
@@ -596,10 +585,7 @@ int detection_option_node_evaluate(
                                 // Check for an unbounded relative search.  If this
                                 // failed before, it's going to fail again so don't
                                 // go down this path again
-                                IpsOption* opt = (IpsOption*)node->option_data;
-                                PatternMatchData* pmd = opt->get_pattern();
-
-                                if ( pmd->unbounded() )
+                                if ( node->flags & DOT_OP_UNBOUNDED )
                                 {
                                     // Only increment result once. Should hit this
                                     // condition on first loop iteration
@@ -623,7 +609,7 @@ int detection_option_node_evaluate(
                     }
 
                     child_state->result = detection_option_node_evaluate(
-                        node->children[i], eval_data, cursor);
+                        child_node, eval_data, cursor);
 
                     if ( child_node->option_type == RULE_OPTION_TYPE_LEAF_NODE )
                         // Leaf node won't have any children but will return success
@@ -666,7 +652,7 @@ int detection_option_node_evaluate(
 
         if ( continue_loop &&
              rval == DETECTION_OPTION_MATCH &&
-             node->relative_children )
+             (node->flags & DOT_OP_RELATIVE_CHILDREN) )
         {
             continue_loop = try_again;
         }
@@ -706,6 +692,81 @@ int detection_option_node_evaluate(
     return result;
 }
 
+//-------------------------------------------------------------------------
+// program
+//-------------------------------------------------------------------------
+
+static void compile_detection_option_op(
+    detection_option_op_t* op, const detection_option_tree_node_t* node,
+    const detection_option_op_t* children)
+{
+    op->evaluate = node->evaluate;
+    op->option_data = node->option_data;
+    op->state = node->state;
+    op->children = node->num_children ? children : nullptr;
+    op->num_children = node->num_children;
+    op->option_type = (uint8_t)node->option_type;
+    op->flags = 0;
+
+    if ( node->is_relative )
+        op->flags |= DOT_OP_RELATIVE;
+
+    if ( node->relative_children )
+        op->flags |= DOT_OP_RELATIVE_CHILDREN;
+
+    if ( node->option_type == RULE_OPTION_TYPE_LEAF_NODE )
+        return;
+
+    IpsOption* opt = (IpsOption*)node->option_data;
+
+    if ( opt->retry() )
+        op->flags |= DOT_OP_RETRY;
+
+    if ( node->option_type == RULE_OPTION_TYPE_FLOWBIT and
+         FlowBits_SetOperation(node->option_data) )
+        op->flags |= DOT_OP_SET_FLOWBITS;
+
+    if ( PatternMatchData* pmd = opt->get_pattern() )
+    {
+        op->content_last = pmd->last_check;
+
+        if ( pmd->unbounded() )
+            op->flags |= DOT_OP_UNBOUNDED;
+    }
+}
+
+void compile_detection_option_root(detection_option_tree_root_t* root)
+{
+    if ( root->program )
+        snort_free(root->program);
+
+    root->program = nullptr;
+
+    if ( !root->num_children )
+        return;
+
+    // breadth first so each node's children are adjacent
+    std::vector<const detection_option_tree_node_t*> nodes(
+        root->children, root->children + root->num_children);
+
+    for ( unsigned i = 0; i < nodes.size(); ++i )
+    {
+        const detection_option_tree_node_t* node = nodes[i];
+        nodes.insert(nodes.end(), node->children, node->children + node->num_children);
+    }
+
+    root->program = (detection_option_op_t*)
+        snort_calloc(nodes.size(), sizeof(*root->program));
+
+    unsigned next = root->num_children;
+
+    for ( unsigned i = 0; i < nodes.size(); ++i )
+    {
+        compile_detection_option_op(root->program + i, nodes[i], root->program + next);
+        next += nodes[i]->num_children;
+    }
+}
+
 struct node_profile_stats
 {
     // FIXIT-L duplicated from dot_node_state_t and OtnState
@@ -833,6 +894,9 @@ void free_detection_option_root(void** existing_tree)
     root = (detection_option_tree_root_t*)*existing_tree;
     snort_free(root->children);
 
+    if ( root->program )
+        snort_free(root->program);
+
     delete[] root->latency_state;
     snort_free(root);
     *existing_tree = NULL;
@@ -30,6 +30,13 @@
 // These trees are instantiated at parse time, one per MPSE match state.
 // Eval, profiling, and latency data are attached in an array sized per max
 // packet threads.
+//
+// Once a tree is finalized it is flattened into a program: an array of ops
+// in breadth first order so siblings are adjacent.  Each op caches what
+// evaluation needs from its node and option so the packet threads don't
+// chase node, child, and option pointers or make virtual calls to get
+// properties that are fixed at compile time.  The nodes are kept for
+// dedup and stats and share their state with the ops.
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -95,11 +102,31 @@ struct detection_option_tree_node_t
     dot_node_state_t* state;
 };
 
+// op flags
+#define DOT_OP_RELATIVE           0x01  // is relative
+#define DOT_OP_RELATIVE_CHILDREN  0x02  // has relative children
+#define DOT_OP_RETRY              0x04  // may match again at a later offset
+#define DOT_OP_UNBOUNDED          0x08  // content without depth or within
+#define DOT_OP_SET_FLOWBITS       0x10  // flowbit set operation
+
+struct detection_option_op_t
+{
+    eval_func_t evaluate;
+    void* option_data;
+    dot_node_state_t* state;              // from the node
+    const detection_option_op_t* children;
+    struct PmdLastCheck* content_last;    // per thread, content only
+    int num_children;
+    uint8_t option_type;
+    uint8_t flags;
+};
+
 struct detection_option_tree_root_t
 {
     int num_children;
     detection_option_tree_node_t** children;
     RuleLatencyState* latency_state;
+    detection_option_op_t* program;  // first num_children ops are the children
 };
 
 struct detection_option_eval_data_t
@@ -115,8 +142,11 @@ struct detection_option_eval_data_t
 void* add_detection_option(struct SnortConfig*, option_type_t, void*);
 void* add_detection_option_tree(struct SnortConfig*, detection_option_tree_node_t*);
 
+// must be called after the root's children are final
+void compile_detection_option_root(detection_option_tree_root_t*);
+
 int detection_option_node_evaluate(
-    detection_option_tree_node_t*, detection_option_eval_data_t*, class Cursor&);
+    const detection_option_op_t*, detection_option_eval_data_t*, class Cursor&);
 
 void DetectionHashTableFree(SFXHASH*);
 void DetectionTreeHashTableFree(SFXHASH*);
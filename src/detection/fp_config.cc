@@ -33,6 +33,7 @@
 #include "framework/mpse.h"
 #include "managers/mpse_manager.h"
 #include "log/messages.h"
+#include "utils/util.h"
 
 FastPatternConfig::FastPatternConfig()
 {
@@ -41,6 +42,7 @@ FastPatternConfig::FastPatternConfig()
     inspect_stream_insert = false;
     max_queue_events = 5;
     bleedover_port_limit = 1024;
+    reload_reuse = true;
 
     search_api = MpseManager::get_search_api("ac_bnfa");
     assert(search_api);
@@ -48,7 +50,18 @@ FastPatternConfig::FastPatternConfig()
 }
 
 FastPatternConfig::~FastPatternConfig()
-{ }
+{
+    if ( cache_dir )
+        snort_free(cache_dir);
+}
+
+void FastPatternConfig::set_cache_dir(const char* dir)
+{
+    if ( cache_dir )
+        snort_free(cache_dir);
+
+    cache_dir = (dir and *dir) ? snort_strdup(dir) : nullptr;
+}
 
 bool FastPatternConfig::set_detect_search_method(const char* method)
 {
@@ -112,6 +112,33 @@ public:
     void set_debug_print_rule_groups_uncompiled()
     { portlists_flags |= PL_DEBUG_PRINT_RULEGROUPS_UNCOMPILED; }
 
+    void set_batch_search(bool enable)
+    { batch_search = enable; }
+
+    bool get_batch_search()
+    { return batch_search; }
+
+    void set_cache_dir(const char*);
+
+    // compiled search engine databases are cached here if set
+    const char* get_cache_dir()
+    { return cache_dir; }
+
+    void set_compile_threads(unsigned n)
+    { compile_threads = n; }
+
+    // threads used to compile rule groups; 0 means one per core
+    unsigned get_compile_threads()
+    { return compile_threads; }
+
+    void set_reload_reuse(bool enable)
+    { reload_reuse = enable; }
+
+    // on reload, share engines with the running configuration when the
+    // patterns are unchanged
+    bool get_reload_reuse()
+    { return reload_reuse; }
+
     void set_search_opt(int flag)
     { search_opt = flag; }
 
@@ -143,15 +170,19 @@ public:
 
 private:
     const struct MpseApi* search_api;
+    char* cache_dir;
 
     bool inspect_stream_insert;
     bool trim;
     bool split_any_any;
+    bool batch_search;
+    bool reload_reuse;
     bool debug_print_fast_pattern;
     bool debug;
 
     unsigned max_queue_events;
     unsigned bleedover_port_limit;
+    unsigned compile_threads;
 
     int search_opt;
     int portlists_flags;
@@ -39,7 +39,15 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "main/snort.h"
 #include "main/snort_config.h"
+#include "main/thread.h"
 #include "hash/sfghash.h"
 #include "ips_options/ips_flow.h"
 #include "utils/util.h"
@@ -66,6 +74,27 @@
 #include "pattern_match_data.h"
 
 static unsigned mpse_count = 0;
+static unsigned reuse_count = 0;
+
+// engines are queued as port groups are finished and compiled together by
+// fpCompileMpse().  the trees finalized here are recorded while compiling
+// because finalizing adds them to tables shared by all port groups.
+struct MpseJob
+{
+    Mpse* mpse;
+    uint64_t key;
+    std::vector<void**> trees;
+    int status;
+
+    MpseJob(Mpse* m, uint64_t k)
+    { mpse = m; key = k; status = 0; }
+};
+
+static std::vector<MpseJob> mpse_jobs;
+static THREAD_LOCAL MpseJob* mpse_job = nullptr;
+
+// on reload, the engines of the running configuration by PortGroup::mpse_key
+static std::unordered_multimap<uint64_t, Mpse*> prev_mpse;
 
 static void fpDeletePMX(void* data);
 
@@ -100,6 +129,7 @@ static int finalize_detection_option_tree(SnortConfig* sc, detection_option_tree
 #endif
     }
 
+    compile_detection_option_root(root);
     return 0;
 }
 
@@ -328,6 +358,11 @@ static int pmx_create_tree(SnortConfig* sc, void* id, void** existing_tree)
     if (!id)
     {
         /* NULL input id (PMX *), last call for this pattern state */
+        if ( mpse_job )
+        {
+            mpse_job->trees.push_back(existing_tree);
+            return 0;
+        }
         return finalize_detection_option_tree(sc, (detection_option_tree_root_t*)*existing_tree);
     }
 
@@ -550,6 +585,34 @@ static PatternMatchData* get_fp_content(OptTreeNode* otn, OptFpList*& next)
     return nullptr;
 }
 
+// fnv-1a over the patterns in the order added with the flags that
+// affect how they are compiled
+static uint64_t fpHashPattern(
+    uint64_t h, const char* pat, int len, const Mpse::PatternDescriptor& desc)
+{
+    if ( !h )
+        h = 0xcbf29ce484222325ull;
+
+    const uint8_t head[] =
+    {
+        (uint8_t)len, (uint8_t)(len >> 8),
+        (uint8_t)((desc.no_case ? 1 : 0) | (desc.negated ? 2 : 0) | (desc.literal ? 4 : 0))
+    };
+
+    for ( unsigned i = 0; i < sizeof(head); ++i )
+    {
+        h ^= head[i];
+        h *= 0x100000001b3ull;
+    }
+
+    for ( int i = 0; i < len; ++i )
+    {
+        h ^= (uint8_t)pat[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
 static int fpFinishPortGroupRule(
     SnortConfig* sc, PortGroup* pg,
     OptTreeNode* otn, PatternMatchData* pmd, FastPatternConfig* fp)
@@ -605,6 +668,9 @@ static int fpFinishPortGroupRule(
 
         Mpse::PatternDescriptor desc(pmd->no_case, pmd->negated, pmd->literal);
         pg->mpse[pmd->pm_type]->add_pattern(sc, (uint8_t*)pattern, pattern_length, desc, pmx);
+
+        pg->mpse_key[pmd->pm_type] = fpHashPattern(
+            pg->mpse_key[pmd->pm_type], pattern, pattern_length, desc);
     }
 
     return 0;
@@ -625,13 +691,7 @@ static int fpFinishPortGroup(
         {
             if (pg->mpse[i]->get_pattern_count() != 0)
             {
-                if (pg->mpse[i]->prep_patterns(sc) != 0)
-                {
-                    FatalError("Failed to compile port group patterns.\n");
-                }
-
-                if (fp->get_debug_mode())
-                    pg->mpse[i]->print_info();
+                mpse_jobs.push_back(MpseJob(pg->mpse[i], pg->mpse_key[i]));
                 rules = 1;
             }
             else
@@ -668,6 +728,115 @@ static int fpFinishPortGroup(
     return 0;
 }
 
+static void fpPrepMpse(SnortConfig* sc, MpseJob& job)
+{
+    mpse_job = &job;
+    job.status = job.mpse->prep_patterns(sc);
+    mpse_job = nullptr;
+}
+
+// engines verify that the patterns really are the same so a hash
+// collision just costs a comparison
+static bool fpReuseMpse(SnortConfig* sc, MpseJob& job)
+{
+    auto range = prev_mpse.equal_range(job.key);
+
+    for ( auto it = range.first; it != range.second; ++it )
+    {
+        if ( it->second->get_api() != job.mpse->get_api() )
+            continue;
+
+        mpse_job = &job;
+        bool reused = job.mpse->reuse(sc, it->second);
+        mpse_job = nullptr;
+
+        if ( reused )
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Compile the queued search engines.  On reload, engines with the same
+ * patterns as one in the running configuration share its state machine
+ * instead.  Each engine is independent so those that allow it are compiled
+ * on a pool of threads.  The detection option trees recorded while
+ * compiling are then finalized here in queue order so the result is the
+ * same for any number of threads.
+ */
+static void fpCompileMpse(SnortConfig* sc, FastPatternConfig* fp)
+{
+    std::vector<unsigned> order;
+
+    for ( unsigned i = 0; i < mpse_jobs.size(); ++i )
+    {
+        if ( !prev_mpse.empty() and fpReuseMpse(sc, mpse_jobs[i]) )
+            reuse_count++;
+
+        else if ( mpse_jobs[i].mpse->concurrent_prep() )
+            order.push_back(i);
+        else
+            fpPrepMpse(sc, mpse_jobs[i]);
+    }
+
+    // start the biggest first so they don't finish last
+    std::stable_sort(order.begin(), order.end(),
+        [](unsigned a, unsigned b)
+        {
+            return mpse_jobs[a].mpse->get_pattern_count() >
+                mpse_jobs[b].mpse->get_pattern_count();
+        });
+
+    unsigned num_threads = fp->get_compile_threads();
+
+    if ( !num_threads )
+        num_threads = std::thread::hardware_concurrency();
+
+    if ( num_threads > order.size() )
+        num_threads = order.size();
+
+    std::atomic<unsigned> next(0);
+
+    auto prep = [&]()
+    {
+        unsigned i;
+
+        while ( (i = next++) < order.size() )
+            fpPrepMpse(sc, mpse_jobs[order[i]]);
+    };
+
+    // this thread is one of the pool
+    std::vector<std::thread> pool;
+
+    for ( unsigned t = 1; t < num_threads; ++t )
+        pool.push_back(std::thread(prep));
+
+    prep();
+
+    for ( auto& t : pool )
+        t.join();
+
+    for ( auto& job : mpse_jobs )
+    {
+        if ( job.status )
+            FatalError("Failed to compile port group patterns.\n");
+
+        for ( auto tree : job.trees )
+            finalize_detection_option_tree(sc, (detection_option_tree_root_t*)*tree);
+
+        if ( fp->get_debug_mode() )
+            job.mpse->print_info();
+    }
+
+    if ( fp->get_debug_print_rule_group_build_details() )
+        LogMessage("Compiled %u search engines with %u threads, reused %u\n",
+            (unsigned)mpse_jobs.size() - reuse_count, num_threads ? num_threads : 1,
+            reuse_count);
+
+    mpse_jobs.clear();
+    prev_mpse.clear();
+}
+
 static int fpAddPortGroupRule(
     SnortConfig* sc, PortGroup* pg, OptTreeNode* otn, FastPatternConfig* fp)
 {
@@ -1676,6 +1845,59 @@ static void fp_print_port_groups(RulePortTables* port_tables)
     }
 }
 
+static void fp_index_port_groups(PortGroup* pg)
+{
+    if ( !pg )
+        return;
+
+    for ( int i = PM_TYPE_PKT; i < PM_TYPE_MAX; ++i )
+        if ( pg->mpse[i] and pg->mpse[i]->get_pattern_count() )
+            prev_mpse.insert(std::make_pair(pg->mpse_key[i], pg->mpse[i]));
+}
+
+static void fp_index_port_groups(PortTable* tab)
+{
+    for ( SFGHASH_NODE* node=sfghash_findfirst(tab->pt_mpxo_hash);
+        node; node=sfghash_findnext(tab->pt_mpxo_hash) )
+    {
+        PortObject2* po = (PortObject2*)node->data;
+        fp_index_port_groups((PortGroup*)po->data);
+    }
+}
+
+static void fp_index_port_groups(PortProto& tab)
+{
+    fp_index_port_groups(tab.src);
+    fp_index_port_groups(tab.dst);
+    fp_index_port_groups((PortGroup*)tab.any->data);
+}
+
+// the running configuration is only read here; its engines are still
+// searched by the packet threads until the swap
+static void fp_index_prev_mpse(SnortConfig* prev)
+{
+    if ( prev->port_tables )
+    {
+        fp_index_port_groups(prev->port_tables->ip);
+        fp_index_port_groups(prev->port_tables->icmp);
+        fp_index_port_groups(prev->port_tables->tcp);
+        fp_index_port_groups(prev->port_tables->udp);
+    }
+
+    if ( prev->spgmmTable )
+    {
+        for ( int i = SNORT_PROTO_IP; i < SNORT_PROTO_MAX; ++i )
+        {
+            for ( SFGHASH* h : { prev->spgmmTable->to_srv[i], prev->spgmmTable->to_cli[i] } )
+            {
+                for ( SFGHASH_NODE* node=sfghash_findfirst(h);
+                    node; node=sfghash_findnext(h) )
+                    fp_index_port_groups((PortGroup*)node->data);
+            }
+        }
+    }
+}
+
 /*
  *  Build Service based PortGroups using the rules
  *  metadata option service parameter.
@@ -1727,6 +1949,10 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
     }
 
     mpse_count = 0;
+    reuse_count = 0;
+
+    if ( Snort::is_reloading() and fp->get_reload_reuse() and snort_conf and snort_conf != sc )
+        fp_index_prev_mpse(snort_conf);
 
     MpseManager::start_search_engine(fp->get_search_api());
 
@@ -1764,6 +1990,9 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
     if (fp->get_debug_print_rule_group_build_details())
         LogMessage("Service Based Rule Maps Done....\n");
 
+    fpCompileMpse(sc, fp);
+    unsigned pruned = Mpse::cache_prune(sc);
+
     fp_print_port_groups(port_tables);
     fp_print_service_groups(sc->spgmmTable);
 
@@ -1779,6 +2008,12 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
     if ( fp->get_num_patterns_trimmed() )
         LogMessage("%25.25s: %-12u\n", "prefix trims", fp->get_num_patterns_trimmed());
 
+    if ( reuse_count )
+        LogMessage("%25.25s: %-12u\n", "reused engines", reuse_count);
+
+    if ( pruned )
+        LogMessage("%25.25s: %-12u\n", "pruned cache files", pruned);
+
     MpseManager::setup_search_engine(fp->get_search_api(), sc);
 
     return 0;
@@ -406,7 +406,7 @@ static int detection_option_tree_evaluate(detection_option_tree_root_t* root,
     for ( int i = 0; i < root->num_children; ++i )
     {
         // Increment number of events generated from that child 
-        rval += detection_option_node_evaluate(root->children[i], eval_data, c);
+        rval += detection_option_node_evaluate(root->program + i, eval_data, c);
     }
 
     return rval;
@@ -906,17 +906,86 @@ static int rule_tree_queue(
     return 0;
 }
 
+// with batch_search, all fast pattern buffers of the packet are gathered
+// first and searched together with the matches from all of them queued
+// into a single stash.  the inspection buffers must therefore remain valid
+// until the end of fp_search().
+class MpseBatch
+{
+public:
+    static const unsigned max = 8;
+
+    void init()
+    { count = 0; }
+
+    unsigned size() const
+    { return count; }
+
+    void add(Mpse* so, const uint8_t* buf, unsigned len, void* context)
+    {
+        assert(count < max);
+        mpse[count] = so;
+
+        MpseBatchItem& item = items[count++];
+        item.buf = buf;
+        item.len = len;
+        item.context = context;
+        item.state = 0;
+    }
+
+    void search(MpseMatch);
+
+private:
+    unsigned count;
+    Mpse* mpse[max];
+    MpseBatchItem items[max];
+};
+
+static THREAD_LOCAL MpseBatch mpse_batch;
+
+// search the buffers for each engine as one batch
+void MpseBatch::search(MpseMatch match)
+{
+    MpseBatchItem group[max];
+    bool done[max] = { };
+
+    for ( unsigned i = 0; i < count; ++i )
+    {
+        if ( done[i] )
+            continue;
+
+        unsigned n = 0;
+
+        for ( unsigned j = i; j < count; ++j )
+        {
+            if ( !done[j] and mpse[j] == mpse[i] )
+            {
+                group[n++] = items[j];
+                done[j] = true;
+            }
+        }
+        mpse[i]->search_batch(group, n, match);
+    }
+    pc.batch_searches++;
+    count = 0;
+}
+
 #define SEARCH_DATA(buf, len, cnt) \
     { \
         assert(so->get_pattern_count() > 0); \
-        int start_state = 0; \
         cnt++; \
-        omd->data = buf; omd->size = len; \
-        stash.init(); \
-        so->search(buf, len, rule_tree_queue, omd, &start_state); \
-        stash.process(rule_tree_match, omd); \
-        if ( PacketLatency::fastpath() ) \
-            return 1; \
+        if ( batch_search ) \
+            mpse_batch.add(so, buf, len, omd); \
+        else \
+        { \
+            int start_state = 0; \
+            omd->data = buf; omd->size = len; \
+            stash.init(); \
+            so->search(buf, len, rule_tree_queue, omd, &start_state); \
+            stash.process(rule_tree_match, omd); \
+            if ( PacketLatency::fastpath() ) \
+                return 1; \
+        } \
     }
 
 #define SEARCH_BUFFER(ibt, pmt, cnt) \
@@ -938,6 +1007,10 @@ static int fp_search(
     omd->check_ports = check_ports;
 
     bool user_mode = snort_conf->sopgTable->user_mode;
+    bool batch_search = snort_conf->fast_pattern_config->get_batch_search();
+
+    if ( batch_search )
+        mpse_batch.init();
 
     if ( (!user_mode or type < 2) and p->data and p->dsize )
     {
@@ -981,6 +1054,16 @@ static int fp_search(
                 SEARCH_DATA(g_file_data.data, g_file_data.len, pc.file_searches);
         }
     }
+
+    if ( batch_search and mpse_batch.size() )
+    {
+        stash.init();
+        mpse_batch.search(rule_tree_queue);
+        stash.process(rule_tree_match, omd);
+
+        if ( PacketLatency::fastpath() )
+            return 1;
+    }
     return 0;
 }
 
@@ -276,20 +276,22 @@ void FileFlows::log_file_event(FileContext* context, Flow* flow)
 {
     if ( context->get_file_name().length() )
     {
+        static const unsigned file_event = DataBus::get_id(FILE_EVENT);
+
         switch (context->verdict)
         {
         case FILE_VERDICT_LOG:
             // Log file event through data bus
-            get_data_bus().publish("file_event", (const uint8_t*)"LOG", 3, flow);
+            get_data_bus().publish(file_event, (const uint8_t*)"LOG", 3, flow);
             break;
 
         case FILE_VERDICT_BLOCK:
             // can't block session inside a session
-            get_data_bus().publish( "file_event", (const uint8_t*)"BLOCK", 5, flow);
+            get_data_bus().publish(file_event, (const uint8_t*)"BLOCK", 5, flow);
             break;
 
         case FILE_VERDICT_REJECT:
-            get_data_bus().publish( "file_event", (const uint8_t*)"RESET", 5, flow);
+            get_data_bus().publish(file_event, (const uint8_t*)"RESET", 5, flow);
             break;
         default:
             break;
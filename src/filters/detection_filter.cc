@@ -26,6 +26,7 @@
 #include "utils/util.h"
 #include "parser/parser.h"
 #include "filters/sfthd.h"
+#include "filters/shared_tracker.h"
 #include "main/thread.h"
 
 static THREAD_LOCAL SFXHASH* detection_filter_hash = NULL;
@@ -46,6 +47,7 @@ void DetectionFilterConfigFree(DetectionFilterConfig* config)
     if (config == NULL)
         return;
 
+    delete config->shared;
     snort_free(config);
 }
 
@@ -83,8 +85,12 @@ void* detection_filter_create(DetectionFilterConfig* df_config, THDX_STRUCT* thd
 
     df_config->count++;
 
+    if ( thdx->shared and !df_config->shared )
+        df_config->shared = new SharedTracker(df_config->memcap, sizeof(THD_SHARED_KEY));
+
     return sfthd_create_rule_threshold(df_config->count, thdx->tracking,
-        thdx->type, thdx->count, thdx->seconds);
+        thdx->type, thdx->count, thdx->seconds,
+        thdx->shared ? df_config->shared : nullptr);
 }
 
 void detection_filter_init(DetectionFilterConfig* df_config)
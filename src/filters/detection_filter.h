@@ -31,12 +31,14 @@
 
 struct sfip_t;
 struct THDX_STRUCT;
+class SharedTracker;
 
 struct DetectionFilterConfig
 {
     int count;
     int memcap;
     int enabled;
+    SharedTracker* shared;  // for filters counted across packet threads
 };
 
 DetectionFilterConfig* DetectionFilterConfigNew();
@@ -34,6 +34,7 @@
 
 #include "sfrf.h"
 #include "sfthd.h"
+#include "shared_tracker.h"
 
 #include "utils/util.h"
 #include "parser/parser.h"
@@ -64,6 +65,7 @@ void RateFilter_ConfigFree(RateFilterConfig* config)
             sfghash_delete(config->genHash[i]);
     }
 
+    delete config->shared;
     snort_free(config);
 }
 
@@ -39,6 +39,7 @@
 #include "hash/sfghash.h"
 #include "hash/sfxhash.h"
 #include "sfip/sf_ipvar.h"
+#include "shared_tracker.h"
 
 // Number of hash rows for gid 1 (rules)
 #define SFRF_GEN_ID_1_ROWS 4096
@@ -116,6 +117,14 @@ static tSFRFTrackingNode* _getSFRFTrackingNode(
     time_t curTime
     );
 
+static int _testSharedObject(
+    RateFilterConfig*,
+    tSFRFConfigNode*,
+    const sfip_t*,
+    time_t,
+    SFRF_COUNT_OPERATION
+    );
+
 static void _updateDependentThresholds(
     RateFilterConfig* config,
     unsigned gid,
@@ -248,6 +257,9 @@ int SFRF_ConfigAdd(
     if ( cfgNode->count < 1 )
         return -1;
 
+    if ( cfgNode->shared and !rf_config->shared )
+        rf_config->shared = new SharedTracker(rf_config->memcap, sizeof(tSFRFTrackingNodeKey));
+
     if ( cfgNode->timeout == 0 )
     {
         if ( rf_config->noRevertCount >= SFRF_NO_REVERT_LIMIT )
@@ -362,6 +374,7 @@ static char* get_netip(const sfip_t* ip)
  *  @retval   0 : Otherwise
  */
 static int SFRF_TestObject(
+    RateFilterConfig* config,
     tSFRFConfigNode* cfgNode,
     const sfip_t* ip,
     time_t curTime,
@@ -371,6 +384,9 @@ static int SFRF_TestObject(
     tSFRFTrackingNode* dynNode;
     int retValue = -1;
 
+    if ( cfgNode->shared )
+        return _testSharedObject(config, cfgNode, ip, curTime, op);
+
     dynNode = _getSFRFTrackingNode(ip, cfgNode->tid, curTime);
 
     if ( dynNode == NULL )
@@ -535,14 +551,14 @@ int SFRF_TestThreshold(
         case SFRF_TRACK_BY_SRC:
             if ( SFRF_AppliesTo(cfgNode, sip) )
             {
-                newStatus = SFRF_TestObject(cfgNode, sip, curTime, op);
+                newStatus = SFRF_TestObject(config, cfgNode, sip, curTime, op);
             }
             break;
 
         case SFRF_TRACK_BY_DST:
             if ( SFRF_AppliesTo(cfgNode, dip) )
             {
-                newStatus = SFRF_TestObject(cfgNode, dip, curTime, op);
+                newStatus = SFRF_TestObject(config, cfgNode, dip, curTime, op);
             }
             break;
 
@@ -550,7 +566,7 @@ int SFRF_TestThreshold(
         {
             sfip_t cleared;
             sfip_clear(cleared);
-            newStatus = SFRF_TestObject(cfgNode, &cleared, curTime, op);
+            newStatus = SFRF_TestObject(config, cfgNode, &cleared, curTime, op);
         }
         break;
 
@@ -823,6 +839,106 @@ static tSFRFTrackingNode* _getSFRFTrackingNode(
     return dynNode;
 }
 
+/* Shared rate_filters count in windows aligned to multiples of seconds with
+ * counts from all packet threads.  The node's mark holds the time the new
+ * action was activated, or 0 if it is not active, and is changed with a CAS
+ * so only one thread reports the activation.
+ *
+ * @returns the same as SFRF_TestObject()
+ */
+static int _testSharedObject(
+    RateFilterConfig* config,
+    tSFRFConfigNode* cfgNode,
+    const sfip_t* ip,
+    time_t curTime,
+    SFRF_COUNT_OPERATION op
+    )
+{
+    tSFRFTrackingNodeKey key;
+    memset(&key, 0, sizeof(key));
+
+    key.ip = *(ip);
+    key.tid = cfgNode->tid;
+    key.policyId = get_network_policy()->policy_id;
+
+    // keep the node while its action may be active
+    unsigned ttl = 0;
+
+    if ( cfgNode->seconds )
+    {
+        ttl = 2 * cfgNode->seconds;
+
+        if ( cfgNode->timeout > ttl )
+            ttl = cfgNode->timeout;
+    }
+
+    // 0 means inactive
+    uint32_t now = curTime ? (uint32_t)curTime : 1;
+    SharedTrackerNode* node = config->shared->find(&key, now, ttl);
+
+    if ( !node )
+        return -1;
+
+    int delta = 0;
+
+    switch (op)
+    {
+    case SFRF_COUNT_INCREMENT:
+        delta = 1;
+        break;
+    case SFRF_COUNT_DECREMENT:
+        // count can be decremented only for total count, and not for rate
+        if ( cfgNode->seconds == 0 )
+            delta = -1;
+        break;
+    case SFRF_COUNT_RESET:
+        SharedTracker::clear(node);
+        break;
+    default:
+        break;
+    }
+
+    uint32_t prev;
+    uint32_t count = SharedTracker::add(node, now, cfgNode->seconds, delta, &prev);
+
+#ifdef SFRF_OVER_RATE
+    bool over = count > cfgNode->count or (cfgNode->seconds and prev > cfgNode->count);
+#else
+    bool over = count > cfgNode->count;
+#endif
+
+    // we drop after the session count has been incremented
+    // but the decrement will never come so we "fix" it here
+    if ( !cfgNode->seconds && count > cfgNode->count )
+        if ( cfgNode->newAction == RULE_TYPE__DROP )
+            SharedTracker::add(node, now, 0, -1);
+
+    uint32_t mark = node->mark.load(std::memory_order_relaxed);
+
+    if ( mark )
+    {
+        if ( !cfgNode->timeout or now - mark < cfgNode->timeout )
+            return cfgNode->newAction;
+
+        if ( over )
+        {
+            node->mark.compare_exchange_strong(mark, now);
+            return cfgNode->newAction;
+        }
+        node->mark.compare_exchange_strong(mark, 0);
+    }
+
+    if ( !over )
+        return -1;
+
+    mark = 0;
+
+    if ( node->mark.compare_exchange_strong(mark, now) )
+        return RULE_TYPE__MAX + cfgNode->newAction;
+
+    return cfgNode->newAction;
+}
+
 #ifdef UNIT_TEST
 // FIXIT-L Catch issue; see sfip/sf_ip.cc
 #include "sfrf_test.cc"
@@ -28,6 +28,7 @@
 #include "actions/actions.h"
 
 struct sfip_t;
+class SharedTracker;
 
 // define to use over rate threshold
 #define SFRF_OVER_RATE
@@ -94,6 +95,9 @@ struct tSFRFConfigNode
 
     // ip set to restrict rate_filter
     sfip_var_t* applyTo;
+
+    // count matches from all packet threads together
+    bool shared;
 };
 
 /* tSFRFSidNode acts as a container of gid+sid based threshold objects,
@@ -142,6 +146,9 @@ struct RateFilterConfig
     int memcap;
 
     int internal_event_mask;
+
+    // tracking nodes for shared rate_filters, created with the first one
+    SharedTracker* shared;
 };
 
 /*
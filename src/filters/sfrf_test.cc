@@ -916,6 +916,7 @@ static void Init(unsigned cap)
         cfg.newAction = (RuleType)RULE_NEW;
         cfg.timeout = p->timeout;
         cfg.applyTo = p->ip ? sfip_var_from_string(p->ip) : NULL;
+        cfg.shared = false;
 
         p->create = SFRF_ConfigAdd(snort_conf, &rfc, &cfg);
     }
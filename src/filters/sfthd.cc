@@ -46,6 +46,7 @@
 #include "hash/sfxhash.h"
 #include "utils/util.h"
 #include "utils/dyn_array.h"
+#include "shared_tracker.h"
 
 //  Debug Printing
 //#define THD_DEBUG
@@ -227,6 +228,7 @@ void sfthd_objs_free(ThresholdObjects* thd_objs)
     if (thd_objs->sfthd_garray != NULL)
         snort_free(thd_objs->sfthd_garray);
 
+    delete thd_objs->shared;
     snort_free(thd_objs);
 }
 
@@ -257,7 +259,8 @@ void* sfthd_create_rule_threshold(int id,
     int tracking,
     int type,
     int count,
-    unsigned int seconds)
+    unsigned int seconds,
+    SharedTracker* shared)
 {
     THD_NODE* sfthd_node = (THD_NODE*)snort_calloc(sizeof(THD_NODE));
 
@@ -266,6 +269,7 @@ void* sfthd_create_rule_threshold(int id,
     sfthd_node->type      = type;
     sfthd_node->count     = count;
     sfthd_node->seconds   = seconds;
+    sfthd_node->shared    = shared;
 
     return (void*)sfthd_node;
 }
@@ -428,6 +432,7 @@ static int sfthd_create_threshold_local(
     sfthd_node->count     = config->count;
     sfthd_node->seconds   = config->seconds;
     sfthd_node->ip_address= config->ip_address;
+    sfthd_node->shared    = config->shared;
 
     if ( config->type == THD_TYPE_SUPPRESS )
     {
@@ -540,6 +545,7 @@ static int sfthd_create_threshold_global(
     sfthd_node->count = config->count;
     sfthd_node->seconds = config->seconds;
     sfthd_node->ip_address = config->ip_address;
+    sfthd_node->shared = config->shared;
 
     /* need a hash of these where
      * key=[gen_id,sig_id] => THD_GNODE_KEY
@@ -611,7 +617,8 @@ int sfthd_create_threshold(
     int priority,
     int count,
     int seconds,
-    sfip_var_t* ip_address)
+    sfip_var_t* ip_address,
+    SharedTracker* shared)
 {
     //allocate memory fpr sfthd_array if needed.
     PolicyId policyId = get_network_policy()->policy_id;
@@ -629,6 +636,7 @@ int sfthd_create_threshold(
     sfthd_node.count     = count;
     sfthd_node.seconds   = seconds;
     sfthd_node.ip_address= ip_address;
+    sfthd_node.shared    = shared;
 
     // FIXIT-L convert to std::vector
     sfDynArrayCheckBounds ((void**)&thd_objs->sfthd_garray, policyId,
@@ -841,6 +849,57 @@ static inline int sfthd_test_non_suppress(
     return 0;  /* should not get here, so log it just to be safe */
 }
 
+/*
+ *  Do the appropriate test for the Threshold Object Type using counts
+ *  shared by all packet threads.  Windows are aligned to multiples of
+ *  seconds so a window change can be made with the count atomically.
+ */
+static int sfthd_test_shared(
+    THD_NODE* sfthd_node,
+    const THD_SHARED_KEY* key,
+    time_t curtime)
+{
+    uint32_t now = (uint32_t)curtime;
+    unsigned seconds = sfthd_node->seconds ? sfthd_node->seconds : 1;
+    SharedTrackerNode* n = sfthd_node->shared->find(key, now, 2 * seconds);
+
+    if ( !n )
+        return 1;  /* table full, check the next threshold object */
+
+    uint32_t prev;
+    uint32_t count = SharedTracker::add(n, now, seconds, 1, &prev);
+    int limit = sfthd_node->count;
+    bool log;
+
+    switch ( sfthd_node->type )
+    {
+    case THD_TYPE_DETECT:
+        log = (int64_t)count > limit or (int64_t)prev > limit;
+        break;
+
+    case THD_TYPE_LIMIT:
+        log = (int64_t)count <= limit;
+        break;
+
+    case THD_TYPE_THRESHOLD:
+        log = limit <= 0 or !(count % limit);
+        break;
+
+    case THD_TYPE_BOTH:
+        log = (int64_t)count == limit;
+        break;
+
+    default:
+        return 0;  /* should not get here, so log it just to be safe */
+    }
+
+    if ( log )
+        return 0;
+
+    sfthd_node->filtered++;
+    return -2;
+}
+
 /*!
  *
  *  Find/Test/Add an event against a single threshold object.
@@ -909,6 +968,18 @@ int sfthd_test_local(
         return sfthd_test_suppress(sfthd_node, ip);
     }
 
+    if ( sfthd_node->shared )
+    {
+        THD_SHARED_KEY skey;
+        memset(&skey, 0, sizeof(skey));
+
+        skey.thd_id = sfthd_node->thd_id;
+        skey.ip = *ip;
+        skey.policyId = policy_id;
+
+        return sfthd_test_shared(sfthd_node, &skey, curtime);
+    }
+
     /*
     *  Go on and do standard thresholding
     */
@@ -1001,6 +1072,19 @@ static inline int sfthd_test_global(
         return sfthd_test_suppress(sfthd_node, ip);
     }
 
+    if ( sfthd_node->shared )
+    {
+        THD_SHARED_KEY skey;
+        memset(&skey, 0, sizeof(skey));
+
+        skey.thd_id = sfthd_node->thd_id;
+        skey.sig_id = sig_id;
+        skey.ip = *ip;
+        skey.policyId = policy_id;
+
+        return sfthd_test_shared(sfthd_node, &skey, curtime);
+    }
+
     /*
     *  Go on and do standard thresholding
     */
@@ -33,6 +33,8 @@
 #include "main/policy.h"
 #include "sfip/sfip_t.h"
 
+class SharedTracker;
+
 /*!
     Max GEN_ID value - Set this to the Max Used by Snort, this is used for the
     dimensions of the gen_id lookup array.
@@ -110,6 +112,21 @@ typedef struct
     PolicyId policyId;
 } THD_IP_GNODE_KEY;
 
+/*!
+    THD_SHARED_KEY
+
+    Key for nodes counted across packet threads.  sig_id is zero except
+    for global thresholds which count each sig_id separately.  Keys are
+    compared as bytes so they must be zeroed before use.
+*/
+typedef struct
+{
+    int thd_id;
+    unsigned sig_id;
+    sfip_t ip;
+    PolicyId policyId;
+} THD_SHARED_KEY;
+
 /*!
     THD_NODE
 
@@ -129,6 +146,7 @@ typedef struct
     unsigned seconds;
     uint64_t filtered;
     sfip_var_t* ip_address;
+    SharedTracker* shared;  /* count across packet threads if set */
 } THD_NODE;
 
 /*!
@@ -165,6 +183,7 @@ struct THDX_STRUCT
     int count;
     unsigned int seconds;
     sfip_var_t* ip_address;
+    bool shared;
 };
 
 typedef struct
@@ -202,6 +221,9 @@ struct ThresholdObjects
     //THD_NODE * (*sfthd_garray)[THD_MAX_GENID];
     THD_NODE*** sfthd_garray;
     PolicyId numPoliciesAllocated;
+
+    /* Counts for shared thresholds, created with the first one */
+    SharedTracker* shared;
 };
 
 /*
@@ -224,7 +246,8 @@ void* sfthd_create_rule_threshold(
     int tracking,
     int type,
     int count,
-    unsigned int seconds
+    unsigned int seconds,
+    SharedTracker* shared = nullptr
     );
 
 struct SnortConfig;
@@ -238,7 +261,8 @@ int sfthd_create_threshold(
     int priority,
     int count,
     int seconds,
-    sfip_var_t* ip_address
+    sfip_var_t* ip_address,
+    SharedTracker* shared = nullptr
     );
 
 //  1: don't log due to event_filter
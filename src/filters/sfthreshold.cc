@@ -44,6 +44,7 @@
 #include <string.h>
 
 #include "sfthd.h"
+#include "shared_tracker.h"
 #include "main/snort_config.h"
 #include "utils/util.h"
 #include "parser/parser.h"
@@ -285,6 +286,13 @@ int sfthreshold_create(
             return -1;
     }
 
+    /* Shared counts are owned by the config so they start over on reload */
+    if ( thdx->shared and !thd_config->thd_objs->shared )
+    {
+        thd_config->thd_objs->shared =
+            new SharedTracker(thd_config->memcap, sizeof(THD_SHARED_KEY));
+    }
+
     /* print_thdx( thdx ); */
 
     /* Add the object to the table - */
@@ -297,7 +305,8 @@ int sfthreshold_create(
         thdx->priority,
         thdx->count,
         thdx->seconds,
-        thdx->ip_address);
+        thdx->ip_address,
+        thdx->shared ? thd_config->thd_objs->shared : nullptr);
 }
 
 /*
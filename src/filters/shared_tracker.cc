@@ -0,0 +1,415 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "shared_tracker.h"
+
+#include <string.h>
+
+#ifdef UNIT_TEST
+#include <thread>
+#include <vector>
+#include "catch/catch.hpp"
+#endif
+
+// tags of claimed slots are even and at least 2
+#define SLOT_EMPTY 0
+#define SLOT_BUSY  1
+
+#define MIN_SHARD_SIZE 16
+#define MAX_SHARDS     64
+#define MAX_PROBES     64
+
+#define NEVER 0xFFFFFFFF
+
+// expires while the slot is being reused
+#define RECLAIM 0
+
+//-------------------------------------------------------------------------
+// private stuff
+//-------------------------------------------------------------------------
+
+static uint64_t hash_key(const uint8_t* k, unsigned n)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        h ^= k[i];
+        h *= 0x100000001b3ull;
+    }
+
+    // fnv is weak in the high bits which select the shard
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+
+    return h;
+}
+
+static inline uint32_t expiration(uint32_t now, unsigned ttl)
+{ return (ttl and now + ttl > now) ? now + ttl : NEVER; }
+
+static inline bool expired(uint32_t expires, uint32_t now)
+{ return expires != RECLAIM and now > expires; }
+
+void SharedTracker::init_node(unsigned idx, const void* key, uint64_t tag, uint32_t exp)
+{
+    memcpy(keys + (size_t)idx * key_size, key, key_size);
+
+    SharedTrackerNode& n = nodes[idx];
+    n.window.store(0, std::memory_order_relaxed);
+    n.prev.store(0, std::memory_order_relaxed);
+    n.mark.store(0, std::memory_order_relaxed);
+
+    n.expires.store(exp, std::memory_order_release);
+    tags[idx].store(tag, std::memory_order_release);
+}
+
+// extends the expiration unless the slot is being reused and then checks
+// that the slot still holds key.  once the expiration is extended only a
+// thread whose now is past it can reuse the slot.
+bool SharedTracker::keep_node(unsigned idx, const void* key, uint64_t tag, uint32_t exp)
+{
+    std::atomic<uint32_t>& expires = nodes[idx].expires;
+    uint32_t e = expires.load(std::memory_order_acquire);
+
+    while ( e != RECLAIM and !expires.compare_exchange_weak(
+        e, e > exp ? e : exp, std::memory_order_acq_rel, std::memory_order_acquire) )
+        ;
+
+    if ( e == RECLAIM )
+        return false;
+
+    return tags[idx].load(std::memory_order_acquire) == tag and
+        !memcmp(keys + (size_t)idx * key_size, key, key_size);
+}
+
+//-------------------------------------------------------------------------
+// public stuff
+//-------------------------------------------------------------------------
+
+SharedTracker::SharedTracker(unsigned memcap, unsigned ksize)
+{
+    key_size = ksize;
+
+    size_t per_node = sizeof(SharedTrackerNode) + key_size + sizeof(*tags);
+    unsigned n = memcap / per_node;
+
+    if ( n < MIN_SHARD_SIZE )
+        n = MIN_SHARD_SIZE;
+
+    unsigned num_shards = 1;
+    shard_bits = 0;
+
+    while ( num_shards < MAX_SHARDS and n / (num_shards * 2) >= MIN_SHARD_SIZE )
+    {
+        num_shards *= 2;
+        ++shard_bits;
+    }
+
+    shard_size = n / num_shards;
+    num_nodes = shard_size * num_shards;
+    max_probes = shard_size < MAX_PROBES ? shard_size : MAX_PROBES;
+
+    tags = new std::atomic<uint64_t>[num_nodes];
+    keys = new uint8_t[(size_t)num_nodes * key_size];
+    nodes = new SharedTrackerNode[num_nodes];
+
+    for ( unsigned i = 0; i < num_nodes; ++i )
+    {
+        tags[i].store(SLOT_EMPTY, std::memory_order_relaxed);
+        nodes[i].expires.store(RECLAIM, std::memory_order_relaxed);
+    }
+}
+
+SharedTracker::~SharedTracker()
+{
+    delete[] tags;
+    delete[] keys;
+    delete[] nodes;
+}
+
+SharedTrackerNode* SharedTracker::find(const void* key, uint32_t now, unsigned ttl)
+{
+    const uint32_t exp = expiration(now, ttl);
+    const uint64_t hash = hash_key((const uint8_t*)key, key_size);
+    const uint64_t tag = (hash | 2) & ~(uint64_t)SLOT_BUSY;
+
+    const unsigned base = shard_bits ? (unsigned)(hash >> (64 - shard_bits)) * shard_size : 0;
+    const unsigned start = (unsigned)hash % shard_size;
+
+    while ( true )
+    {
+        unsigned reuse = num_nodes;
+        uint32_t reuse_exp = 0;
+        bool retry = false;
+
+        for ( unsigned p = 0; p < max_probes; ++p )
+        {
+            const unsigned idx = base + (start + p) % shard_size;
+            uint64_t t = tags[idx].load(std::memory_order_acquire);
+
+            // another thread is writing the key
+            while ( t == SLOT_BUSY )
+                t = tags[idx].load(std::memory_order_acquire);
+
+            if ( t == SLOT_EMPTY )
+            {
+                if ( reuse < num_nodes )
+                    break;
+
+                if ( tags[idx].compare_exchange_strong(t, SLOT_BUSY, std::memory_order_acq_rel) )
+                {
+                    init_node(idx, key, tag, exp);
+                    return nodes + idx;
+                }
+                // lost the race, possibly to this key
+                retry = true;
+                break;
+            }
+
+            if ( t == tag and !memcmp(keys + (size_t)idx * key_size, key, key_size) )
+            {
+                if ( keep_node(idx, key, tag, exp) )
+                    return nodes + idx;
+
+                // reused for another key
+                retry = true;
+                break;
+            }
+
+            if ( reuse == num_nodes )
+            {
+                uint32_t e = nodes[idx].expires.load(std::memory_order_acquire);
+
+                if ( expired(e, now) )
+                {
+                    reuse = idx;
+                    reuse_exp = e;
+                }
+            }
+        }
+
+        if ( retry )
+            continue;
+
+        if ( reuse == num_nodes )
+            return nullptr;
+
+        // the expiration is the claim so that a thread which found the
+        // old key either extends it first or sees that it was reused
+        if ( nodes[reuse].expires.compare_exchange_strong(
+            reuse_exp, RECLAIM, std::memory_order_acq_rel) )
+        {
+            tags[reuse].store(SLOT_BUSY, std::memory_order_release);
+            init_node(reuse, key, tag, exp);
+            return nodes + reuse;
+        }
+    }
+}
+
+uint32_t SharedTracker::add(
+    SharedTrackerNode* n, uint32_t now, unsigned seconds, int delta, uint32_t* prev)
+{
+    const uint32_t ws = seconds ? now - now % seconds : 0;
+    uint64_t cur = n->window.load(std::memory_order_relaxed);
+
+    uint32_t start, count, last;
+    bool rolled;
+
+    while ( true )
+    {
+        start = (uint32_t)(cur >> 32);
+        count = last = (uint32_t)cur;
+
+        // late timestamps from other threads count in the current window
+        rolled = ws > start;
+
+        if ( rolled )
+            count = 0;
+
+        if ( delta > 0 )
+            count = (count + delta < count) ? NEVER : count + delta;
+
+        else if ( delta < 0 )
+            count = (count > (uint32_t)-delta) ? count + delta : 0;
+
+        uint64_t next = ((uint64_t)(rolled ? ws : start) << 32) | count;
+
+        if ( next == cur or n->window.compare_exchange_weak(
+            cur, next, std::memory_order_acq_rel, std::memory_order_relaxed) )
+            break;
+    }
+
+    if ( rolled )
+    {
+        bool adjacent = start and start + seconds == ws;
+        n->prev.store(adjacent ? last : 0, std::memory_order_relaxed);
+    }
+
+    if ( prev )
+        *prev = n->prev.load(std::memory_order_relaxed);
+
+    return count;
+}
+
+void SharedTracker::clear(SharedTrackerNode* n)
+{
+    uint64_t cur = n->window.load(std::memory_order_relaxed);
+
+    while ( !n->window.compare_exchange_weak(
+        cur, cur & ~(uint64_t)0xFFFFFFFF, std::memory_order_acq_rel, std::memory_order_relaxed) )
+        ;
+}
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+TEST_CASE("find and add", "[SharedTracker]")
+{
+    SharedTracker st(64 * 1024, sizeof(uint32_t));
+    uint32_t k1 = 1, k2 = 2;
+
+    SharedTrackerNode* n1 = st.find(&k1, 100, 20);
+    SharedTrackerNode* n2 = st.find(&k2, 100, 0);
+
+    REQUIRE(n1);
+    REQUIRE(n2);
+    CHECK(n1 != n2);
+    CHECK(st.find(&k1, 101, 20) == n1);
+
+    uint32_t prev;
+    CHECK(SharedTracker::add(n1, 100, 10, 1) == 1);
+    CHECK(SharedTracker::add(n1, 109, 10, 1) == 2);
+    CHECK(SharedTracker::add(n1, 99, 10, 1) == 3);
+
+    // next window remembers the last
+    CHECK(SharedTracker::add(n1, 110, 10, 1, &prev) == 1);
+    CHECK(prev == 3);
+
+    // skipping a window forgets it
+    CHECK(SharedTracker::add(n1, 130, 10, 1, &prev) == 1);
+    CHECK(prev == 0);
+
+    CHECK(SharedTracker::add(n1, 130, 10, -5) == 0);
+    CHECK(SharedTracker::add(n1, 130, 10, 0) == 0);
+
+    // zero seconds never rolls
+    CHECK(SharedTracker::add(n2, 100, 0, 1) == 1);
+    CHECK(SharedTracker::add(n2, 5000, 0, 1) == 2);
+    SharedTracker::clear(n2);
+    CHECK(SharedTracker::add(n2, 5000, 0, 0) == 0);
+}
+
+TEST_CASE("full and reuse", "[SharedTracker]")
+{
+    SharedTracker st(0, sizeof(uint32_t));
+    REQUIRE(st.get_max_nodes() == 16);
+
+    for ( uint32_t k = 0; k < 16; ++k )
+    {
+        SharedTrackerNode* n = st.find(&k, 100, 2);
+        REQUIRE(n);
+        SharedTracker::add(n, 100, 1, 1);
+    }
+
+    uint32_t k = 16;
+    CHECK(!st.find(&k, 101, 2));
+
+    // all expired after 102
+    SharedTrackerNode* n = st.find(&k, 103, 2);
+    REQUIRE(n);
+    CHECK(SharedTracker::add(n, 103, 1, 1) == 1);
+    CHECK(st.find(&k, 103, 2) == n);
+}
+
+TEST_CASE("found is kept", "[SharedTracker]")
+{
+    SharedTracker st(0, sizeof(uint32_t));
+    SharedTrackerNode* nodes[16];
+
+    for ( uint32_t k = 0; k < 16; ++k )
+    {
+        nodes[k] = st.find(&k, 100, 2);
+        REQUIRE(nodes[k]);
+    }
+
+    // finding an expired key keeps it before add() is called
+    uint32_t k = 5;
+    CHECK(st.find(&k, 103, 2) == nodes[5]);
+
+    for ( k = 16; k < 31; ++k )
+    {
+        SharedTrackerNode* n = st.find(&k, 103, 2);
+        REQUIRE(n);
+        CHECK(n != nodes[5]);
+    }
+
+    k = 31;
+    CHECK(!st.find(&k, 103, 2));
+}
+
+TEST_CASE("threads", "[SharedTracker]")
+{
+    const unsigned num_threads = 4;
+    const unsigned num_events = 10000;
+    const uint32_t limit = 1234;
+
+    SharedTracker st(1024 * 1024, sizeof(uint32_t));
+    std::vector<std::thread*> threads;
+    std::atomic<unsigned> allowed(0);
+
+    for ( unsigned t = 0; t < num_threads; ++t )
+    {
+        threads.push_back(new std::thread([&]()
+        {
+            for ( uint32_t i = 0; i < num_events; ++i )
+            {
+                uint32_t key = i % 8;
+                SharedTrackerNode* n = st.find(&key, 100, 120);
+
+                if ( key == 0 and SharedTracker::add(n, 100, 60, 1) <= limit )
+                    ++allowed;
+            }
+        }));
+    }
+
+    for ( auto* t : threads )
+    {
+        t->join();
+        delete t;
+    }
+
+    // a limit holds across threads
+    CHECK(allowed == limit);
+
+    for ( uint32_t key = 0; key < 8; ++key )
+    {
+        SharedTrackerNode* n = st.find(&key, 100, 120);
+        uint32_t expect = key ? 0 : num_threads * num_events / 8;
+        CHECK(SharedTracker::add(n, 100, 60, 0) == expect);
+    }
+}
+#endif
+
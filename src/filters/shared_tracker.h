@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef SHARED_TRACKER_H
+#define SHARED_TRACKER_H
+
+// SharedTracker counts events by key for all packet threads together so
+// that a filter of N per interval allows N events per interval in total
+// rather than N per thread.  It has no locks.
+//
+// The table is a fixed number of nodes split into shards by hash.  A key
+// is inserted by claiming an empty slot in its shard with a CAS.  Slots
+// are never emptied so a lookup stops at the first empty slot.  A slot
+// whose node has expired may be claimed for another key by a CAS on its
+// expiration.  find() extends the expiration with a CAS before checking
+// the key again so a node it returns can't be reused until then.
+//
+// Each node counts events in fixed windows of the given number of
+// seconds, aligned to multiples of seconds.  The window start and count
+// are packed in one 64 bit word which is updated with a CAS so a window
+// change and an increment can't race.  Zero seconds means one window
+// that never ends.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+struct SharedTrackerNode
+{
+    std::atomic<uint64_t> window;   // window start << 32 | count
+    std::atomic<uint32_t> prev;     // count in the window before, if adjacent
+    std::atomic<uint32_t> mark;     // set by users, eg when an action started
+    std::atomic<uint32_t> expires;  // slot may be reused after this time
+    uint32_t pad;
+};
+
+class SharedTracker
+{
+public:
+    // memcap limits the number of keys; keys are compared as bytes so
+    // any padding must be cleared
+    SharedTracker(unsigned memcap, unsigned key_size);
+    ~SharedTracker();
+
+    // returns the node for key, adding it if needed, or nullptr if the
+    // key's shard is full.  the node may be reused for another key after
+    // ttl idle seconds; zero means never.
+    SharedTrackerNode* find(const void* key, uint32_t now, unsigned ttl);
+
+    // counts delta events (which may be negative or zero) in the window
+    // containing now and returns the resulting count.  prev is set to the
+    // count in the previous window if it was adjacent.
+    static uint32_t add(
+        SharedTrackerNode*, uint32_t now, unsigned seconds, int delta,
+        uint32_t* prev = nullptr);
+
+    // zeroes the count in the current window
+    static void clear(SharedTrackerNode*);
+
+    unsigned get_max_nodes() const
+    { return num_nodes; }
+
+private:
+    void init_node(unsigned idx, const void* key, uint64_t tag, uint32_t exp);
+    bool keep_node(unsigned idx, const void* key, uint64_t tag, uint32_t exp);
+
+private:
+    unsigned key_size;
+    unsigned num_nodes;
+    unsigned shard_size;
+    unsigned max_probes;
+    unsigned shard_bits;
+
+    std::atomic<uint64_t>* tags;
+    uint8_t* keys;
+    SharedTrackerNode* nodes;
+};
+
+#endif
+
@@ -70,6 +70,9 @@ struct ExpectNode
     ExpectFlow* head = nullptr;
     ExpectFlow* tail = nullptr;
 
+    const void* key = nullptr;
+    TimerNode timer = { };
+
     void clear(ExpectFlow*&);
 };
 
@@ -145,11 +148,19 @@ void ExpectCache::prune()
         if ( !node || now <= node->expires )
             break;
 
+        disarm(node);
+        node->clear(free_list);
         hash_table->remove();
         ++prunes;
     }
 }
 
+inline void ExpectCache::disarm(ExpectNode* node)
+{
+    if ( timers )
+        timers->cancel(&node->timer);
+}
+
 inline ExpectNode* ExpectCache::get_node(ExpectKey& key, bool& init)
 {
     ExpectNode* node;
@@ -256,15 +267,17 @@ inline bool ExpectCache::set_data(ExpectNode* node, ExpectFlow*& last, FlowData*
 // public ExpectCache methods
 //-------------------------------------------------------------------------
 
-ExpectCache::ExpectCache (uint32_t max)
+ExpectCache::ExpectCache (uint32_t max, TimerWheel* tw)
 {
+    timers = tw;
+
     // -size forces use of abs(size) ie w/o bumping up
     hash_table = new ZHash(-MAX_HASH, sizeof(ExpectKey));
 
     nodes = new ExpectNode[max];
 
     for ( unsigned i = 0; i < max; ++i )
-        hash_table->push(nodes+i);
+        nodes[i].key = hash_table->push(nodes+i);
 
     max *= MAX_LIST;
 
@@ -346,6 +359,15 @@ int ExpectCache::add_flow(
     node->expires = packet_time() + MAX_WAIT;
     ++expects;
 
+    // expires is the last second the node is valid
+    if ( timers )
+    {
+        if ( node->timer.armed() )
+            TimerWheel::extend(&node->timer, node->expires + 1);
+        else
+            timers->schedule(&node->timer, this, node, node->expires + 1);
+    }
+
     return 0;
 }
 
@@ -393,6 +415,8 @@ bool ExpectCache::is_expected(Packet* p)
     // src and dst ports are known.
     if ( !node->head || (p->pkth->ts.tv_sec > node->expires) )
     {
+        disarm(node);
+        node->clear(free_list);
         hash_table->remove();
         return false;
     }
@@ -449,7 +473,10 @@ char ExpectCache::process_expected(Packet* p, Flow* lws)
     }
 
     if ( !node->count )
+    {
+        disarm(node);
         hash_table->remove();
+    }
 
     return retVal;
 }
@@ -462,3 +489,12 @@ char ExpectCache::check(Packet* p, Flow* lws)
     return process_expected(p, lws);
 }
 
+void ExpectCache::expire(TimerNode* n, uint32_t)
+{
+    ExpectNode* node = (ExpectNode*)n->owner;
+
+    node->clear(free_list);
+    hash_table->remove(node->key);
+    ++prunes;
+}
+
@@ -55,6 +55,9 @@
 // -- matching expected sessions are pulled off from the head of the node's
 //    list struct chain
 //
+// -- nodes are put on the timer wheel when added and removed when they
+//    expire; prune() remains for when the wheel is behind
+//
 // FIXIT-M expiration is by node struct but should be by list struct, ie
 //    individual sessions, not all sessions to a given 3-tuple
 //    (this would make pruning a little harder unless we add linkage
@@ -63,13 +66,14 @@
 
 #include "sfip/sfip_t.h"
 #include "flow/flow.h"
+#include "time/timer_wheel.h"
 
 struct Packet;
 
-class ExpectCache
+class ExpectCache : public TimerHandler
 {
 public:
-    ExpectCache(uint32_t max);
+    ExpectCache(uint32_t max, TimerWheel* = nullptr);
     ~ExpectCache();
 
     int add_flow(
@@ -81,6 +85,8 @@ public:
     char process_expected(Packet*, Flow*);
     char check(Packet*, Flow*);
 
+    void expire(TimerNode*, uint32_t now) override;
+
     unsigned long get_expects() { return expects; }
     unsigned long get_realized() { return realized; }
     unsigned long get_prunes() { return prunes; }
@@ -88,6 +94,7 @@ public:
 
 private:
     void prune();
+    void disarm(struct ExpectNode*);
 
     struct ExpectNode* get_node(struct ExpectKey&, bool&);
     struct ExpectFlow* get_flow(ExpectNode*, uint32_t, int16_t);
@@ -95,6 +102,7 @@ private:
 
 private:
     class ZHash* hash_table;
+    TimerWheel* timers;
     struct ExpectNode* nodes;
     struct ExpectFlow* pool, * free_list;
     sfip_t zeroed;
@@ -34,6 +34,7 @@
 #include "flow/flow_key.h"
 #include "framework/inspector.h"
 #include "framework/codec.h"
+#include "time/timer_wheel.h"
 
 #define SSNFLAG_SEEN_CLIENT         0x00000001
 #define SSNFLAG_SEEN_SENDER         0x00000001
@@ -305,6 +306,7 @@ public:  // FIXIT-M privatize if possible
     Inspector* ssn_client;
     Inspector* ssn_server;
     long last_data_seen;
+    TimerNode timer;  // armed while in a cache with timeouts
 
     // everything from here down is zeroed
     FlowData* appDataList;
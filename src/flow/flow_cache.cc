@@ -24,7 +24,7 @@
 #include "config.h"
 #endif
 
-#include "hash/zhash.h"
+#include "hash/clock_hash.h"
 #include "helpers/flag_context.h"
 #include "ips_options/ips_flowbits.h"
 #include "main/snort_debug.h"
@@ -33,11 +33,15 @@
 
 #define SESSION_CACHE_FLAG_PURGING  0x01
 
+// the clock doesn't keep flows sorted by time so stale flows must be
+// found by scanning; this bounds the flows checked per call
+static const unsigned max_stale_scan = 64;
+
 //-------------------------------------------------------------------------
 // FlowCache stuff
 //-------------------------------------------------------------------------
 
-FlowCache::FlowCache (const FlowConfig& cfg) : config(cfg)
+FlowCache::FlowCache (const FlowConfig& cfg, TimerWheel* tw) : config(cfg), timers(tw)
 {
     cleanup_flows = cfg.max_sessions * cfg.cleanup_pct / 100;
     if ( cleanup_flows == 0 )
@@ -46,8 +50,8 @@ FlowCache::FlowCache (const FlowConfig& cfg) : config(cfg)
     assert(cleanup_flows <= cfg.max_sessions);
     assert(cleanup_flows > 0);
 
-    hash_table = new ZHash(config.max_sessions, sizeof(FlowKey));
-    hash_table->set_keyops(FlowKey::hash, FlowKey::compare);
+    hash_table = new ClockHash(
+        config.max_sessions, sizeof(FlowKey), FlowKey::hash, FlowKey::compare);
 
     uni_head = new Flow;
     uni_tail = new Flow;
@@ -83,6 +87,11 @@ unsigned FlowCache::get_count()
     return hash_table ? hash_table->get_count() : 0;
 }
 
+void FlowCache::prefetch(const FlowKey* key) const
+{
+    hash_table->prefetch(key);
+}
+
 Flow* FlowCache::find(const FlowKey* key)
 {
     Flow* flow = (Flow*)hash_table->find(key);
@@ -142,6 +151,9 @@ Flow* FlowCache::get(const FlowKey* key)
         assert(flow);
         flow->reset();
         link_uni(flow);
+
+        if ( timers )
+            timers->schedule(&flow->timer, this, flow, timestamp + config.nominal_timeout);
     }
 
     flow->last_data_seen = timestamp;
@@ -161,6 +173,9 @@ int FlowCache::remove(Flow* flow)
     if ( flow->next )
         unlink_uni(flow);
 
+    if ( timers )
+        timers->cancel(&flow->timer);
+
     return hash_table->remove(flow->key);
 }
 
@@ -169,38 +184,29 @@ unsigned FlowCache::prune_stale(uint32_t thetime, const Flow* save_me)
     ActiveSuspendContext act_susp;
 
     unsigned pruned = 0;
-    auto flow = static_cast<Flow*>(hash_table->first());
+    unsigned scanned = 0;
+    unsigned max_scan = hash_table->get_count();
 
-    while ( flow and pruned <= cleanup_flows )
+    if ( max_scan > max_stale_scan )
+        max_scan = max_stale_scan;
+
+    while ( pruned <= cleanup_flows and scanned++ < max_scan )
     {
-#if 0
-        // FIXIT-H this loops forever if 1 flow in cache
-        if (flow == save_me)
-        {
+        auto flow = static_cast<Flow*>(hash_table->scan());
+
+        if ( !flow )
             break;
-            if ( hash_table->get_count() == 1 )
-                break;
 
-            hash_table->touch();
-        }
-#else
-        // Reached the current flow. This *should* be the newest flow
         if ( flow == save_me )
-        {
-            // assert( flow->last_data_seen + config.pruning_timeout >= thetime );
-            // bool rv = hash_table->touch(); assert( !rv );
-            break;
-        }
-#endif
+            continue;
+
         if ( flow->last_data_seen + config.pruning_timeout >= thetime )
-            break;
+            continue;
 
         DebugMessage(DEBUG_STREAM, "pruning stale flow\n");
         flow->ssn_state.session_flags |= SSNFLAG_TIMEDOUT;
         release(flow, PruneReason::TIMEOUT);
         ++pruned;
-
-        flow = static_cast<Flow*>(hash_table->first());
     }
 
     return pruned;
@@ -242,9 +248,14 @@ unsigned FlowCache::prune_excess(const Flow* save_me)
     unsigned pruned = 0;
     unsigned blocks = 0;
 
-    while ( hash_table->get_count() > max_cap and hash_table->get_count() > blocks )
+    // every flow is passed at most twice, once to clear its reference
+    unsigned max_steps = 2 * hash_table->get_count() + 1;
+
+    while ( hash_table->get_count() > max_cap and hash_table->get_count() > blocks
+        and max_steps-- )
     {
-        auto flow = static_cast<Flow*>(hash_table->first());
+        bool referenced;
+        auto flow = static_cast<Flow*>(hash_table->sweep(referenced));
         assert(flow); // holds true because hash_table->get_count() > 0
 
         if ( (save_me and flow == save_me) or flow->was_blocked() )
@@ -253,14 +264,8 @@ unsigned FlowCache::prune_excess(const Flow* save_me)
             // "called C++ object pointer is null" here
             if ( flow->was_blocked() )
                 ++blocks;
-
-            // FIXIT-M we should update last_data_seen upon touch to ensure
-            // the hash_table LRU list remains sorted by time
-            if ( !hash_table->touch() )
-                break;
         }
-
-        else
+        else if ( !referenced )
         {
             flow->ssn_state.session_flags |= SSNFLAG_PRUNED;
             release(flow, PruneReason::EXCESS);
@@ -271,15 +276,31 @@ unsigned FlowCache::prune_excess(const Flow* save_me)
     return pruned;
 }
 
-bool FlowCache::prune_one(PruneReason reason, bool do_cleanup)
+// referenced flows get a second chance; save_me (the current flow) and
+// blocked flows are never released here
+bool FlowCache::prune_one(PruneReason reason, bool do_cleanup, const Flow* save_me)
 {
+    // every flow is passed at most twice, once to clear its reference
+    unsigned max_steps = 2 * hash_table->get_count();
+    Flow* flow = nullptr;
 
-    // so we don't prune the current flow (assume current == MRU)
-    if ( hash_table->get_count() <= 1 )
-        return false;
+    while ( max_steps-- )
+    {
+        bool referenced;
+        auto f = static_cast<Flow*>(hash_table->sweep(referenced));
+
+        if ( !f )
+            break;
+
+        if ( referenced or f == save_me or f->was_blocked() )
+            continue;
+
+        flow = f;
+        break;
+    }
 
-    auto flow = static_cast<Flow*>(hash_table->first());
-    assert(flow);
+    if ( !flow )
+        return false;
 
     flow->ssn_state.session_flags |= SSNFLAG_PRUNED;
     release(flow, reason, do_cleanup);
@@ -296,31 +317,23 @@ bool FlowCache::prune_one(PruneReason reason, bool do_cleanup)
     return true;
 }
 
-unsigned FlowCache::timeout(unsigned num_flows, time_t thetime)
+// the timer is set when the flow is created and isn't moved as packets
+// arrive; last_data_seen is checked here and the timer set again if the
+// flow was active
+void FlowCache::expire(TimerNode* n, uint32_t thetime)
 {
-    // FIXIT-H should Active be suspended here too?
-    unsigned retired = 0;
-
-    auto flow = static_cast<Flow*>(hash_table->current());
+    Flow* flow = (Flow*)n->owner;
+    uint32_t when = flow->last_data_seen + config.nominal_timeout;
 
-    if ( !flow )
-        flow = static_cast<Flow*>(hash_table->first());
-
-    while ( flow and retired < num_flows )
+    if ( when > thetime )
     {
-        if ( flow->last_data_seen + config.nominal_timeout > thetime )
-            break;
-
-        DebugMessage(DEBUG_STREAM, "retiring stale flow\n");
-        flow->ssn_state.session_flags |= SSNFLAG_TIMEDOUT;
-        release(flow, PruneReason::TIMEOUT);
-
-        ++retired;
-
-        flow = static_cast<Flow*>(hash_table->current());
+        timers->schedule(n, this, flow, when);
+        return;
     }
 
-    return retired;
+    DebugMessage(DEBUG_STREAM, "retiring stale flow\n");
+    flow->ssn_state.session_flags |= SSNFLAG_TIMEDOUT;
+    release(flow, PruneReason::TIMEOUT);
 }
 
 // Remove all flows from the hash table.
@@ -331,7 +344,9 @@ unsigned FlowCache::purge()
 
     unsigned retired = 0;
 
-    while ( auto flow = static_cast<Flow*>(hash_table->first()) )
+    bool referenced;
+
+    while ( auto flow = static_cast<Flow*>(hash_table->sweep(referenced)) )
     {
         flow->ssn_state.session_flags |= SSNFLAG_PRUNED;
         release(flow, PruneReason::PURGE);
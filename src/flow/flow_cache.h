@@ -23,26 +23,32 @@
 #define FLOW_CACHE_H
 
 // there is a FlowCache instance for each protocol.
-// Flows are stored in a ZHash instance by FlowKey.
+// Flows are stored in a ClockHash instance by FlowKey.  Eviction is
+// approximate LRU via the clock hand instead of a strict LRU list so
+// lookups never relink anything.  Flows are also put on the thread's
+// timer wheel when created so idle flows are found without scanning.
 
 #include <ctime>
 #include <type_traits>
 
 #include "flow_config.h"
 #include "prune_stats.h"
+#include "time/timer_wheel.h"
 
 class Flow;
 struct FlowKey;
 
-class FlowCache
+class FlowCache : public TimerHandler
 {
 public:
-    FlowCache(const FlowConfig&);
+    // without timers flows are only pruned, never timed out
+    FlowCache(const FlowConfig&, TimerWheel* = nullptr);
 
     ~FlowCache();
 
     void push(Flow*);
 
+    void prefetch(const FlowKey*) const;
     Flow* find(const FlowKey*);
     Flow* get(const FlowKey*);
 
@@ -51,8 +57,9 @@ public:
     unsigned prune_unis();
     unsigned prune_stale(uint32_t thetime, const Flow* save_me);
     unsigned prune_excess(const Flow* save_me);
-    bool prune_one(PruneReason, bool do_cleanup);
-    unsigned timeout(unsigned num_flows, time_t cur_time);
+    bool prune_one(PruneReason, bool do_cleanup, const Flow* save_me = nullptr);
+
+    void expire(TimerNode*, uint32_t now) override;
 
     unsigned purge();
     unsigned get_count();
@@ -81,7 +88,8 @@ private:
     unsigned uni_count;
     uint32_t flags;
 
-    class ZHash* hash_table;
+    class ClockHash* hash_table;
+    TimerWheel* timers;
     Flow* uni_head, * uni_tail;
     PruneStats prune_stats;
 };
@@ -34,6 +34,7 @@
 #include "protocols/udp.h"
 #include "protocols/vlan.h"
 #include "sfip/sf_ip.h"
+#include "time/timer_wheel.h"
 
 #include "expect_cache.h"
 #include "flow_cache.h"
@@ -49,6 +50,7 @@ FlowControl::FlowControl()
     user_cache = nullptr;
     file_cache = nullptr;
     exp_cache = nullptr;
+    timers = new TimerWheel;
 
     ip_mem = icmp_mem = nullptr;
     tcp_mem = udp_mem = nullptr;
@@ -59,10 +61,15 @@ FlowControl::FlowControl()
     get_user = get_file = nullptr;
 
     last_pkt_type = PktType::NONE;
+    last_flow = nullptr;
 }
 
 FlowControl::~FlowControl()
 {
+    // timer nodes live in the flows, sessions, and expected nodes freed
+    // below so the wheel lets go of them first
+    timers->clear();
+
     delete ip_cache;
     delete icmp_cache;
     delete tcp_cache;
@@ -77,6 +84,8 @@ FlowControl::~FlowControl()
     snort_free(udp_mem);
     snort_free(user_mem);
     snort_free(file_mem);
+
+    delete timers;
 }
 
 //-------------------------------------------------------------------------
@@ -186,6 +195,26 @@ inline const FlowCache* FlowControl::get_cache (PktType type) const
     }
 }
 
+// only worth the extra key setup when the cache won't fit in llc
+static const unsigned min_prefetch_flows = 65536;
+
+// called for batched packets a few ahead of the one being inspected so the
+// bucket is in cache by the time stream gets the flow
+void FlowControl::prefetch_flow(Packet* p)
+{
+    if ( !p->has_ip() )
+        return;
+
+    FlowCache* cache = get_cache(p->type());
+
+    if ( !cache or cache->get_max_flows() < min_prefetch_flows )
+        return;
+
+    FlowKey key;
+    set_key(&key, p);
+    cache->prefetch(&key);
+}
+
 Flow* FlowControl::find_flow(const FlowKey* key)
 {
     FlowCache* cache = get_cache(key->pkt_type);
@@ -260,31 +289,13 @@ void FlowControl::prune_flows(PktType type, const Packet* p)
 bool FlowControl::prune_one(PruneReason reason, bool do_cleanup)
 {
     auto cache = get_cache(last_pkt_type);
-    return cache ? cache->prune_one(reason, do_cleanup) : false;
+    return cache ? cache->prune_one(reason, do_cleanup, last_flow) : false;
 }
 
 void FlowControl::timeout_flows(uint32_t flowCount, time_t cur_time)
 {
     Active::suspend();
-
-    if ( ip_cache )
-        ip_cache->timeout(flowCount, cur_time);
-
-    //if ( icmp_cache )
-    //icmp_cache does not need cleaning
-
-    if ( tcp_cache )
-        tcp_cache->timeout(flowCount, cur_time);
-
-    if ( udp_cache )
-        udp_cache->timeout(flowCount, cur_time);
-
-    if ( user_cache )
-        user_cache->timeout(flowCount, cur_time);
-
-    if ( file_cache )
-        file_cache->timeout(flowCount, cur_time);
-
+    timers->advance(cur_time, flowCount);
     Active::resume();
 }
 
@@ -457,6 +468,7 @@ unsigned FlowControl::process(Flow* flow, Packet* p)
     p->disable_inspect = flow->is_inspection_disabled();
 
     last_pkt_type = p->type();
+    last_flow = flow;
     preemptive_cleanup();
 
     if ( flow->flow_state )
@@ -533,7 +545,7 @@ void FlowControl::init_ip(
     if ( !fc.max_sessions || !get_ssn )
         return;
 
-    ip_cache = new FlowCache(fc);
+    ip_cache = new FlowCache(fc, timers);
     ip_mem = (Flow*)snort_calloc(fc.max_sessions, sizeof(Flow));
 
     for ( unsigned i = 0; i < fc.max_sessions; ++i )
@@ -622,7 +634,7 @@ void FlowControl::init_tcp(
     if ( !fc.max_sessions || !get_ssn )
         return;
 
-    tcp_cache = new FlowCache(fc);
+    tcp_cache = new FlowCache(fc, timers);
     tcp_mem = (Flow*)snort_calloc(fc.max_sessions, sizeof(Flow));
 
     for ( unsigned i = 0; i < fc.max_sessions; ++i )
@@ -665,7 +677,7 @@ void FlowControl::init_udp(
     if ( !fc.max_sessions || !get_ssn )
         return;
 
-    udp_cache = new FlowCache(fc);
+    udp_cache = new FlowCache(fc, timers);
     udp_mem = (Flow*)snort_calloc(fc.max_sessions, sizeof(Flow));
 
     for ( unsigned i = 0; i < fc.max_sessions; ++i )
@@ -708,7 +720,7 @@ void FlowControl::init_user(
     if ( !fc.max_sessions || !get_ssn )
         return;
 
-    user_cache = new FlowCache(fc);
+    user_cache = new FlowCache(fc, timers);
     user_mem = (Flow*)snort_calloc(fc.max_sessions, sizeof(Flow));
 
     for ( unsigned i = 0; i < fc.max_sessions; ++i )
@@ -751,7 +763,7 @@ void FlowControl::init_file(
     if ( !fc.max_sessions || !get_ssn )
         return;
 
-    file_cache = new FlowCache(fc);
+    file_cache = new FlowCache(fc, timers);
     file_mem = (Flow*)snort_calloc(fc.max_sessions, sizeof(Flow));
 
     for ( unsigned i = 0; i < fc.max_sessions; ++i )
@@ -792,7 +804,7 @@ void FlowControl::init_exp(uint32_t max)
     if ( !max )
         max = 2;
 
-    exp_cache = new ExpectCache(max);
+    exp_cache = new ExpectCache(max, timers);
 }
 
 char FlowControl::expected_flow(Flow* flow, Packet* p)
@@ -55,6 +55,7 @@ public:
     void process_user(Packet*);
     void process_file(Packet*);
 
+    void prefetch_flow(Packet*);
     Flow* find_flow(const FlowKey*);
     Flow* new_flow(const FlowKey*);
 
@@ -73,6 +74,10 @@ public:
     bool prune_one(PruneReason, bool do_cleanup);
     void timeout_flows(uint32_t flowCount, time_t cur_time);
 
+    // flows, ip fragment trackers, and expected flows all time out here
+    class TimerWheel* get_timers()
+    { return timers; }
+
     char expected_flow(Flow*, Packet*);
     bool is_expected(Packet*);
 
@@ -127,7 +132,9 @@ private:
     InspectSsnFunc get_file;
 
     class ExpectCache* exp_cache;
+    class TimerWheel* timers;
     PktType last_pkt_type;
+    const Flow* last_flow;   // not pruned by prune_one
 };
 
 #endif
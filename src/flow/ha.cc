@@ -34,7 +34,7 @@
 #include "stream/stream_api.h"
 #include "time/packet_time.h"
 
-static const uint8_t HA_MESSAGE_VERSION = 3;
+static const uint8_t HA_MESSAGE_VERSION = 4;
 
 // define message size and content constants.
 static const uint8_t KEY_SIZE_IP6 = sizeof(FlowKey);
@@ -51,12 +51,13 @@ enum
 
 typedef std::array<FlowHAClient*, MAX_CLIENTS> ClientMap;
 
-THREAD_LOCAL SimpleStats ha_stats;
+THREAD_LOCAL HAStats ha_stats;
 THREAD_LOCAL ProfileStats ha_perf_stats;
 
 static THREAD_LOCAL HighAvailability* ha;
 PortBitSet* HighAvailabilityManager::ports = nullptr;
 bool HighAvailabilityManager::use_daq_channel = false;
+struct timeval HighAvailabilityManager::batch_window;
 struct timeval FlowHAState::min_session_lifetime;
 struct timeval FlowHAState::min_sync_interval;
 uint8_t s_handle_counter = 1; // stream client (index == 0) always exists
@@ -214,7 +215,9 @@ static uint8_t write_flow_key(Flow* flow, HAMessage* msg)
     const FlowKey* key = flow->key;
     assert(key);
 
+#ifdef COMPRESSED_KEY
     if (is_ip6_key(flow->key) )
+#endif
     {
         hdr->key_type = KEY_TYPE_IP6;
         memcpy(msg->cursor, key, KEY_SIZE_IP6);
@@ -280,7 +283,49 @@ static uint8_t read_flow_key(FlowKey* key, HAMessage* msg)
 static inline uint8_t key_size(Flow* flow)
 {
     assert(flow->key);
+#ifdef COMPRESSED_KEY
     return is_ip6_key(flow->key) ? KEY_SIZE_IP6 : KEY_SIZE_IP4;
+#else
+    return KEY_SIZE_IP6;
+#endif
+}
+
+static inline uint8_t key_type_size(uint8_t key_type)
+{
+    switch ( key_type )
+    {
+    case KEY_TYPE_IP6:
+        return KEY_SIZE_IP6;
+#ifdef COMPRESSED_KEY
+    case KEY_TYPE_IP4:
+        return KEY_SIZE_IP4;
+#endif
+    default:
+        return 0;
+    }
+}
+
+// length of the message at buf including the header and key or zero if
+// the header is bad
+static inline uint32_t record_length(const uint8_t* buf)
+{
+    const HAMessageHeader* hdr = (const HAMessageHeader*)buf;
+    uint8_t klen = key_type_size(hdr->key_type);
+
+    if ( !klen )
+        return 0;
+
+    return sizeof(HAMessageHeader) + klen + hdr->total_length;
+}
+
+static inline bool same_key(const uint8_t* a, const uint8_t* b)
+{
+    const HAMessageHeader* ha = (const HAMessageHeader*)a;
+    const HAMessageHeader* hb = (const HAMessageHeader*)b;
+
+    return ha->key_type == hb->key_type and
+        !memcmp(a + sizeof(HAMessageHeader), b + sizeof(HAMessageHeader),
+            key_type_size(ha->key_type));
 }
 
 static uint16_t calculate_msg_header_length(Flow* flow)
@@ -419,7 +464,7 @@ static void consume_receive_message(HAMessage* msg)
     }
 }
 
-HighAvailability::HighAvailability(PortBitSet* ports, bool)
+HighAvailability::HighAvailability(PortBitSet* ports, bool, const struct timeval& window)
 {
     SCPort port;
     using namespace std::placeholders;
@@ -447,6 +492,8 @@ HighAvailability::HighAvailability(PortBitSet* ports, bool)
                 break;
             }
 
+    batch_window = window;
+
     s_client_map = new ClientMap;
     for ( int i=0; i<MAX_CLIENTS; i++ )
         (*s_client_map)[i] = nullptr;
@@ -460,12 +507,141 @@ HighAvailability::~HighAvailability()
 
     if ( sc )
     {
+        flush_batch();
         sc->unregister_receive_handler();
     }
 
     delete s_client_map;
 }
 
+// Returns where to write a message of the given length in the current
+// batch.  Returns nullptr if the message is too big to batch, in which
+// case the batch is sent first so that order is preserved.
+uint8_t* HighAvailability::reserve_record(uint16_t len)
+{
+    if ( len > sizeof(batch) )
+    {
+        flush_batch();
+        return nullptr;
+    }
+
+    if ( batch_len + len > (int)sizeof(batch) )
+        flush_batch();
+
+    if ( !batch_len )
+    {
+        packet_gettimeofday(&batch_start);
+        timeradd(&batch_start, &batch_window, &batch_deadline);
+    }
+
+    uint8_t* rec = batch + batch_len;
+    batch_len += len;
+
+    return rec;
+}
+
+// An update carries the session client plus whichever clients were
+// pending when it was written; return the set of client indices present.
+static uint32_t update_clients(const uint8_t* rec)
+{
+    const uint8_t* p = rec + sizeof(HAMessageHeader) +
+        key_type_size(((const HAMessageHeader*)rec)->key_type);
+    const uint8_t* end = rec + record_length(rec);
+    uint32_t clients = 0;
+
+    while ( p + sizeof(HAClientHeader) <= end )
+    {
+        const HAClientHeader* hdr = (const HAClientHeader*)p;
+        clients |= 1 << hdr->client;
+        p += sizeof(HAClientHeader) + hdr->length;
+    }
+    return clients;
+}
+
+// A deletion makes earlier updates of the same flow in the batch moot so
+// they are voided.  A newer update only replaces an earlier one if it
+// carries every client the earlier one did; otherwise the state of the
+// missing clients would be lost.
+void HighAvailability::add_record(uint8_t* rec)
+{
+    const HAMessageHeader* rec_hdr = (const HAMessageHeader*)rec;
+    uint32_t clients = 0;
+
+    if ( rec_hdr->event == HA_UPDATE_EVENT )
+        clients = update_clients(rec);
+
+    uint8_t* p = batch;
+
+    while ( p < rec )
+    {
+        HAMessageHeader* hdr = (HAMessageHeader*)p;
+
+        if ( hdr->event == HA_UPDATE_EVENT and same_key(p, rec) and
+            (rec_hdr->event != HA_UPDATE_EVENT or !(update_clients(p) & ~clients)) )
+        {
+            hdr->event = HA_VOID_EVENT;
+            ha_stats.coalesced++;
+        }
+        p += record_length(p);
+    }
+
+    if ( !timerisset(&batch_window) )
+        flush_batch();
+}
+
+void HighAvailability::check_batch()
+{
+    if ( !batch_len )
+        return;
+
+    struct timeval now;
+    packet_gettimeofday(&now);
+
+    if ( !timercmp(&now, &batch_deadline, <) )
+        flush_batch();
+}
+
+// Voided messages are left out.
+void HighAvailability::flush_batch()
+{
+    if ( !batch_len )
+        return;
+
+    uint32_t len = 0;
+
+    for ( uint8_t* p = batch; p < batch + batch_len; p += record_length(p) )
+        if ( ((HAMessageHeader*)p)->event != HA_VOID_EVENT )
+            len += record_length(p);
+
+    SCMessage* sc_msg = len ? sc->alloc_transmit_message(len) : nullptr;
+
+    if ( sc_msg )
+    {
+        uint8_t* out = sc_msg->content;
+
+        for ( uint8_t* p = batch; p < batch + batch_len; p += record_length(p) )
+        {
+            if ( ((HAMessageHeader*)p)->event == HA_VOID_EVENT )
+                continue;
+
+            memcpy(out, p, record_length(p));
+            out += record_length(p);
+        }
+        sc->transmit_message(sc_msg);
+
+        struct timeval now, delay;
+        packet_gettimeofday(&now);
+        timersub(&now, &batch_start, &delay);
+
+        ha_stats.batches++;
+        ha_stats.batch_bytes += len;
+        ha_stats.batch_usecs += (PegCount)delay.tv_sec * USEC_PER_SEC + delay.tv_usec;
+    }
+    batch_len = 0;
+}
+
+// A received side channel message holds one or more HA messages which
+// are applied in order.
 void HighAvailability::receive_handler(SCMessage* sc_msg)
 {
     assert(sc_msg);
@@ -476,8 +652,36 @@ void HighAvailability::receive_handler(SCMessage* sc_msg)
     // SC received messages must have reference back to SideChannel object
     assert(sc_msg->sc);
 
-    HAMessage ha_msg(sc_msg);
-    consume_receive_message(&ha_msg);
+    uint8_t* p = sc_msg->content;
+    uint8_t* end = p + sc_msg->content_length;
+
+    ha_stats.received_batches++;
+
+    while ( p < end )
+    {
+        if ( end - p < (int)sizeof(HAMessageHeader) )
+        {
+            ErrorMessage("Consuming HA message - short header\n");
+            break;
+        }
+
+        if ( ((HAMessageHeader*)p)->version != HA_MESSAGE_VERSION )
+            break;
+
+        uint32_t len = record_length(p);
+
+        if ( !len or len > (uint32_t)(end - p) )
+        {
+            ErrorMessage("Consuming HA message - bad length\n");
+            break;
+        }
+
+        HAMessage ha_msg(p, (uint16_t)len);
+        consume_receive_message(&ha_msg);
+        ha_stats.received_msgs++;
+
+        p += len;
+    }
 
     sc_msg->sc->discard_message(sc_msg);
 }
@@ -491,6 +695,8 @@ void HighAvailability::process_update(Flow* flow, const DAQ_PktHdr_t* pkthdr)
     if ( !sc || !flow )
         return;
 
+    check_batch();
+
     // We must have the map array and the session client
     assert(s_client_map);
     assert((*s_client_map)[0]);
@@ -502,14 +708,29 @@ void HighAvailability::process_update(Flow* flow, const DAQ_PktHdr_t* pkthdr)
 
     const uint16_t header_len = calculate_msg_header_length(flow);
     const uint16_t content_len = calculate_update_msg_content_length(flow);
+    const uint16_t len = header_len + content_len;
 
-    SCMessage* sc_msg = sc->alloc_transmit_message((uint32_t)(header_len+content_len));
-    assert(sc_msg);
-    HAMessage ha_msg(sc_msg);
+    uint8_t* rec = reserve_record(len);
+    SCMessage* sc_msg = nullptr;
+
+    if ( !rec )
+    {
+        sc_msg = sc->alloc_transmit_message(len);
+        assert(sc_msg);
+        rec = sc_msg->content;
+    }
+
+    HAMessage ha_msg(rec, len);
 
     write_msg_header(flow, HA_UPDATE_EVENT, content_len, &ha_msg);
     write_update_msg_content(flow, &ha_msg);
-    sc->transmit_message(sc_msg);
+
+    if ( sc_msg )
+        sc->transmit_message(sc_msg);
+    else
+        add_record(rec);
+
+    ha_stats.updates++;
 
     flow->ha_state->clear(FlowHAState::NEW | FlowHAState::MODIFIED |
         FlowHAState::MAJOR | FlowHAState::CRITICAL);
@@ -532,14 +753,19 @@ void HighAvailability::process_deletion(Flow* flow)
     if ( !sc )
         return;
 
-    const uint32_t msg_len = calculate_msg_header_length(flow);
-    SCMessage* sc_msg = sc->alloc_transmit_message(msg_len);
-    HAMessage ha_msg(sc_msg);
+    check_batch();
+
+    const uint16_t msg_len = calculate_msg_header_length(flow);
+    uint8_t* rec = reserve_record(msg_len);
+    assert(rec);
+
+    HAMessage ha_msg(rec, msg_len);
 
     // No content, only header+key
     write_msg_header(flow, HA_DELETE_EVENT, 0, &ha_msg);
+    add_record(rec);
 
-    sc->transmit_message(sc_msg);
+    ha_stats.deletes++;
 
     flow->ha_state->add(FlowHAState::DELETED);
 }
@@ -547,15 +773,25 @@ void HighAvailability::process_deletion(Flow* flow)
 void HighAvailability::process_receive()
 {
     if ( sc != nullptr )
+    {
+        check_batch();
         sc->process(DISPATCH_ALL_RECEIVE);
+    }
 }
 
 // Called by the configuration parsing activity in the main thread.
 bool HighAvailabilityManager::instantiate(PortBitSet* mod_ports, bool mod_use_daq_channel,
-        struct timeval* min_session_lifetime, struct timeval* min_sync_interval)
+        struct timeval* min_session_lifetime, struct timeval* min_sync_interval,
+        struct timeval* mod_batch_window)
 {
     DebugMessage(DEBUG_HA,"HighAvailabilityManager::instantiate()\n");
     ports = mod_ports;
+
+    if ( mod_batch_window )
+        batch_window = *mod_batch_window;
+    else
+        timerclear(&batch_window);
+
     FlowHAState::config_timers(*min_session_lifetime, *min_sync_interval);
 #ifdef HAVE_DAQ_EXT_MODFLOW
     use_daq_channel = mod_use_daq_channel;
@@ -572,6 +808,7 @@ void HighAvailabilityManager::pre_config_init()
     DebugFormat(DEBUG_HA,"HighAvailabilityManager::pre_config_init(): key size: %zu\n",
         sizeof(FlowKey));
     ports = nullptr;
+    timerclear(&batch_window);
 }
 
 // Called within the packet thread prior to packet processing
@@ -580,7 +817,7 @@ void HighAvailabilityManager::thread_init()
     DebugMessage(DEBUG_HA,"HighAvailabilityManager::thread_init()\n");
     // create a a thread local instance iff we are configured to operate.
     if ( (ports != nullptr) || use_daq_channel )
-        ha = new HighAvailability(ports,use_daq_channel);
+        ha = new HighAvailability(ports,use_daq_channel,batch_window);
     else
         ha = nullptr;
 }
@@ -44,6 +44,7 @@ const uint8_t MAX_CLIENTS = 17;
 
 enum HAEvent
 {
+    HA_VOID_EVENT = 0,      // superseded within a batch
     HA_DELETE_EVENT = 1,
     HA_UPDATE_EVENT = 2
 };
@@ -101,22 +102,24 @@ struct __attribute__((__packed__)) HAClientHeader
     uint8_t length;
 };
 
-// Describe the message being produced or consumed.
+// Describe the message being produced or consumed.  Several messages may
+// be packed into one side channel message so this is just a view of one.
 class HAMessage
 {
 public:
-    HAMessage(SCMessage* msg)
-    { sc_msg = msg; }
+    HAMessage(uint8_t* buf, uint16_t len)
+    { data = buf; length = len; cursor = buf; }
     ~HAMessage() { }
 
     uint8_t* content()
-    { return sc_msg->content; }
+    { return data; }
     uint16_t content_length()
-    { return sc_msg->content_length; }
+    { return length; }
     uint8_t* cursor;
 
 private:
-    SCMessage* sc_msg;
+    uint8_t* data;
+    uint16_t length;
 };
 
 // A FlowHAClient subclass for each producer/consumer of flow HA data
@@ -145,7 +148,7 @@ protected:
 class HighAvailability
 {
 public:
-    HighAvailability(PortBitSet*,bool);
+    HighAvailability(PortBitSet*,bool,const struct timeval&);
     ~HighAvailability();
 
     void process_update(Flow*, const DAQ_PktHdr_t*);
@@ -154,7 +157,21 @@ public:
 
 private:
     void receive_handler(SCMessage*);
+
+    uint8_t* reserve_record(uint16_t);
+    void add_record(uint8_t*);
+    void check_batch();
+    void flush_batch();
+
     SideChannel* sc = nullptr;
+
+    // updates and deletions wait here for up to batch_window so that
+    // they go out together and repeated updates of a flow are dropped
+    uint8_t batch[MAXIMUM_SC_MESSAGE_CONTENT];
+    uint16_t batch_len = 0;
+    struct timeval batch_window;
+    struct timeval batch_start;
+    struct timeval batch_deadline;
 };
 
 // Top level management of HighAvailability components.
@@ -164,7 +181,8 @@ public:
     // Prior to parsing configuration
     static void pre_config_init();
     // Invoked by the module configuration parsing to create HA instance
-    static bool instantiate(PortBitSet*,bool,struct timeval*,struct timeval*);
+    static bool instantiate(PortBitSet*,bool,struct timeval*,struct timeval*,
+        struct timeval* batch_window = nullptr);
     static void thread_init();
     static void thread_term();
     // true is we are configured and able to process
@@ -180,6 +198,7 @@ private:
     HighAvailabilityManager() = delete;
     static bool use_daq_channel;
     static PortBitSet* ports;
+    static struct timeval batch_window;
 };
 #endif
 
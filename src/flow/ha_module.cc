@@ -29,12 +29,17 @@
 
 static const PegInfo ha_pegs[] =
 {
+    { "updates", "flow updates sent" },
+    { "deletes", "flow deletions sent" },
+    { "coalesced", "updates replaced by a later message for the same flow" },
+    { "batches", "side channel messages sent" },
+    { "batch bytes", "total bytes in batches sent" },
+    { "batch usecs", "total time batches were held before sending" },
+    { "received batches", "side channel messages received" },
+    { "received msgs", "flow updates and deletions received" },
     { nullptr, nullptr }
 };
 
-extern THREAD_LOCAL SimpleStats ha_stats;
-extern THREAD_LOCAL ProfileStats ha_perf_stats;
-
 //-------------------------------------------------------------------------
 // ha module
 //-------------------------------------------------------------------------
@@ -56,6 +61,9 @@ static const Parameter ha_params[] =
     { "min_sync", Parameter::PT_REAL, "0.0:100.0", "1.0",
       "minimum interval between HA updates" },
 
+    { "batch_window", Parameter::PT_REAL, "0.0:1.0", "0.01",
+      "maximum time in seconds to hold updates before sending them together" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -76,6 +84,7 @@ HighAvailabilityModule::HighAvailabilityModule() :
     config.ports = nullptr;
     convert_real_seconds_to_timeval(1.0, &config.min_session_lifetime);
     convert_real_seconds_to_timeval(0.1, &config.min_sync_interval);
+    convert_real_seconds_to_timeval(0.01, &config.batch_window);
 }
 
 HighAvailabilityModule::~HighAvailabilityModule()
@@ -115,6 +124,10 @@ bool HighAvailabilityModule::set(const char* fqn, Value& v, SnortConfig*)
     {
         convert_real_seconds_to_timeval(v.get_real(), &config.min_sync_interval);
     }
+    else if ( v.is("batch_window") )
+    {
+        convert_real_seconds_to_timeval(v.get_real(), &config.batch_window);
+    }
     else
         return false;
 
@@ -144,7 +157,8 @@ bool HighAvailabilityModule::end(const char* fqn, int idx, SnortConfig*)
 
     if ( config.enabled &&
         !HighAvailabilityManager::instantiate(config.ports, config.daq_channel,
-                        &config.min_session_lifetime, &config.min_sync_interval) )
+                        &config.min_session_lifetime, &config.min_sync_interval,
+                        &config.batch_window) )
     {
         ParseWarning(WARN_CONF, "Illegal HighAvailability configuration");
         return false;
@@ -34,9 +34,22 @@ struct HighAvailabilityConfig
     PortBitSet* ports = nullptr;
     struct timeval min_session_lifetime;
     struct timeval min_sync_interval;
+    struct timeval batch_window;
 };
 
-extern THREAD_LOCAL SimpleStats ha_stats;
+struct HAStats
+{
+    PegCount updates;
+    PegCount deletes;
+    PegCount coalesced;
+    PegCount batches;
+    PegCount batch_bytes;
+    PegCount batch_usecs;
+    PegCount received_batches;
+    PegCount received_msgs;
+};
+
+extern THREAD_LOCAL HAStats ha_stats;
 extern THREAD_LOCAL ProfileStats ha_perf_stats;
 
 class HighAvailabilityModule : public Module
@@ -20,6 +20,7 @@
 // unit test main
 
 #include "flow/ha.h"
+#include "flow/ha_module.h"
 
 #include "flow/flow.h"
 #include "main/snort_debug.h"
@@ -28,7 +29,7 @@
 #include <CppUTest/CommandLineTestRunner.h>
 #include <CppUTest/TestHarness.h>
 
-#define MSG_SIZE 100
+#define MSG_SIZE 200
 #define TEST_KEY 0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,41,42,43,44,45,46,47
 
 class StreamHAClient;
@@ -41,7 +42,7 @@ TEST_KEY
 static const uint8_t s_delete_message[] =
 {
     0x01,
-    0x03,
+    0x04,
     0x00,
     0x00,
     0x01,
@@ -51,10 +52,29 @@ TEST_KEY
 static const uint8_t s_update_stream_message[] =
 {
     0x02,
-    0x03,
+    0x04,
+    0x0c,
+    0x00,
+    0x01,
+TEST_KEY,
+    0x00,
+    10,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9
+};
+
+static const uint8_t s_batch_message[] =
+{
+    0x01,
+    0x04,
     0x00,
     0x00,
     0x01,
+TEST_KEY,
+    0x02,
+    0x04,
+    0x0c,
+    0x00,
+    0x01,
 TEST_KEY,
     0x00,
     10,
@@ -81,6 +101,7 @@ static FlowKey s_flowkey;
 static DAQ_PktHdr_t s_pkthdr;
 static StreamHAClient* s_ha_client;
 static FlowHAClient* s_other_ha_client;
+extern uint8_t s_handle_counter;
 static std::function<void (SCMessage*)> s_handler = nullptr;
 static SCMsgHdr s_sc_header = { 0, 1, 0, 0, };
 
@@ -356,6 +377,17 @@ TEST(high_availability_test, receive_update_stream_only)
     CHECK(memcmp((const void*)&s_flowkey, (const void*)&s_test_key, sizeof(s_test_key)) == 0);
 }
 
+TEST(high_availability_test, receive_batch)
+{
+    s_delete_session_called = false;
+    s_stream_consume_called = false;
+    s_message_content = (uint8_t*)s_batch_message;
+    s_message_length = sizeof(s_batch_message);
+    HighAvailabilityManager::process_receive();
+    CHECK(s_delete_session_called == true);
+    CHECK(s_stream_consume_called == true);
+}
+
 TEST(high_availability_test, transmit_deletion)
 {
     s_transmit_message_called = false;
@@ -392,6 +424,93 @@ TEST(high_availability_test, transmit_update_both_update)
     CHECK(s_transmit_message_called == true);
 }
 
+TEST_GROUP(high_availability_batch_test)
+{
+    void setup()
+    {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+        HighAvailabilityManager::pre_config_init();
+        PortBitSet port_set;
+        port_set.set(1);
+        struct timeval age = { 1, 0 };
+        struct timeval interval = { 0, 500000 };
+        struct timeval window = { 1, 0 };
+        HighAvailabilityManager::instantiate(&port_set, false, &age, &interval, &window);
+        HighAvailabilityManager::thread_init();
+        s_ha_client = new StreamHAClient;
+        s_other_ha_client = new OtherHAClient;
+    }
+
+    void teardown()
+    {
+        delete s_other_ha_client;
+        delete s_ha_client;
+        HighAvailabilityManager::thread_term();
+        s_handle_counter = 1;
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+TEST(high_availability_batch_test, coalesce_updates)
+{
+    s_packet_time.tv_sec = 100;
+    s_transmit_message_called = false;
+    s_stream_update_required = true;
+    s_message_content = nullptr;
+    s_message_length = 0;
+    PegCount coalesced = ha_stats.coalesced;
+
+    HighAvailabilityManager::process_update(&s_flow, &s_pkthdr);
+    HighAvailabilityManager::process_update(&s_flow, &s_pkthdr);
+    CHECK(s_transmit_message_called == false);
+    CHECK(ha_stats.coalesced == coalesced + 1);
+
+    // the window has passed so the batch holds just the last update
+    s_packet_time.tv_sec = 101;
+    HighAvailabilityManager::process_receive();
+    CHECK(s_transmit_message_called == true);
+    CHECK(s_message_length == sizeof(s_update_stream_message));
+}
+
+TEST(high_availability_batch_test, keep_other_client)
+{
+    s_packet_time.tv_sec = 200;
+    s_transmit_message_called = false;
+    s_stream_update_required = true;
+    s_message_content = nullptr;
+    s_message_length = 0;
+    PegCount coalesced = ha_stats.coalesced;
+
+    // the first update carries the other client but the second does not
+    // so the first must not be voided
+    s_flow.ha_state->set_pending(s_other_ha_client->handle);
+    HighAvailabilityManager::process_update(&s_flow, &s_pkthdr);
+    HighAvailabilityManager::process_update(&s_flow, &s_pkthdr);
+    CHECK(s_transmit_message_called == false);
+    CHECK(ha_stats.coalesced == coalesced);
+
+    s_packet_time.tv_sec = 201;
+    HighAvailabilityManager::process_receive();
+    CHECK(s_transmit_message_called == true);
+    CHECK(s_message_length == 2 * sizeof(s_update_stream_message) +
+        sizeof(HAClientHeader) + 5);
+
+    // an update carrying both clients replaces one carrying just the
+    // session client
+    s_packet_time.tv_sec = 202;
+    s_transmit_message_called = false;
+    HighAvailabilityManager::process_update(&s_flow, &s_pkthdr);
+    s_flow.ha_state->set_pending(s_other_ha_client->handle);
+    HighAvailabilityManager::process_update(&s_flow, &s_pkthdr);
+    CHECK(ha_stats.coalesced == coalesced + 1);
+
+    s_packet_time.tv_sec = 203;
+    HighAvailabilityManager::process_receive();
+    CHECK(s_transmit_message_called == true);
+    CHECK(s_message_length == sizeof(s_update_stream_message) +
+        sizeof(HAClientHeader) + 5);
+}
+
 int main(int argc, char** argv)
 {
     return CommandLineTestRunner::RunAllTests(argc, argv);
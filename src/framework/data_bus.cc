@@ -18,6 +18,11 @@
 // data_bus.cc author Russ Combs <rucombs@cisco.com>
 
 #include "framework/data_bus.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
 #include "main/policy.h"
 #include "protocols/packet.h"
 
@@ -51,43 +56,84 @@ private:
     const Packet* packet;
 };
 
+//-------------------------------------------------------------------------
+// event ids
+//-------------------------------------------------------------------------
+
+// ids are assigned while configuring but the compatibility methods may
+// look them up from packet threads
+static std::mutex& get_id_mutex()
+{
+    static std::mutex m;
+    return m;
+}
+
+static std::unordered_map<std::string, unsigned>& get_id_map()
+{
+    static std::unordered_map<std::string, unsigned> ids;
+    return ids;
+}
+
+unsigned DataBus::get_id(const char* key)
+{
+    std::lock_guard<std::mutex> lock(get_id_mutex());
+    auto& ids = get_id_map();
+    auto it = ids.find(key);
+
+    if ( it != ids.end() )
+        return it->second;
+
+    unsigned id = ids.size();
+    ids[key] = id;
+    return id;
+}
+
+//-------------------------------------------------------------------------
+// bus
+//-------------------------------------------------------------------------
+
 DataBus::DataBus() { }
 
 DataBus::~DataBus()
 {
-    for ( auto& p : map )
-        for ( auto* h : p.second )
+    for ( auto& v : lists )
+        for ( auto* h : v )
             delete h;
 }
 
 // add handler to list of handlers to be notified upon
 // publication of given event
-void DataBus::subscribe(const char* key, DataHandler* h)
-{
-    DataList& v = map[key];
-    v.push_back(h);
-}
-
-// notify subscribers of event
-void DataBus::publish(const char* key, DataEvent& e, Flow* f)
+void DataBus::subscribe(unsigned id, DataHandler* h)
 {
-    DataList& v = map[key];
+    if ( id >= lists.size() )
+        lists.resize(id + 1);
 
-    for ( auto* h : v )
-        h->handle(e, f);
+    lists[id].push_back(h);
 }
 
-void DataBus::publish(const char* key, const uint8_t* buf, unsigned len, Flow* f)
+void DataBus::publish(unsigned id, const uint8_t* buf, unsigned len, Flow* f)
 {
     BufferEvent e(buf, len);
-    publish(key, e, f);
+    publish(id, e, f);
 }
 
-void DataBus::publish(const char* key, Packet* p, Flow* f)
+void DataBus::publish(unsigned id, Packet* p, Flow* f)
 {
     PacketEvent e(p);
     if ( !f )
         f = p->flow;
-    publish(key, e, f);
+    publish(id, e, f);
 }
 
+void DataBus::subscribe(const char* key, DataHandler* h)
+{ subscribe(get_id(key), h); }
+
+void DataBus::publish(const char* key, DataEvent& e, Flow* f)
+{ publish(get_id(key), e, f); }
+
+void DataBus::publish(const char* key, const uint8_t* buf, unsigned len, Flow* f)
+{ publish(get_id(key), buf, len, f); }
+
+void DataBus::publish(const char* key, Packet* p, Flow* f)
+{ publish(get_id(key), p, f); }
+
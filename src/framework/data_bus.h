@@ -26,14 +26,19 @@
 // a publish-subscribe mechanism, it is possible to add custom processing
 // at arbitrary points, eg when service is identified, or when a URI is
 // available, or when a flow clears.
+//
+// Event keys are interned into small integer ids which are the same for
+// all buses and never change.  Publishers and subscribers should get the
+// id once and use it so publishing is just an index into the bus' handler
+// lists.  The string key methods remain for compatibility; they look up
+// the id on each call.
 
 #include <map>
 #include <string>
 #include <vector>
 
-// FIXIT-P evaluate perf; focus is on correctness
 typedef std::vector<class DataHandler*> DataList;
-typedef std::map<std::string, DataList> DataMap;
+typedef std::vector<DataList> DataLists;
 
 #include "main/snort_types.h"
 
@@ -75,15 +80,32 @@ public:
     DataBus();
     ~DataBus();
 
-    void subscribe(const char* key, DataHandler*);
-    void publish(const char* key, DataEvent&, Flow* = nullptr);
+    // returns the id for key, assigning the next one if key is new
+    static unsigned get_id(const char* key);
+
+    void subscribe(unsigned id, DataHandler*);
+
+    void publish(unsigned id, DataEvent& e, Flow* f = nullptr)
+    {
+        if ( id >= lists.size() )
+            return;
+
+        for ( auto* h : lists[id] )
+            h->handle(e, f);
+    }
 
     // convenience methods
+    void publish(unsigned id, const uint8_t*, unsigned, Flow* = nullptr);
+    void publish(unsigned id, Packet*, Flow* = nullptr);
+
+    // compatibility
+    void subscribe(const char* key, DataHandler*);
+    void publish(const char* key, DataEvent&, Flow* = nullptr);
     void publish(const char* key, const uint8_t*, unsigned, Flow* = nullptr);
     void publish(const char* key, Packet*, Flow* = nullptr);
 
 private:
-    DataMap map;
+    DataLists lists;  // indexed by id
 };
 
 // FIXIT-L this should be in snort_confg.h or similar but that
@@ -92,6 +114,7 @@ SO_PUBLIC DataBus& get_data_bus();
 
 // common data events
 #define PACKET_EVENT "detection.packet"
+#define FILE_EVENT "file_event"
 
 #endif
 
@@ -24,9 +24,26 @@
 #endif
 using namespace std;
 
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+
+#include "detection/fp_config.h"
+#include "log/messages.h"
+#include "main/snort_config.h"
 #include "main/snort_debug.h"
 #include "main/snort_types.h"
 #include "profiler/profiler.h"
+#include "utils/util.h"
 
 // this is accumulated only for fast pattern
 // searches for the detection engine
@@ -59,6 +76,33 @@ int Mpse::search(
     return ret;
 }
 
+int Mpse::search_batch(MpseBatchItem* items, unsigned n, MpseMatch match)
+{
+    Profile profile(mpsePerfStats);
+
+    int ret = _search_batch(items, n, match);
+
+    if ( inc_global_counter )
+    {
+        for ( unsigned i = 0; i < n; ++i )
+            s_bcnt += items[i].len;
+    }
+
+    return ret;
+}
+
+int Mpse::_search_batch(MpseBatchItem* items, unsigned n, MpseMatch match)
+{
+    int found = 0;
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        MpseBatchItem& item = items[i];
+        found += _search(item.buf, item.len, match, item.context, &item.state);
+    }
+    return found;
+}
+
 int Mpse::search_all(
     const unsigned char* T, int n, MpseMatch match,
     void* context, int* current_state)
@@ -76,3 +120,207 @@ void Mpse::reset_pattern_byte_count()
     s_bcnt = 0;
 }
 
+//-------------------------------------------------------------------------
+// database cache
+//
+// cache files are <cache_dir>/<engine>-<key hash>.db laid out as a header
+// padded to MPSE_CACHE_DB_OFFSET, the database, and then the full key so
+// a hash collision can't load the wrong database.  files are written to a
+// temporary name and renamed so concurrent instances never see a partial
+// file.  temporary names are unique per engine instance since several may
+// be compiled at once.
+//
+// the paths of the files looked up or saved are recorded.  once the
+// configuration is compiled, files this process saved for an earlier
+// configuration that the new one no longer uses are removed.  files from
+// other instances sharing cache_dir are never touched.
+//-------------------------------------------------------------------------
+
+#define MPSE_CACHE_MAGIC "snortmpc"
+#define MPSE_CACHE_VERSION 1
+#define MPSE_CACHE_DB_OFFSET 64
+
+static std::atomic<unsigned> s_tmp_seq(0);
+
+static std::mutex s_used_mutex;
+static std::set<std::string> s_used_paths;
+static std::set<std::string> s_saved_paths;
+
+struct MpseCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t api_version;
+    uint64_t db_len;
+    uint64_t key_len;
+};
+
+static_assert(sizeof(MpseCacheHeader) <= MPSE_CACHE_DB_OFFSET, "cache header too big");
+
+static uint64_t cache_hash(const std::string& s)
+{
+    // FNV-1a
+    uint64_t h = 0xcbf29ce484222325ull;
+
+    for ( auto c : s )
+    {
+        h ^= (uint8_t)c;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+bool Mpse::cache_enabled(SnortConfig* sc)
+{
+    return sc and sc->fast_pattern_config and sc->fast_pattern_config->get_cache_dir();
+}
+
+static std::string cache_path(SnortConfig* sc, const std::string& method, const std::string& key)
+{
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016" PRIx64, cache_hash(key));
+
+    std::string path = sc->fast_pattern_config->get_cache_dir();
+    path += "/";
+    path += method;
+    path += "-";
+    path += hash;
+    path += ".db";
+    return path;
+}
+
+static void use_path(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(s_used_mutex);
+    s_used_paths.insert(path);
+}
+
+void Mpse::cache_keep(SnortConfig* sc, const std::string& key)
+{
+    if ( cache_enabled(sc) )
+        use_path(cache_path(sc, method, key));
+}
+
+unsigned Mpse::cache_prune(SnortConfig*)
+{
+    std::lock_guard<std::mutex> lock(s_used_mutex);
+    unsigned pruned = 0;
+    auto it = s_saved_paths.begin();
+
+    while ( it != s_saved_paths.end() )
+    {
+        if ( s_used_paths.find(*it) != s_used_paths.end() )
+        {
+            ++it;
+            continue;
+        }
+
+        if ( !unlink(it->c_str()) )
+            ++pruned;
+
+        it = s_saved_paths.erase(it);
+    }
+    s_used_paths.clear();
+    return pruned;
+}
+
+const uint8_t* Mpse::cache_map(SnortConfig* sc, const std::string& key, size_t& len)
+{
+    if ( !cache_enabled(sc) )
+        return nullptr;
+
+    std::string path = cache_path(sc, method, key);
+    use_path(path);
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if ( fd < 0 )
+        return nullptr;
+
+    struct stat st;
+
+    if ( fstat(fd, &st) or (size_t)st.st_size < MPSE_CACHE_DB_OFFSET )
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if ( map == MAP_FAILED )
+        return nullptr;
+
+    const MpseCacheHeader* hdr = (const MpseCacheHeader*)map;
+    const uint8_t* db = (const uint8_t*)map + MPSE_CACHE_DB_OFFSET;
+
+    if ( memcmp(hdr->magic, MPSE_CACHE_MAGIC, sizeof(hdr->magic)) or
+        hdr->version != MPSE_CACHE_VERSION or hdr->api_version != SEAPI_VERSION or
+        hdr->key_len != key.size() or
+        MPSE_CACHE_DB_OFFSET + hdr->db_len + hdr->key_len != (uint64_t)st.st_size or
+        memcmp(db + hdr->db_len, key.data(), key.size()) )
+    {
+        munmap(map, st.st_size);
+        return nullptr;
+    }
+
+    len = hdr->db_len;
+    return db;
+}
+
+void Mpse::cache_unmap(const uint8_t* db)
+{
+    if ( !db )
+        return;
+
+    const MpseCacheHeader* hdr = (const MpseCacheHeader*)(db - MPSE_CACHE_DB_OFFSET);
+    munmap((void*)hdr, MPSE_CACHE_DB_OFFSET + hdr->db_len + hdr->key_len);
+}
+
+bool Mpse::cache_save(SnortConfig* sc, const std::string& key, const uint8_t* db, size_t len)
+{
+    if ( !cache_enabled(sc) )
+        return false;
+
+    std::string path = cache_path(sc, method, key);
+    use_path(path);
+
+    std::string tmp = path + ".tmp." + std::to_string(getpid()) + "." +
+        std::to_string(++s_tmp_seq);
+
+    FILE* fh = fopen(tmp.c_str(), "wb");
+
+    if ( !fh )
+    {
+        WarningMessage("can't create search engine cache file %s: %s\n",
+            tmp.c_str(), get_error(errno));
+        return false;
+    }
+
+    uint8_t hdr[MPSE_CACHE_DB_OFFSET] = { };
+    MpseCacheHeader* h = (MpseCacheHeader*)hdr;
+
+    memcpy(h->magic, MPSE_CACHE_MAGIC, sizeof(h->magic));
+    h->version = MPSE_CACHE_VERSION;
+    h->api_version = SEAPI_VERSION;
+    h->db_len = len;
+    h->key_len = key.size();
+
+    bool ok =
+        fwrite(hdr, sizeof(hdr), 1, fh) == 1 and
+        fwrite(db, len, 1, fh) == 1 and
+        (key.empty() or fwrite(key.data(), key.size(), 1, fh) == 1);
+
+    ok = !fclose(fh) and ok;
+
+    if ( !ok or rename(tmp.c_str(), path.c_str()) )
+    {
+        WarningMessage("can't write search engine cache file %s: %s\n",
+            path.c_str(), get_error(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(s_used_mutex);
+    s_saved_paths.insert(path);
+    return true;
+}
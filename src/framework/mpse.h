@@ -42,6 +42,16 @@ struct SnortConfig;
 struct MpseApi;
 struct ProfileStats;
 
+// one buffer of a batched search; matches are reported with the item's
+// context so callers can tell the buffers apart
+struct MpseBatchItem
+{
+    const uint8_t* buf;
+    int len;
+    void* context;
+    int state;
+};
+
 class SO_PUBLIC Mpse
 {
 public:
@@ -73,10 +83,30 @@ public:
     virtual int search_all(
         const uint8_t* T, int n, MpseMatch, void* context, int* current_state);
 
+    // removes the cache files this process saved that no engine used since
+    // the last prune, ie those with keys the configuration just compiled no
+    // longer has.  returns the number of files removed.
+    static unsigned cache_prune(SnortConfig*);
+
+    // search several buffers with the same engine under one profile scope;
+    // returns the total number of matches
+    int search_batch(MpseBatchItem*, unsigned n, MpseMatch);
+
     virtual void set_opt(int) { }
     virtual int print_info() { return 0; }
     virtual int get_pattern_count() { return 0; }
 
+    // true if prep_patterns() may run for different instances at the
+    // same time on different threads
+    virtual bool concurrent_prep() { return false; }
+
+    // called instead of prep_patterns() on reload with an instance from
+    // the running configuration that was given the same patterns.  engines
+    // that can share their compiled state machine with prev (which is
+    // still in use) do so here and build their match state trees.  returns
+    // false if prev can't be used; prep_patterns() is then called.
+    virtual bool reuse(SnortConfig*, Mpse* /*prev*/) { return false; }
+
     const char* get_method() { return method.c_str(); }
     void set_verbose(bool b = true) { verbose = b; }
 
@@ -89,6 +119,27 @@ protected:
     virtual int _search(
         const uint8_t* T, int n, MpseMatch, void* context, int* current_state) = 0;
 
+    // engines that can interleave buffers should override this
+    virtual int _search_batch(MpseBatchItem*, unsigned n, MpseMatch);
+
+    // compiled database cache for engines that can serialize their state
+    // machine.  key must describe everything the database is built from;
+    // the engine name and cache format version are added here.  returns a
+    // read only mapping of the database or nullptr if there is no cache
+    // or no match.  release the mapping with cache_unmap().
+    const uint8_t* cache_map(SnortConfig*, const std::string& key, size_t& len);
+    void cache_unmap(const uint8_t*);
+
+    // returns true if saved
+    bool cache_save(SnortConfig*, const std::string& key, const uint8_t*, size_t len);
+
+    bool cache_enabled(SnortConfig*);
+
+    // marks the file for key as in use so cache_prune() keeps it; done by
+    // cache_map() and cache_save() so engines only call this when they
+    // reuse a database without either
+    void cache_keep(SnortConfig*, const std::string& key);
+
 private:
     std::string method;
     bool inc_global_counter;
@@ -0,0 +1,364 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#include "clock_hash.h"
+
+#include <assert.h>
+#include <string.h>
+
+//-------------------------------------------------------------------------
+// private stuff
+//-------------------------------------------------------------------------
+
+#define CACHE_LINE 64
+#define BUCKET_SLOTS 8
+
+// at most 75% of the slots are used
+#define MAX_LOAD_NUM 3
+#define MAX_LOAD_DEN 4
+
+#define NODE_REF  0x80000000
+#define NODE_POS  0x7FFFFFFF
+#define NODE_FREE NODE_POS
+
+struct ClockHashBucket
+{
+    uint16_t tags[BUCKET_SLOTS];    // 0 => empty slot
+    uint32_t nodes[BUCKET_SLOTS];
+    uint32_t overflow;              // entries that probed past this bucket
+    uint32_t pad[3];
+};
+
+static_assert(sizeof(ClockHashBucket) == CACHE_LINE, "bucket must be one cache line");
+
+// the key follows the node header
+struct ClockHashNode
+{
+    void* data;
+    uint32_t hash;
+    uint32_t live;  // NODE_REF | position in live_nodes, or NODE_FREE
+};
+
+static inline uint16_t get_tag(uint32_t hash)
+{
+    // the low bits select the bucket so use a different mix for the tag
+    return (uint16_t)((hash * 0x9E3779B1) >> 16) | 0x1;
+}
+
+static inline uint8_t* align_line(uint8_t* p)
+{
+    return (uint8_t*)(((uintptr_t)p + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1));
+}
+
+static unsigned nearest_powerof2(unsigned n)
+{
+    unsigned p = 1;
+
+    while ( p < n )
+        p <<= 1;
+
+    return p;
+}
+
+inline ClockHashNode* ClockHash::get_node(unsigned idx) const
+{
+    return (ClockHashNode*)(nodes + (size_t)idx * stride);
+}
+
+static inline void* get_key(ClockHashNode* node)
+{ return (uint8_t*)node + sizeof(*node); }
+
+unsigned ClockHash::find_node(const void* key, uint32_t hash) const
+{
+    uint16_t tag = get_tag(hash);
+    unsigned b = hash & mask;
+
+    for ( unsigned probes = 0; probes <= mask; ++probes )
+    {
+        const ClockHashBucket& bk = buckets[b];
+
+        for ( unsigned i = 0; i < BUCKET_SLOTS; ++i )
+        {
+            if ( bk.tags[i] != tag )
+                continue;
+
+            ClockHashNode* node = get_node(bk.nodes[i]);
+
+            if ( node->hash == hash and !keycmp_fcn(get_key(node), key, keysize) )
+                return bk.nodes[i];
+        }
+
+        if ( !bk.overflow )
+            break;
+
+        b = (b + 1) & mask;
+    }
+    return max_nodes;
+}
+
+void ClockHash::insert_node(unsigned idx, uint32_t hash)
+{
+    uint16_t tag = get_tag(hash);
+    unsigned b = hash & mask;
+
+    // the load factor guarantees a free slot
+    while ( true )
+    {
+        ClockHashBucket& bk = buckets[b];
+        unsigned i = 0;
+
+        while ( i < BUCKET_SLOTS and bk.tags[i] )
+            ++i;
+
+        if ( i < BUCKET_SLOTS )
+        {
+            bk.tags[i] = tag;
+            bk.nodes[i] = idx;
+            break;
+        }
+        bk.overflow++;
+        b = (b + 1) & mask;
+    }
+
+    ClockHashNode* node = get_node(idx);
+    node->hash = hash;
+    node->live = NODE_REF | count;
+
+    live_nodes[count++] = idx;
+}
+
+void ClockHash::remove_node(unsigned idx)
+{
+    ClockHashNode* node = get_node(idx);
+    uint16_t tag = get_tag(node->hash);
+    unsigned home = node->hash & mask;
+    unsigned b = home;
+
+    while ( true )
+    {
+        ClockHashBucket& bk = buckets[b];
+        unsigned i;
+
+        for ( i = 0; i < BUCKET_SLOTS; ++i )
+        {
+            if ( bk.tags[i] == tag and bk.nodes[i] == idx )
+                break;
+        }
+
+        if ( i < BUCKET_SLOTS )
+        {
+            bk.tags[i] = 0;
+            break;
+        }
+
+        assert(bk.overflow);
+        b = (b + 1) & mask;
+    }
+
+    // undo the overflow counts left when this node was inserted
+    for ( unsigned o = home; o != b; o = (o + 1) & mask )
+        buckets[o].overflow--;
+
+    // swap the last live node into this one's position
+    unsigned pos = node->live & NODE_POS;
+    unsigned last = live_nodes[--count];
+
+    if ( last != idx )
+    {
+        ClockHashNode* moved = get_node(last);
+        live_nodes[pos] = last;
+        moved->live = (moved->live & NODE_REF) | pos;
+    }
+
+    // so the node swapped into the vacated position isn't skipped
+    if ( hand and pos == hand - 1 )
+        --hand;
+
+    if ( cursor and pos == cursor - 1 )
+        --cursor;
+
+    node->live = NODE_FREE;
+    free_nodes[num_free++] = idx;
+}
+
+//-------------------------------------------------------------------------
+// public stuff
+//-------------------------------------------------------------------------
+
+ClockHash::ClockHash(unsigned max, unsigned ksize, HashFcn hf, KeyCmpFcn kf)
+{
+    assert(max > 0 and max < NODE_POS);
+    assert(hf and kf);
+
+    hash_fcn = hf;
+    keycmp_fcn = kf;
+
+    keysize = ksize;
+    max_nodes = max;
+    pushed = count = num_free = 0;
+    hand = cursor = 0;
+
+    // FlowKey is 48 bytes so flow nodes are exactly one line
+    stride = (sizeof(ClockHashNode) + keysize + 7) & ~7;
+
+    unsigned min_buckets =
+        (max_nodes * MAX_LOAD_DEN + BUCKET_SLOTS * MAX_LOAD_NUM - 1) /
+        (BUCKET_SLOTS * MAX_LOAD_NUM);
+
+    unsigned num_buckets = nearest_powerof2(min_buckets);
+    mask = num_buckets - 1;
+
+    bucket_mem = new uint8_t[num_buckets * sizeof(ClockHashBucket) + CACHE_LINE];
+    buckets = (ClockHashBucket*)align_line(bucket_mem);
+    memset((void*)buckets, 0, num_buckets * sizeof(ClockHashBucket));
+
+    node_mem = new uint8_t[(size_t)max_nodes * stride + CACHE_LINE];
+    nodes = align_line(node_mem);
+
+    free_nodes = new unsigned[max_nodes];
+    live_nodes = new unsigned[max_nodes];
+}
+
+ClockHash::~ClockHash()
+{
+    delete[] bucket_mem;
+    delete[] node_mem;
+    delete[] free_nodes;
+    delete[] live_nodes;
+}
+
+void* ClockHash::push(void* p)
+{
+    assert(pushed < max_nodes);
+
+    unsigned idx = pushed++;
+    ClockHashNode* node = get_node(idx);
+
+    node->data = p;
+    node->hash = 0;
+    node->live = NODE_FREE;
+
+    free_nodes[num_free++] = idx;
+    return get_key(node);
+}
+
+void* ClockHash::pop()
+{
+    if ( !num_free )
+        return nullptr;
+
+    return get_node(free_nodes[--num_free])->data;
+}
+
+void ClockHash::prefetch(const void* key) const
+{
+    uint32_t hash = hash_fcn(nullptr, (unsigned char*)key, keysize);
+    __builtin_prefetch(buckets + (hash & mask));
+}
+
+void* ClockHash::find(const void* key)
+{
+    uint32_t hash = hash_fcn(nullptr, (unsigned char*)key, keysize);
+    unsigned idx = find_node(key, hash);
+
+    if ( idx == max_nodes )
+        return nullptr;
+
+    ClockHashNode* node = get_node(idx);
+    node->live |= NODE_REF;
+    return node->data;
+}
+
+void* ClockHash::get(const void* key)
+{
+    uint32_t hash = hash_fcn(nullptr, (unsigned char*)key, keysize);
+    unsigned idx = find_node(key, hash);
+
+    if ( idx < max_nodes )
+    {
+        ClockHashNode* node = get_node(idx);
+        node->live |= NODE_REF;
+        return node->data;
+    }
+
+    if ( !num_free )
+        return nullptr;
+
+    idx = free_nodes[--num_free];
+    ClockHashNode* node = get_node(idx);
+
+    memcpy(get_key(node), key, keysize);
+    insert_node(idx, hash);
+
+    return node->data;
+}
+
+bool ClockHash::remove(const void* key)
+{
+    const uint8_t* k = (const uint8_t*)key;
+    unsigned idx;
+
+    // keys handed out by push() map directly to their node
+    if ( k >= nodes and k < nodes + (size_t)pushed * stride and
+        !((k - nodes - sizeof(ClockHashNode)) % stride) )
+    {
+        idx = (k - nodes) / stride;
+
+        if ( get_node(idx)->live == NODE_FREE )
+            return false;
+    }
+    else
+    {
+        uint32_t hash = hash_fcn(nullptr, (unsigned char*)key, keysize);
+        idx = find_node(key, hash);
+
+        if ( idx == max_nodes )
+            return false;
+    }
+
+    remove_node(idx);
+    return true;
+}
+
+void* ClockHash::sweep(bool& referenced)
+{
+    if ( !count )
+        return nullptr;
+
+    if ( hand >= count )
+        hand = 0;
+
+    ClockHashNode* node = get_node(live_nodes[hand++]);
+
+    referenced = (node->live & NODE_REF) != 0;
+    node->live &= ~NODE_REF;
+
+    return node->data;
+}
+
+void* ClockHash::scan()
+{
+    if ( !count )
+        return nullptr;
+
+    if ( cursor >= count )
+        cursor = 0;
+
+    return get_node(live_nodes[cursor++])->data;
+}
+
@@ -0,0 +1,116 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef CLOCK_HASH_H
+#define CLOCK_HASH_H
+
+// ClockHash is a preallocated, open addressed hash table with approximate
+// LRU (clock) replacement.  It has the same push / pop preallocation model
+// as ZHash so that keys returned by push() remain valid for the life of the
+// table.
+//
+// Each bucket is one cache line of 16 bit tags and node indices so a hit
+// usually costs the bucket line plus the node line where the key lives.
+// Hits only set a reference bit; there are no lists to relink.  Buckets
+// count the entries that overflowed past them so a lookup stops at the
+// first bucket without overflow and removal needs no tombstones.
+//
+// In use nodes are also kept in a dense array which is walked by two
+// cursors: the clock hand used for eviction which clears reference bits,
+// and a scan cursor for timeouts which doesn't.
+
+#include <cstddef>
+#include <cstdint>
+
+struct SFHASHFCN;
+struct ClockHashBucket;
+struct ClockHashNode;
+
+class ClockHash
+{
+public:
+    // same signatures as ZHash keyops; SFHASHFCN* is always null
+    typedef unsigned (* HashFcn)(SFHASHFCN*, unsigned char* d, int n);
+    typedef int (* KeyCmpFcn)(const void* s1, const void* s2, size_t n);
+
+    ClockHash(unsigned max_nodes, unsigned keysize, HashFcn, KeyCmpFcn);
+    ~ClockHash();
+
+    // adds a free node bound to p and returns its key storage
+    void* push(void* p);
+
+    // removes a free node and returns its data
+    void* pop();
+
+    // pulls the key's home bucket into cache ahead of find() / get()
+    void prefetch(const void* key) const;
+
+    // a found node is marked referenced
+    void* find(const void* key);
+
+    // find or insert; returns nullptr if the key is new and no nodes are free
+    void* get(const void* key);
+
+    bool remove(const void* key);
+
+    // returns the next in use node at the clock hand and clears its
+    // reference bit; referenced is set if it was referenced
+    void* sweep(bool& referenced);
+
+    // returns the next in use node at the scan cursor
+    void* scan();
+
+    unsigned get_count() const
+    { return count; }
+
+    unsigned get_max_nodes() const
+    { return max_nodes; }
+
+private:
+    ClockHashNode* get_node(unsigned) const;
+    unsigned find_node(const void* key, uint32_t hash) const;
+    void insert_node(unsigned, uint32_t hash);
+    void remove_node(unsigned);
+
+private:
+    HashFcn hash_fcn;
+    KeyCmpFcn keycmp_fcn;
+
+    unsigned keysize;
+    unsigned stride;
+    unsigned max_nodes;
+    unsigned pushed;
+    unsigned count;
+    unsigned num_free;
+    unsigned mask;
+
+    unsigned hand;
+    unsigned cursor;
+
+    uint8_t* bucket_mem;
+    uint8_t* node_mem;
+
+    ClockHashBucket* buckets;
+    uint8_t* nodes;
+
+    unsigned* free_nodes;
+    unsigned* live_nodes;
+};
+
+#endif
+
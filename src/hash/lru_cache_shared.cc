@@ -29,6 +29,7 @@ const PegInfo lru_cache_shared_peg_names[] =
     { "lru cache find misses", "lru cache did not find entry in cache" },
     { "lru cache removes", "lru cache found entry and removed it" },
     { "lru cache clears", "lru cache clear API calls" },
+    { "lru cache lock contention", "lru cache shard lock was held by another thread" },
     { nullptr, nullptr },
 };
 
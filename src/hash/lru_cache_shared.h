@@ -23,6 +23,12 @@
 
 // LruCacheShared -- Implements a thread-safe unordered map where the
 // least-recently-used (LRU) entries are removed once a fixed size is hit.
+//
+// The cache may be split into N shards selected by key hash.  Each shard
+// is an independent LRU with its own lock, list, and map and 1/N of the
+// maximum size so threads working on different keys rarely contend.  LRU
+// order is only maintained within a shard.  With one shard (the default)
+// this is a plain LRU with a single lock.
 
 #include <list>
 #include <vector>
@@ -43,6 +49,8 @@ struct LruCacheSharedStats
     PegCount find_misses = 0; //  Did not find entry in cache.
     PegCount removes = 0;    //  Found entry and removed it.
     PegCount clears = 0;     //  Calls to clear API.
+    PegCount lock_contention = 0;  //  Shard lock was held by another
+                                   //  thread when needed.
 };
 
 template<typename Key, typename Data, typename Hash>
@@ -56,25 +64,43 @@ public:
     LruCacheShared(const LruCacheShared& arg) = delete;
     LruCacheShared& operator=(const LruCacheShared& arg) = delete;
 
-    LruCacheShared(const size_t initial_size) :
+    LruCacheShared(const size_t initial_size, const unsigned shard_count = 1) :
         max_size(initial_size),
-        current_size(0)
+        num_shards(shard_count ? shard_count : 1)
+    {
+        shards = new Shard[num_shards];
+        set_shard_sizes();
+    }
+
+    ~LruCacheShared()
     {
+        delete[] shards;
     }
 
     //  Get current number of elements in the LruCache.
     size_t size()
     {
-        std::lock_guard<std::mutex> cache_lock(cache_mutex);
-        return current_size;
+        size_t n = 0;
+
+        for ( unsigned i = 0; i < num_shards; ++i )
+        {
+            std::lock_guard<std::mutex> cache_lock(shards[i].cache_mutex);
+            n += shards[i].current_size;
+        }
+        return n;
     }
 
     size_t get_max_size()
     {
-        std::lock_guard<std::mutex> cache_lock(cache_mutex);
+        std::lock_guard<std::mutex> size_lock(size_mutex);
         return max_size;
     }
 
+    unsigned get_num_shards() const
+    {
+        return num_shards;
+    }
+
     //  Modify the maximum number of entries allowed in the cache.
     //  If the size is reduced, the oldest entries are removed.
     bool set_max_size(size_t newsize);
@@ -100,7 +126,7 @@ public:
     void clear();
 
     //  Return all data from the LruCache in order (most recently used to
-    //  least).
+    //  least).  With multiple shards, each shard is returned in turn.
     std::vector<std::pair<Key, Data> > get_all_data();
 
     const PegInfo* get_pegs() const
@@ -108,10 +134,8 @@ public:
         return lru_cache_shared_peg_names;
     }
 
-    PegCount* get_counts() const
-    {
-        return (PegCount*)&stats;
-    }
+    //  Sums the per shard counts.
+    PegCount* get_counts() const;
 
 private:
     using LruList = std::list<std::pair<Key, Data> >;
@@ -119,42 +143,101 @@ private:
     using LruMap  = std::unordered_map<Key, LruListIter, Hash>;
     using LruMapIter = typename LruMap::iterator;
 
+    struct Shard
+    {
+        size_t max_size = 1;   // This shard's part of the cache max_size.
+
+        //  NOTE: std::list::size() is O(n) (it recounts the list every time)
+        //        so instead we keep track of the current size manually.
+        size_t current_size = 0;    // Number of entries currently in the shard.
+
+        std::mutex cache_mutex;
+        LruList list;  //  Contains key/data pairs. Maintains LRU order with
+                       //  least recently used at the end.
+        LruMap map;    //  Maps key to list iterator for fast lookup.
+
+        struct LruCacheSharedStats stats;
+    };
+
+    Shard& get_shard(const Key& key)
+    {
+        if ( num_shards == 1 )
+            return shards[0];
+
+        //  Mix the high bits in since the map uses the same hash.
+        size_t h = Hash()(key);
+        h ^= h >> (sizeof(h) * 4);
+        h ^= h >> 16;
+        return shards[h % num_shards];
+    }
+
+    //  Returns the shard lock, counting it if another thread had it.
+    static std::unique_lock<std::mutex> lock_shard(Shard& shard)
+    {
+        std::unique_lock<std::mutex> lock(shard.cache_mutex, std::try_to_lock);
+
+        if ( !lock.owns_lock() )
+        {
+            lock.lock();
+            shard.stats.lock_contention++;
+        }
+        return lock;
+    }
+
+    void set_shard_sizes();
+    void prune(Shard&);
+
     size_t max_size;   // Once max_size elements are in the cache, start to
                        // remove the least-recently-used elements.
 
-    //  NOTE: std::list::size() is O(n) (it recounts the list every time)
-    //        so instead we keep track of the current size manually.
-    size_t current_size;    // Number of entries currently in the cache.
-
-    std::mutex cache_mutex;
-    LruList list;  //  Contains key/data pairs. Maintains LRU order with
-                   //  least recently used at the end.
-    LruMap map;    //  Maps key to list iterator for fast lookup.
+    std::mutex size_mutex;
+    const unsigned num_shards;
+    Shard* shards;
 
-    struct LruCacheSharedStats stats;
+    mutable struct LruCacheSharedStats stats;
 };
 
 template<typename Key, typename Data, typename Hash>
-bool LruCacheShared<Key, Data, Hash>::set_max_size(size_t newsize)
+void LruCacheShared<Key, Data, Hash>::set_shard_sizes()
 {
-    LruListIter list_iter;
+    //  Round up so the total is never less than max_size.
+    size_t shard_size = (max_size + num_shards - 1) / num_shards;
 
-    if (newsize <= 0)
-        return false;   //  Not allowed to set size to zero.
+    if ( !shard_size )
+        shard_size = 1;
 
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    for ( unsigned i = 0; i < num_shards; ++i )
+    {
+        Shard& shard = shards[i];
+        std::lock_guard<std::mutex> cache_lock(shard.cache_mutex);
+        shard.max_size = shard_size;
+        prune(shard);
+    }
+}
 
+template<typename Key, typename Data, typename Hash>
+void LruCacheShared<Key, Data, Hash>::prune(Shard& shard)
+{
     //  Remove the oldest entries if we have to reduce cache size.
-    list_iter=list.end();
-    while (current_size > newsize)
+    while (shard.current_size > shard.max_size)
     {
+        LruListIter list_iter = shard.list.end();
         list_iter--;
-        current_size--;
-        map.erase(list_iter->first);
-        list.erase(list_iter);
+        shard.current_size--;
+        shard.map.erase(list_iter->first);
+        shard.list.erase(list_iter);
     }
+}
 
+template<typename Key, typename Data, typename Hash>
+bool LruCacheShared<Key, Data, Hash>::set_max_size(size_t newsize)
+{
+    if (newsize <= 0)
+        return false;   //  Not allowed to set size to zero.
+
+    std::lock_guard<std::mutex> size_lock(size_mutex);
     max_size = newsize;
+    set_shard_sizes();
     return true;
 }
 
@@ -162,41 +245,42 @@ template<typename Key, typename Data, typename Hash>
 void LruCacheShared<Key, Data, Hash>::insert(const Key& key, const Data& data)
 {
     LruMapIter map_iter;
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    Shard& shard = get_shard(key);
+    std::unique_lock<std::mutex> cache_lock = lock_shard(shard);
 
     //  If key already exists, remove it.
-    map_iter = map.find(key);
-    if (map_iter != map.end())
+    map_iter = shard.map.find(key);
+    if (map_iter != shard.map.end())
     {
-        current_size--;
-        list.erase(map_iter->second);
-        map.erase(map_iter);
-        stats.replaces++;
+        shard.current_size--;
+        shard.list.erase(map_iter->second);
+        shard.map.erase(map_iter);
+        shard.stats.replaces++;
     }
     else
     {
-        stats.adds++;
+        shard.stats.adds++;
     }
 
     //  Add key/data pair to front of list.
-    list.push_front(std::make_pair(key, data));
+    shard.list.push_front(std::make_pair(key, data));
 
     //  Add list iterator for the new entry to map.
-    map[key] = list.begin();
+    shard.map[key] = shard.list.begin();
 
     //  If we've exceeded the configured size, remove the oldest entry.
-    if (current_size >= max_size)
+    if (shard.current_size >= shard.max_size)
     {
         LruListIter list_iter;
-        list_iter = list.end();
+        list_iter = shard.list.end();
         list_iter--;
-        map.erase(list_iter->first);
-        list.erase(list_iter);
-        stats.prunes++;
+        shard.map.erase(list_iter->first);
+        shard.list.erase(list_iter);
+        shard.stats.prunes++;
     }
     else
     {
-        current_size++;
+        shard.current_size++;
     }
 }
 
@@ -204,12 +288,13 @@ template<typename Key, typename Data, typename Hash>
 bool LruCacheShared<Key, Data, Hash>::find(const Key& key, Data& data, bool update)
 {
     LruMapIter map_iter;
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    Shard& shard = get_shard(key);
+    std::unique_lock<std::mutex> cache_lock = lock_shard(shard);
 
-    map_iter = map.find(key);
-    if (map_iter == map.end())
+    map_iter = shard.map.find(key);
+    if (map_iter == shard.map.end())
     {
-        stats.find_misses++;
+        shard.stats.find_misses++;
         return false;   //  Key is not in LruCache.
     }
 
@@ -217,9 +302,9 @@ bool LruCacheShared<Key, Data, Hash>::find(const Key& key, Data& data, bool upda
 
     //  If needed, move entry to front of LruList
     if (update)
-        list.splice(list.begin(), list, map_iter->second);
+        shard.list.splice(shard.list.begin(), shard.list, map_iter->second);
 
-    stats.find_hits++;
+    shard.stats.find_hits++;
     return true;
 }
 
@@ -227,16 +312,17 @@ template<typename Key, typename Data, typename Hash>
 bool LruCacheShared<Key, Data, Hash>::remove(const Key& key)
 {
     LruMapIter map_iter;
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    Shard& shard = get_shard(key);
+    std::unique_lock<std::mutex> cache_lock = lock_shard(shard);
 
-    map_iter = map.find(key);
-    if (map_iter == map.end())
+    map_iter = shard.map.find(key);
+    if (map_iter == shard.map.end())
         return false;   //  Key is not in LruCache.
 
-    current_size--;
-    list.erase(map_iter->second);
-    map.erase(map_iter);
-    stats.removes++;
+    shard.current_size--;
+    shard.list.erase(map_iter->second);
+    shard.map.erase(map_iter);
+    shard.stats.removes++;
     return(true);
 }
 
@@ -244,52 +330,78 @@ template<typename Key, typename Data, typename Hash>
 bool LruCacheShared<Key, Data, Hash>::remove(const Key& key, Data& data)
 {
     LruMapIter map_iter;
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    Shard& shard = get_shard(key);
+    std::unique_lock<std::mutex> cache_lock = lock_shard(shard);
 
-    map_iter = map.find(key);
-    if (map_iter == map.end())
+    map_iter = shard.map.find(key);
+    if (map_iter == shard.map.end())
         return false;   //  Key is not in LruCache.
 
     data = map_iter->second->second;
 
-    current_size--;
-    list.erase(map_iter->second);
-    map.erase(map_iter);
-    stats.removes++;
+    shard.current_size--;
+    shard.list.erase(map_iter->second);
+    shard.map.erase(map_iter);
+    shard.stats.removes++;
     return(true);
 }
 
 template<typename Key, typename Data, typename Hash>
 void LruCacheShared<Key, Data, Hash>::clear()
 {
-    LruMapIter map_iter;
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
-
-    for (map_iter = map.begin(); map_iter != map.end(); /* No incr */)
+    for ( unsigned i = 0; i < num_shards; ++i )
     {
-        list.erase(map_iter->second);
+        Shard& shard = shards[i];
+        std::unique_lock<std::mutex> cache_lock = lock_shard(shard);
 
-        //  erase returns next iterator after erased element.
-        map_iter = map.erase(map_iter);
+        shard.map.clear();
+        shard.list.clear();
+        shard.current_size = 0;
     }
 
-    current_size = 0;
-    stats.clears++;
+    //  Counted once per call, not per shard.
+    std::lock_guard<std::mutex> cache_lock(shards[0].cache_mutex);
+    shards[0].stats.clears++;
 }
 
 template<typename Key, typename Data, typename Hash>
 std::vector<std::pair<Key, Data> > LruCacheShared<Key, Data, Hash>::get_all_data()
 {
     std::vector<std::pair<Key, Data> > vec;
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
 
-    for (auto& entry : list )
+    for ( unsigned i = 0; i < num_shards; ++i )
     {
-        vec.push_back(entry);
+        std::lock_guard<std::mutex> cache_lock(shards[i].cache_mutex);
+
+        for (auto& entry : shards[i].list )
+        {
+            vec.push_back(entry);
+        }
     }
 
     return vec;
 }
 
+template<typename Key, typename Data, typename Hash>
+PegCount* LruCacheShared<Key, Data, Hash>::get_counts() const
+{
+    const unsigned n = sizeof(stats) / sizeof(PegCount);
+    PegCount* sum = (PegCount*)&stats;
+
+    for ( unsigned c = 0; c < n; ++c )
+        sum[c] = 0;
+
+    for ( unsigned i = 0; i < num_shards; ++i )
+    {
+        std::lock_guard<std::mutex> cache_lock(shards[i].cache_mutex);
+        const PegCount* pc = (const PegCount*)&shards[i].stats;
+
+        for ( unsigned c = 0; c < n; ++c )
+            sum[c] += pc[c];
+    }
+
+    return sum;
+}
+
 #endif
 
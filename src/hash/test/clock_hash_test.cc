@@ -0,0 +1,209 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// clock_hash_test.cc
+// unit tests for ClockHash class
+
+#include "hash/clock_hash.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+#include <string.h>
+
+struct TestKey
+{
+    uint32_t a;
+    uint32_t b;
+};
+
+static unsigned s_hash_mask = 0xFFFFFFFF;
+
+static unsigned test_hash(SFHASHFCN*, unsigned char* d, int)
+{
+    const TestKey* k = (const TestKey*)d;
+    return (k->a * 2654435761u ^ k->b) & s_hash_mask;
+}
+
+static int test_cmp(const void* s1, const void* s2, size_t n)
+{
+    return memcmp(s1, s2, n);
+}
+
+static const unsigned max_nodes = 64;
+
+TEST_GROUP(clock_hash)
+{
+    ClockHash* ch = nullptr;
+    int data[max_nodes];
+    void* keys[max_nodes];
+
+    void setup() override
+    {
+        s_hash_mask = 0xFFFFFFFF;
+        ch = new ClockHash(max_nodes, sizeof(TestKey), test_hash, test_cmp);
+
+        for ( unsigned i = 0; i < max_nodes; ++i )
+        {
+            data[i] = i;
+            keys[i] = ch->push(data + i);
+        }
+    }
+
+    void teardown() override
+    {
+        delete ch;
+    }
+};
+
+TEST(clock_hash, get_find_remove)
+{
+    TestKey k = { 1, 2 };
+
+    CHECK(ch->find(&k) == nullptr);
+
+    void* p = ch->get(&k);
+    CHECK(p != nullptr);
+    CHECK(ch->get_count() == 1);
+    CHECK(ch->find(&k) == p);
+    CHECK(ch->get(&k) == p);
+    CHECK(ch->get_count() == 1);
+
+    CHECK(ch->remove(&k));
+    CHECK(ch->get_count() == 0);
+    CHECK(ch->find(&k) == nullptr);
+    CHECK(!ch->remove(&k));
+}
+
+TEST(clock_hash, fill_and_exhaust)
+{
+    TestKey k = { 0, 0 };
+
+    for ( unsigned i = 0; i < max_nodes; ++i )
+    {
+        k.a = i;
+        CHECK(ch->get(&k) != nullptr);
+    }
+    CHECK(ch->get_count() == max_nodes);
+
+    k.a = max_nodes;
+    CHECK(ch->get(&k) == nullptr);
+
+    for ( unsigned i = 0; i < max_nodes; ++i )
+    {
+        k.a = i;
+        CHECK(ch->find(&k) != nullptr);
+    }
+}
+
+TEST(clock_hash, collisions_overflow)
+{
+    // force everything into the same home bucket
+    s_hash_mask = 0xFFFF0000;
+    TestKey k = { 0, 0 };
+
+    for ( unsigned i = 0; i < 32; ++i )
+    {
+        k.b = i << 16;
+        CHECK(ch->get(&k) != nullptr);
+    }
+
+    // remove from the home bucket; overflowed entries must still be found
+    for ( unsigned i = 0; i < 8; ++i )
+    {
+        k.b = i << 16;
+        CHECK(ch->remove(&k));
+    }
+
+    for ( unsigned i = 8; i < 32; ++i )
+    {
+        k.b = i << 16;
+        CHECK(ch->find(&k) != nullptr);
+    }
+
+    for ( unsigned i = 8; i < 32; ++i )
+    {
+        k.b = i << 16;
+        CHECK(ch->remove(&k));
+    }
+    CHECK(ch->get_count() == 0);
+}
+
+TEST(clock_hash, remove_by_node_key)
+{
+    TestKey k = { 7, 7 };
+
+    // free nodes are used last pushed first
+    CHECK(ch->get(&k) == data + max_nodes - 1);
+    CHECK(!memcmp(keys[max_nodes - 1], &k, sizeof(k)));
+
+    CHECK(ch->remove(keys[max_nodes - 1]));
+    CHECK(!ch->remove(keys[max_nodes - 1]));
+
+    bool ref;
+    CHECK(ch->sweep(ref) == nullptr);
+    CHECK(ch->scan() == nullptr);
+}
+
+TEST(clock_hash, second_chance)
+{
+    TestKey k = { 0, 0 };
+
+    k.a = 1;
+    void* one = ch->get(&k);
+    k.a = 2;
+    void* two = ch->get(&k);
+
+    bool ref = false;
+
+    // new nodes start referenced
+    CHECK(ch->sweep(ref) == one);
+    CHECK(ref);
+    CHECK(ch->sweep(ref) == two);
+    CHECK(ref);
+
+    k.a = 2;
+    ch->find(&k);
+
+    CHECK(ch->sweep(ref) == one);
+    CHECK(!ref);
+    CHECK(ch->sweep(ref) == two);
+    CHECK(ref);
+
+    // scan doesn't change reference bits
+    CHECK(ch->scan() == one);
+    CHECK(ch->scan() == two);
+    CHECK(ch->sweep(ref) == one);
+    CHECK(!ref);
+}
+
+TEST(clock_hash, pop)
+{
+    unsigned n = 0;
+
+    while ( ch->pop() )
+        ++n;
+
+    CHECK(n == max_nodes);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
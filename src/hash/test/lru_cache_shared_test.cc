@@ -206,6 +206,56 @@ TEST(lru_cache_shared, stats_test)
     CHECK(!strcmp(pegs[4].name, "lru cache find misses"));
     CHECK(!strcmp(pegs[5].name, "lru cache removes"));
     CHECK(!strcmp(pegs[6].name, "lru cache clears"));
+    CHECK(!strcmp(pegs[7].name, "lru cache lock contention"));
+    CHECK(!pegs[8].name);
+}
+
+//  Test a cache split into shards.
+TEST(lru_cache_shared, shard_test)
+{
+    std::string data;
+    LruCacheShared<int, std::string, std::hash<int> > lru_cache(8, 4);
+
+    CHECK(4 == lru_cache.get_num_shards());
+    CHECK(8 == lru_cache.get_max_size());
+
+    //  Keys 0, 4, 8, ... all land in the same shard which holds 2.
+    for (int i = 0; i < 4; i++)
+    {
+        lru_cache.insert(i * 4, std::to_string(i * 4));
+    }
+
+    CHECK(2 == lru_cache.size());
+    CHECK(false == lru_cache.find(0, data));
+    CHECK(false == lru_cache.find(4, data));
+    CHECK(true == lru_cache.find(8, data));
+    CHECK(true == lru_cache.find(12, data));
+
+    //  Other shards are unaffected.
+    for (int i = 1; i < 4; i++)
+    {
+        lru_cache.insert(i, std::to_string(i));
+    }
+
+    CHECK(5 == lru_cache.size());
+    CHECK(5 == lru_cache.get_all_data().size());
+
+    //  Shrinking prunes each shard to its part of the new size.
+    CHECK(true == lru_cache.set_max_size(4));
+    CHECK(4 == lru_cache.get_max_size());
+    CHECK(4 == lru_cache.size());
+    CHECK(true == lru_cache.find(12, data));
+    CHECK(false == lru_cache.find(8, data));
+
+    lru_cache.clear();
+    CHECK(0 == lru_cache.size());
+
+    PegCount* stats = lru_cache.get_counts();
+
+    CHECK(stats[0] == 7);   //  adds
+    CHECK(stats[2] == 2);   //  prunes
+    CHECK(stats[6] == 1);   //  clears
+    CHECK(stats[7] == 0);   //  lock contention
 }
 
 int main(int argc, char** argv)
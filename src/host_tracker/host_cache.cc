@@ -25,8 +25,11 @@
 
 #define LRU_CACHE_INITIAL_SIZE 65535
 
+// shared by all packet threads so split the locking
+#define LRU_CACHE_SHARDS 16
+
 LruCacheShared<HostIpKey, std::shared_ptr<HostTracker>, HashHostIpKey>
-    host_cache(LRU_CACHE_INITIAL_SIZE);
+    host_cache(LRU_CACHE_INITIAL_SIZE, LRU_CACHE_SHARDS);
 
 void host_cache_add_host_tracker(HostTracker* ht)
 {
@@ -71,7 +71,8 @@ TEST(host_cache_module, host_cache_module_test_values)
     CHECK(!strcmp(ht_pegs[4].name, "lru cache find misses"));
     CHECK(!strcmp(ht_pegs[5].name, "lru cache removes"));
     CHECK(!strcmp(ht_pegs[6].name, "lru cache clears"));
-    CHECK(!ht_pegs[7].name);
+    CHECK(!strcmp(ht_pegs[7].name, "lru cache lock contention"));
+    CHECK(!ht_pegs[8].name);
 
     CHECK(ht_stats[0] == 0);
     CHECK(ht_stats[1] == 0);
@@ -80,6 +81,7 @@ TEST(host_cache_module, host_cache_module_test_values)
     CHECK(ht_stats[4] == 0);
     CHECK(ht_stats[5] == 0);
     CHECK(ht_stats[6] == 0);
+    CHECK(ht_stats[7] == 0);
 
     size_val.set(&size_param);
 
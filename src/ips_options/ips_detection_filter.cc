@@ -57,6 +57,9 @@ static const Parameter s_params[] =
     { "seconds", Parameter::PT_INT, "1:", nullptr,
       "length of interval to count hits" },
 
+    { "shared", Parameter::PT_IMPLIED, nullptr, nullptr,
+      "count hits from all packet threads together" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -93,6 +96,9 @@ bool DetectionFilterModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("seconds") )
         thdx.seconds = v.get_long();
 
+    else if ( v.is("shared") )
+        thdx.shared = true;
+
     else
         return false;
 
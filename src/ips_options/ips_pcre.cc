@@ -28,6 +28,11 @@
 #include <sys/types.h>
 #include <pcre.h>
 
+#ifdef HAVE_HYPERSCAN
+#include <hs_compile.h>
+#include <hs_runtime.h>
+#endif
+
 #include "main/snort_types.h"
 #include "main/snort_debug.h"
 #include "main/snort_config.h"
@@ -44,20 +49,24 @@
 #include "framework/parameter.h"
 #include "framework/module.h"
 
+// JIT requires pcre 8.20 or later
 #ifndef PCRE_STUDY_JIT_COMPILE
-#define PCRE_STUDY_JIT_COMPILE 0
+#define NO_JIT
 #endif
 
-#define NO_JIT // uncomment to disable JIT for Xcode
+//#define NO_JIT // uncomment to disable JIT for Xcode
 
 #ifdef NO_JIT
-#define PCRE_STUDY_FLAGS 0
+#undef PCRE_STUDY_JIT_COMPILE
+#define PCRE_STUDY_JIT_COMPILE 0
 #define pcre_release(x) pcre_free(x)
 #else
-#define PCRE_STUDY_FLAGS PCRE_STUDY_JIT_COMPILE
 #define pcre_release(x) pcre_free_study(x)
 #endif
 
+// the JIT stack grows from this to the configured maximum
+#define JIT_STACK_START 32768
+
 #define SNORT_PCRE_RELATIVE         0x00010 // relative to the end of the last match
 #define SNORT_PCRE_INVERT           0x00020 // invert detect
 #define SNORT_PCRE_ANCHORED         0x00040
@@ -72,6 +81,9 @@ struct PcreData
     bool free_pe;
     int options;        /* sp_pcre specfic options (relative & inverse) */
     char* expression;
+#ifdef HAVE_HYPERSCAN
+    hs_database_t* hs_db;  /* prefilter or null */
+#endif
 };
 
 /*
@@ -94,6 +106,37 @@ static int s_ovector_size = 0;
 
 static THREAD_LOCAL ProfileStats pcrePerfStats;
 
+struct PcreStats
+{
+    PegCount evals;
+    PegCount match_limit;
+    PegCount recursion_limit;
+    PegCount jit_stack_limit;
+    PegCount errors;
+    PegCount prefilter_skips;
+    PegCount prefilter_hits;
+};
+
+const PegInfo pcre_pegs[] =
+{
+    { "evals", "total pcre_exec calls" },
+    { "match limit", "evaluations that hit pcre_match_limit (counted as no match)" },
+    { "recursion limit", "evaluations that hit pcre_match_limit_recursion (counted as no match)" },
+    { "jit stack limit", "evaluations that ran out of JIT stack (counted as no match)" },
+    { "errors", "evaluations that failed for other reasons" },
+    { "prefilter skips", "pcre evaluations skipped because the prefilter didn't match" },
+    { "prefilter hits", "pcre evaluations done because the prefilter matched" },
+    { nullptr, nullptr }
+};
+
+static THREAD_LOCAL PcreStats s_stats;
+
+#ifdef HAVE_HYPERSCAN
+// like regex, the prefilters are allocated scratch in the main thread and
+// it is cloned for the packet threads by pcre_setup().
+static hs_scratch_t* s_scratch = nullptr;
+#endif
+
 //-------------------------------------------------------------------------
 // implementation foo
 //-------------------------------------------------------------------------
@@ -160,7 +203,90 @@ static void pcre_check_anchored(PcreData* pcre_data)
     }
 }
 
-static void pcre_parse(const char* data, PcreData* pcre_data)
+#ifndef NO_JIT
+// called by pcre_exec in the packet thread; null means use 32K of the
+// machine stack
+static pcre_jit_stack* pcre_get_jit_stack(void*)
+{
+    SnortState* ss = snort_conf->state + get_instance_id();
+    return (pcre_jit_stack*)ss->pcre_jit_stack;
+}
+#endif
+
+#ifdef HAVE_HYPERSCAN
+// a prefilter matches wherever the regex could (and maybe elsewhere) so
+// if it misses, pcre need not run.  regexes hyperscan can't handle even
+// as a prefilter, including those matching an empty string, only use pcre.
+static void pcre_prefilter(const char* re, int compile_flags, PcreData* pcre_data)
+{
+    // A, E, and G are ignored since they only remove matches
+    if ( compile_flags & PCRE_EXTENDED )
+        return;
+
+    unsigned flags = HS_FLAG_PREFILTER;
+
+    if ( compile_flags & PCRE_CASELESS )
+        flags |= HS_FLAG_CASELESS;
+
+    if ( compile_flags & PCRE_DOTALL )
+        flags |= HS_FLAG_DOTALL;
+
+    if ( compile_flags & PCRE_MULTILINE )
+        flags |= HS_FLAG_MULTILINE;
+
+    hs_compile_error_t* err = nullptr;
+
+    if ( hs_compile(re, flags, HS_MODE_BLOCK, nullptr, &pcre_data->hs_db, &err)
+        or !pcre_data->hs_db )
+    {
+        hs_free_compile_error(err);
+        pcre_data->hs_db = nullptr;
+        return;
+    }
+
+    if ( hs_alloc_scratch(pcre_data->hs_db, &s_scratch) )
+    {
+        hs_free_database(pcre_data->hs_db);
+        pcre_data->hs_db = nullptr;
+    }
+}
+
+// stop at the first match that could end a match of the regex starting
+// at the given offset; the whole buffer is scanned for lookbehinds
+static int pcre_prefilter_match(
+    unsigned /*id*/, unsigned long long /*from*/, unsigned long long to,
+    unsigned /*flags*/, void* pv)
+{
+    return to >= *(unsigned*)pv;
+}
+
+static bool pcre_prefilter_miss(
+    const PcreData* pcre_data, const uint8_t* buf, int len, int start_offset)
+{
+    SnortState* ss = snort_conf->state + get_instance_id();
+
+    if ( !ss->pcre_scratch )
+        return false;
+
+    unsigned start = start_offset;
+
+    hs_error_t stat = hs_scan(
+        pcre_data->hs_db, (const char*)buf, len, 0,
+        (hs_scratch_t*)ss->pcre_scratch, pcre_prefilter_match, &start);
+
+    // a match terminates the scan; errors are also left to pcre
+    if ( stat != HS_SUCCESS )
+    {
+        s_stats.prefilter_hits++;
+        return false;
+    }
+
+    s_stats.prefilter_skips++;
+    return true;
+}
+#endif
+
+static void pcre_parse(SnortConfig* sc, const char* data, PcreData* pcre_data)
 {
     const char* error;
     char* re, * free_me;
@@ -273,7 +399,8 @@ static void pcre_parse(const char* data, PcreData* pcre_data)
     }
 
     /* now study it... */
-    pcre_data->pe = pcre_study(pcre_data->re, PCRE_STUDY_FLAGS, &error);
+    pcre_data->pe = pcre_study(
+        pcre_data->re, sc->pcre_jit ? PCRE_STUDY_JIT_COMPILE : 0, &error);
 
     if (pcre_data->pe)
     {
@@ -344,6 +471,21 @@ static void pcre_parse(const char* data, PcreData* pcre_data)
     pcre_capture(pcre_data->re, pcre_data->pe);
     pcre_check_anchored(pcre_data);
 
+#ifndef NO_JIT
+    {
+        int jit = 0;
+
+        if ( pcre_data->pe and !pcre_data->free_pe and
+            !pcre_fullinfo(pcre_data->re, pcre_data->pe, PCRE_INFO_JIT, &jit) and jit )
+            pcre_assign_jit_stack(pcre_data->pe, pcre_get_jit_stack, nullptr);
+    }
+#endif
+
+#ifdef HAVE_HYPERSCAN
+    if ( sc->pcre_prefilter )
+        pcre_prefilter(re, compile_flags, pcre_data);
+#endif
+
     snort_free(free_me);
     return;
 
@@ -391,6 +533,11 @@ static bool pcre_search(
 
     *found_offset = -1;
 
+#ifdef HAVE_HYPERSCAN
+    if ( pcre_data->hs_db and pcre_prefilter_miss(pcre_data, buf, len, start_offset) )
+        return (pcre_data->options & SNORT_PCRE_INVERT) != 0;
+#endif
+
     SnortState* ss = snort_conf->state + get_instance_id();
     assert(ss->pcre_ovector);
 
@@ -404,6 +551,8 @@ static bool pcre_search(
         ss->pcre_ovector,      /* vector for substring information */
         snort_conf->pcre_ovector_size); /* number of elements in the vector */
 
+    s_stats.evals++;
+
     if (result >= 0)
     {
         matched = true;
@@ -435,6 +584,22 @@ static bool pcre_search(
     }
     else
     {
+        if ( result == PCRE_ERROR_MATCHLIMIT )
+            s_stats.match_limit++;
+
+#ifdef PCRE_ERROR_RECURSIONLIMIT
+        else if ( result == PCRE_ERROR_RECURSIONLIMIT )
+            s_stats.recursion_limit++;
+#endif
+
+#ifdef PCRE_ERROR_JIT_STACKLIMIT
+        else if ( result == PCRE_ERROR_JIT_STACKLIMIT )
+            s_stats.jit_stack_limit++;
+#endif
+
+        else
+            s_stats.errors++;
+
         DebugFormat(DEBUG_PATTERN_MATCH, "pcre_exec error : %d \n", result);
         return false;
     }
@@ -502,6 +667,11 @@ PcreOption::~PcreOption()
     if ( config->re )
         free(config->re);  // external allocation
 
+#ifdef HAVE_HYPERSCAN
+    if ( config->hs_db )
+        hs_free_database(config->hs_db);
+#endif
+
     snort_free(config);
 }
 
@@ -644,6 +814,22 @@ void pcre_setup(SnortConfig* sc)
     {
         SnortState* ss = sc->state + i;
         ss->pcre_ovector = (int*)snort_calloc(s_ovector_max, sizeof(int));
+
+#ifndef NO_JIT
+        if ( sc->pcre_jit and sc->pcre_jit_stack )
+        {
+            unsigned max = sc->pcre_jit_stack;
+            unsigned start = max < JIT_STACK_START ? max : JIT_STACK_START;
+            ss->pcre_jit_stack = pcre_jit_stack_alloc(start, max);
+        }
+#endif
+
+#ifdef HAVE_HYPERSCAN
+        if ( s_scratch )
+            hs_clone_scratch(s_scratch, (hs_scratch_t**)&ss->pcre_scratch);
+        else
+            ss->pcre_scratch = nullptr;
+#endif
     }
 }
 
@@ -657,6 +843,20 @@ void pcre_cleanup(SnortConfig* sc)
             snort_free(ss->pcre_ovector);
 
         ss->pcre_ovector = nullptr;
+
+#ifndef NO_JIT
+        if ( ss->pcre_jit_stack )
+            pcre_jit_stack_free((pcre_jit_stack*)ss->pcre_jit_stack);
+
+        ss->pcre_jit_stack = nullptr;
+#endif
+
+#ifdef HAVE_HYPERSCAN
+        if ( ss->pcre_scratch )
+            hs_free_scratch((hs_scratch_t*)ss->pcre_scratch);
+
+        ss->pcre_scratch = nullptr;
+#endif
     }
 }
 
@@ -687,6 +887,12 @@ public:
     bool begin(const char*, int, SnortConfig*) override;
     bool set(const char*, Value&, SnortConfig*) override;
 
+    const PegInfo* get_pegs() const override
+    { return pcre_pegs; }
+
+    PegCount* get_counts() const override
+    { return (PegCount*)&s_stats; }
+
     ProfileStats* get_profile() const override
     { return &pcrePerfStats; }
 
@@ -709,10 +915,10 @@ bool PcreModule::begin(const char*, int, SnortConfig*)
     return true;
 }
 
-bool PcreModule::set(const char*, Value& v, SnortConfig*)
+bool PcreModule::set(const char*, Value& v, SnortConfig* sc)
 {
     if ( v.is("~re") )
-        pcre_parse(v.get_string(), data);
+        pcre_parse(sc, v.get_string(), data);
 
     else
         return false;
@@ -746,6 +952,16 @@ static void pcre_dtor(IpsOption* p)
     delete p;
 }
 
+static void pcre_pterm(SnortConfig*)
+{
+#ifdef HAVE_HYPERSCAN
+    if ( s_scratch )
+        hs_free_scratch(s_scratch);
+
+    s_scratch = nullptr;
+#endif
+}
+
 static void pcre_verify(SnortConfig* sc)
 {
     /* The pcre_fullinfo() function can be used to find out how many
@@ -780,7 +996,7 @@ static const IpsApi pcre_api =
     OPT_TYPE_DETECTION,
     0, 0,
     nullptr,
-    nullptr,
+    pcre_pterm,
     nullptr,
     nullptr,
     pcre_ctor,
@@ -65,6 +65,7 @@
 #include "protocols/ipv4_options.h"
 #include "protocols/tcp_options.h"
 #include "protocols/packet_manager.h"
+#include "protocols/packet_pool.h"
 
 /*--------------------------------------------------------------------
  * utility functions
@@ -790,8 +791,8 @@ static void LogICMPEmbeddedIP(TextLog* log, Packet* p)
     if (log == NULL || p == NULL)
         return;
 
-    // FIXIT-L -- Allocating a new Packet here is ridiculously excessive.
-    Packet* orig_p = new Packet;
+    // FIXIT-L only the ip and port fields are needed here
+    Packet* orig_p = PacketPool::acquire();
     Packet& op = *orig_p;
 
     if (!layer::set_api_ip_embed_icmp(p, op.ptrs.ip_api))
@@ -874,7 +875,7 @@ static void LogICMPEmbeddedIP(TextLog* log, Packet* p)
         TextLog_Puts(log, "** END OF DUMP");
     }
 
-    delete orig_p;
+    PacketPool::release(orig_p);
 }
 
 /*--------------------------------------------------------------------
@@ -32,13 +32,20 @@
 #endif
 
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <time.h>
+#include <unistd.h>
 #include <netinet/in.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include "main/snort_types.h"
 #include "main/snort_debug.h"
@@ -74,6 +81,8 @@ typedef struct _Unified2Config
     int nostamp;
     int mpls_event_types;
     int vlan_event_types;
+    size_t ring_size;        // 0 => write from the packet thread
+    bool ring_drop;          // drop records instead of blocking when full
 } Unified2Config;
 
 typedef struct _Unified2LogCallbackData
@@ -84,46 +93,68 @@ typedef struct _Unified2LogCallbackData
     uint32_t num_bytes;
 } Unified2LogCallbackData;
 
+class U2Ring;
+
 struct U2
 {
     int base_proto;
     uint32_t timestamp;
     char filepath[STD_BUF];
-    FILE* stream;
+    int fd;
     unsigned int current;
+    U2Ring* ring;
+};
+
+struct U2Stats
+{
+    PegCount records;
+    PegCount ring_full;
+    PegCount dropped;
+    PegCount writes;
 };
 
 /* -------------------- Global Variables ----------------------*/
 
 static THREAD_LOCAL U2 u2;
+static THREAD_LOCAL U2Stats u2_stats;
+static THREAD_LOCAL PegCount u2_ring_writes;
+
+static const PegInfo u2_pegs[] =
+{
+    { "records", "records serialized" },
+    { "ring full", "records that found the ring full" },
+    { "dropped", "records dropped because the ring was full" },
+    { "writes", "file writes" },
+    { nullptr, nullptr }
+};
 
 /* Used for buffering header and payload of unified records so only one
  * write is necessary. */
 constexpr unsigned u2_buf_sz =
     sizeof(Serial_Unified2_Header) + sizeof(Unified2IDSEventIPv6) + IP_MAXPACKET;
 
-// TBD - is performance any better if these buffers are off the heap?
+// records are serialized here when there is no ring
 static THREAD_LOCAL uint8_t write_pkt_buffer[u2_buf_sz];
 
 #define MAX_XDATA_WRITE_BUF_LEN \
     (MAX_XFF_WRITE_BUF_LENGTH - \
     sizeof(struct in6_addr) + DECODE_BLEN)
 
-/* This buffer is used in lieu of the underlying default stream buf to
- * prevent flushing in the middle of a record.  Every write is force
- * flushed to disk immediately after the entire record is written so
- * spoolers get an entire record */
+static_assert(MAX_XDATA_WRITE_BUF_LEN <= u2_buf_sz, "extra data must fit the record buffer");
 
-/* use the size of the buffer we copy record data into */
-static THREAD_LOCAL char io_buffer[u2_buf_sz];
+// the ring must hold the largest record even when it has to wrap
+constexpr unsigned u2_min_ring_sz = 2 * u2_buf_sz;
+
+// most records are contiguous in the ring so this is plenty
+constexpr int u2_max_iov = 64;
 
 /* -------------------- Local Functions -----------------------*/
 
 /* Unified2 Output functions */
-static void Unified2InitFile(Unified2Config*);
-static inline void Unified2RotateFile(Unified2Config*);
+static void Unified2InitFile(U2&, Unified2Config*);
+static inline void Unified2RotateFile(U2&, Unified2Config*);
 static void _Unified2LogPacketAlert(Packet*, const char*, Unified2Config*, Event*);
-static void Unified2Write(uint8_t*, uint32_t, Unified2Config*);
+static void Unified2Write(U2&, Unified2Config*, const struct iovec*, int, uint32_t);
 
 static void _AlertIP4_v2(Packet*, const char*, Unified2Config*, Event*);
 static void _AlertIP6_v2(Packet*, const char*, Unified2Config*, Event*);
@@ -163,11 +194,12 @@ static int GetU2Flags(const Packet*, uint8_t* pimpact)
  *
  * Purpose: Initialize the unified2 output file
  *
- * Arguments: config => pointer to the plugin's reference data struct
+ * Arguments: f => the thread's file state
+ *            config => pointer to the plugin's reference data struct
  *
  * Returns: void function
  */
-static void Unified2InitFile(Unified2Config* config)
+static void Unified2InitFile(U2& f, Unified2Config* config)
 {
     char filepath[STD_BUF];
     char* fname_ptr;
@@ -178,12 +210,12 @@ static void Unified2InitFile(Unified2Config* config)
             "configuration data is NULL.\n", __FILE__, __LINE__);
     }
 
-    u2.timestamp = (uint32_t)time(NULL);
+    f.timestamp = (uint32_t)time(NULL);
 
     if (!config->nostamp)
     {
         if (SnortSnprintf(filepath, sizeof(filepath), "%s.%u",
-            u2.filepath, u2.timestamp) != SNORT_SNPRINTF_SUCCESS)
+            f.filepath, f.timestamp) != SNORT_SNPRINTF_SUCCESS)
         {
             FatalError("%s(%d) Failed to copy unified2 file path.\n",
                 __FILE__, __LINE__);
@@ -193,30 +225,22 @@ static void Unified2InitFile(Unified2Config* config)
     }
     else
     {
-        fname_ptr = u2.filepath;
+        fname_ptr = f.filepath;
     }
 
-    // FIXIT-P should use open() instead of fopen()
-    if ((u2.stream = fopen(fname_ptr, "wb")) == NULL)
+    /* Records are always written whole with a single call so there is
+     * no stdio buffer to flush in the middle of a record */
+    if ((f.fd = open(fname_ptr, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
     {
         FatalError("%s(%d) Could not open %s: %s\n",
             __FILE__, __LINE__, fname_ptr, get_error(errno));
     }
 
-    /* Set buffer to size of record buffer so the system doesn't flush
-     * part of a record if it's greater than BUFSIZ */
-    if (setvbuf(u2.stream, io_buffer, _IOFBF, sizeof(io_buffer)) != 0)
-    {
-        ErrorMessage("%s(%d) Could not set I/O buffer: %s. "
-            "Using system default.\n",
-            __FILE__, __LINE__, get_error(errno));
-    }
-
     /* If test mode, close and delete the file */
     if (SnortConfig::test_mode())  // FIXIT-L eliminate test check; should always remove if empty
     {
-        fclose(u2.stream);
-        u2.stream = NULL;
+        ::close(f.fd);
+        f.fd = -1;
         if (unlink(fname_ptr) == -1)
         {
             ErrorMessage("%s(%d) Running in test mode so we want to remove "
@@ -226,11 +250,278 @@ static void Unified2InitFile(Unified2Config* config)
     }
 }
 
-static inline void Unified2RotateFile(Unified2Config* config)
+static inline void Unified2RotateFile(U2& f, Unified2Config* config)
+{
+    if ( f.fd >= 0 )
+        ::close(f.fd);
+
+    f.current = 0;
+    Unified2InitFile(f, config);
+}
+
+//-------------------------------------------------------------------------
+// record ring
+//
+// Records are serialized directly into a per thread ring and drained by a
+// writer thread which also handles rotation so alert storms and file
+// rotation don't stall packet processing.  The packet thread only moves
+// head and the writer only moves tail; the mutex is taken only to sleep or
+// to wake a sleeper.  A record that doesn't fit before the end of the ring
+// starts at the beginning and the remainder is skipped.  A skipped area
+// large enough for a header gets one with type 0.
+//-------------------------------------------------------------------------
+
+class U2Ring
+{
+public:
+    U2Ring(U2*, Unified2Config*);
+
+    // drains the ring before returning
+    ~U2Ring();
+
+    // returns space for a record of len bytes or nullptr if the ring is
+    // full and the policy is to drop
+    uint8_t* reserve(uint32_t len);
+
+    // publishes the record last reserved
+    void commit(uint32_t len);
+
+    PegCount get_writes() const
+    { return writes.load(std::memory_order_relaxed); }
+
+private:
+    void writer();
+    void drain(uint64_t end);
+    void flush(struct iovec*, int& cnt, uint32_t& len, uint64_t pos);
+
+private:
+    U2* file;
+    Unified2Config* config;
+
+    uint8_t* buf;
+    uint64_t size;
+    uint64_t next;  // start of the reserved record; packet thread only
+
+    // byte offsets that only increase
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+
+    std::atomic<bool> writer_idle;
+    std::atomic<bool> producer_waiting;
+    std::atomic<PegCount> writes;
+    bool done;
+
+    std::mutex mutex;
+    std::condition_variable data_cv;
+    std::condition_variable space_cv;
+    std::thread* thread;
+};
+
+U2Ring::U2Ring(U2* f, Unified2Config* c)
+{
+    file = f;
+    config = c;
+
+    size = c->ring_size < u2_min_ring_sz ? u2_min_ring_sz : c->ring_size;
+    buf = new uint8_t[size];
+    next = 0;
+
+    head = tail = 0;
+    writer_idle = producer_waiting = false;
+    writes = 0;
+    done = false;
+
+    thread = new std::thread(&U2Ring::writer, this);
+}
+
+U2Ring::~U2Ring()
 {
-    fclose(u2.stream);
-    u2.current = 0;
-    Unified2InitFile(config);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    data_cv.notify_one();
+    thread->join();
+
+    delete thread;
+    delete[] buf;
+}
+
+uint8_t* U2Ring::reserve(uint32_t len)
+{
+    uint64_t h = head.load(std::memory_order_relaxed);
+    uint64_t off = h % size;
+    uint64_t skip = (size - off < len) ? size - off : 0;
+    uint64_t need = skip + len;
+
+    if ( size - (h - tail.load()) < need )
+    {
+        u2_stats.ring_full++;
+
+        if ( config->ring_drop )
+        {
+            u2_stats.dropped++;
+            return nullptr;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        producer_waiting = true;
+
+        while ( size - (h - tail.load()) < need )
+            space_cv.wait(lock);
+
+        producer_waiting = false;
+    }
+
+    if ( skip >= sizeof(Serial_Unified2_Header) )
+        memset(buf + off, 0, sizeof(Serial_Unified2_Header));
+
+    next = h + skip;
+    return buf + next % size;
+}
+
+void U2Ring::commit(uint32_t len)
+{
+    head = next + len;
+    u2_stats.records++;
+
+    if ( writer_idle )
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        data_cv.notify_one();
+    }
+}
+
+void U2Ring::writer()
+{
+    while ( true )
+    {
+        uint64_t h = head;
+
+        if ( h != tail.load(std::memory_order_relaxed) )
+        {
+            drain(h);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        writer_idle = true;
+
+        while ( head == tail.load(std::memory_order_relaxed) and !done )
+            data_cv.wait(lock);
+
+        writer_idle = false;
+
+        if ( head == tail.load(std::memory_order_relaxed) )
+            break;
+    }
+}
+
+void U2Ring::flush(struct iovec* iov, int& cnt, uint32_t& len, uint64_t pos)
+{
+    if ( cnt )
+    {
+        Unified2Write(*file, config, iov, cnt, len);
+        writes++;
+        cnt = 0;
+        len = 0;
+    }
+
+    tail = pos;
+
+    if ( producer_waiting )
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        space_cv.notify_one();
+    }
+}
+
+// writes everything up to end with as few calls as possible, starting a
+// new file at a record boundary when the limit would be exceeded
+void U2Ring::drain(uint64_t end)
+{
+    struct iovec iov[u2_max_iov];
+    int cnt = 0;
+    uint32_t len = 0;
+    uint64_t t = tail.load(std::memory_order_relaxed);
+
+    while ( t < end )
+    {
+        uint64_t off = t % size;
+        uint64_t rem = size - off;
+        Serial_Unified2_Header hdr;
+
+        if ( rem < sizeof(hdr) )
+        {
+            t += rem;
+            continue;
+        }
+
+        memcpy(&hdr, buf + off, sizeof(hdr));
+
+        if ( !hdr.type )
+        {
+            t += rem;
+            continue;
+        }
+
+        uint32_t rec = sizeof(hdr) + ntohl(hdr.length);
+
+        if ( config->limit && (file->current + len + rec) > config->limit )
+        {
+            flush(iov, cnt, len, t);
+            Unified2RotateFile(*file, config);
+        }
+        else if ( cnt and (uint8_t*)iov[cnt-1].iov_base + iov[cnt-1].iov_len == buf + off )
+        {
+            iov[cnt-1].iov_len += rec;
+            len += rec;
+            t += rec;
+            continue;
+        }
+        else if ( cnt == u2_max_iov )
+            flush(iov, cnt, len, t);
+
+        iov[cnt].iov_base = buf + off;
+        iov[cnt++].iov_len = rec;
+        len += rec;
+        t += rec;
+    }
+    flush(iov, cnt, len, t);
+}
+
+//-------------------------------------------------------------------------
+// record output
+//-------------------------------------------------------------------------
+
+// returns where to serialize a record of len bytes or nullptr to drop it
+static inline uint8_t* Unified2Reserve(uint32_t len)
+{
+    if ( u2.ring )
+        return u2.ring->reserve(len);
+
+    u2_stats.records++;
+    return write_pkt_buffer;
+}
+
+// hands a record from Unified2Reserve() to the writer or writes it now
+static void Unified2Commit(uint8_t* buf, uint32_t len, Unified2Config* config)
+{
+    if ( u2.ring )
+    {
+        u2.ring->commit(len);
+        return;
+    }
+
+    if ( config->limit && (u2.current + len) > config->limit )
+        Unified2RotateFile(u2, config);
+
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = len;
+
+    Unified2Write(u2, config, &iov, 1, len);
+    u2_stats.writes++;
 }
 
 static void _AlertIP4_v2(Packet* p, const char*, Unified2Config* config, Event* event)
@@ -297,19 +588,21 @@ static void _AlertIP4_v2(Packet* p, const char*, Unified2Config* config, Event*
         }
     }
 
-    if ( config->limit && (u2.current + write_len) > config->limit )
-        Unified2RotateFile(config);
+    uint8_t* buf = Unified2Reserve(write_len);
+
+    if ( !buf )
+        return;
 
     hdr.length = htonl(sizeof(alertdata));
     hdr.type = htonl(UNIFIED2_IDS_EVENT_VLAN);
 
-    memcpy_s(write_pkt_buffer, sizeof(write_pkt_buffer), &hdr, sizeof(hdr));
+    memcpy_s(buf, write_len, &hdr, sizeof(hdr));
 
     size_t offset = sizeof(hdr);
 
-    memcpy_s(write_pkt_buffer + offset, sizeof(write_pkt_buffer) - offset, &alertdata, sizeof(alertdata));
+    memcpy_s(buf + offset, write_len - offset, &alertdata, sizeof(alertdata));
 
-    Unified2Write(write_pkt_buffer, write_len, config);
+    Unified2Commit(buf, write_len, config);
 }
 
 static void _AlertIP6_v2(Packet* p, const char*, Unified2Config* config, Event* event)
@@ -380,20 +673,21 @@ static void _AlertIP6_v2(Packet* p, const char*, Unified2Config* config, Event*
         }
     }
 
-    if ( config->limit && (u2.current + write_len) > config->limit )
-        Unified2RotateFile(config);
+    uint8_t* buf = Unified2Reserve(write_len);
+
+    if ( !buf )
+        return;
 
     hdr.length = htonl(sizeof(Unified2IDSEventIPv6));
     hdr.type = htonl(UNIFIED2_IDS_EVENT_IPV6_VLAN);
 
-    memcpy_s(write_pkt_buffer, sizeof(write_pkt_buffer), &hdr, sizeof(hdr));
+    memcpy_s(buf, write_len, &hdr, sizeof(hdr));
 
     size_t offset = sizeof(hdr);
 
-    memcpy_s(write_pkt_buffer + offset, sizeof(write_pkt_buffer) - offset,
-        &alertdata, sizeof(alertdata));
+    memcpy_s(buf + offset, write_len - offset, &alertdata, sizeof(alertdata));
 
-    Unified2Write(write_pkt_buffer, write_len, config);
+    Unified2Commit(buf, write_len, config);
 }
 
 static void _WriteExtraData(Unified2Config* config,
@@ -406,7 +700,6 @@ static void _WriteExtraData(Unified2Config* config,
     Serial_Unified2_Header hdr;
     SerialUnified2ExtraData alertdata;
     Unified2ExtraDataHdr alertHdr;
-    uint8_t write_buffer[MAX_XDATA_WRITE_BUF_LEN];
     uint8_t* ptr = NULL;
 
     uint32_t write_len = sizeof(hdr) + sizeof(alertHdr);
@@ -424,32 +717,30 @@ static void _WriteExtraData(Unified2Config* config,
     alertHdr.event_type = htonl(EVENT_TYPE_EXTRA_DATA);
     alertHdr.event_length = htonl(write_len - sizeof(hdr));
 
-    if (write_len > sizeof(write_buffer))
+    if (write_len > MAX_XDATA_WRITE_BUF_LEN)
         return;
 
-    if ( config->limit && (u2.current + write_len) > config->limit )
-        Unified2RotateFile(config);
+    if ( !(ptr = Unified2Reserve(write_len)) )
+        return;
 
     hdr.length = htonl(write_len - sizeof(hdr));
     hdr.type = htonl(UNIFIED2_EXTRA_DATA);
 
-    ptr = write_buffer;
-
-    memcpy_s(ptr, sizeof(write_buffer), &hdr, sizeof(hdr));
+    memcpy_s(ptr, write_len, &hdr, sizeof(hdr));
 
     size_t offset = sizeof(hdr);
 
-    memcpy_s(ptr + offset, sizeof(write_buffer) - offset, &alertHdr, sizeof(alertHdr));
+    memcpy_s(ptr + offset, write_len - offset, &alertHdr, sizeof(alertHdr));
 
     offset += sizeof(alertHdr);
 
-    memcpy_s(ptr + offset, sizeof(write_buffer) - offset, &alertdata, sizeof(alertdata));
+    memcpy_s(ptr + offset, write_len - offset, &alertdata, sizeof(alertdata));
 
     offset += sizeof(alertdata);
 
-    memcpy_s(ptr + offset, sizeof(write_buffer) - offset, buffer, len);
+    memcpy_s(ptr + offset, write_len - offset, buffer, len);
 
-    Unified2Write(write_buffer, write_len, config);
+    Unified2Commit(ptr, write_len, config);
 }
 
 static void AlertExtraData(
@@ -521,30 +812,30 @@ static void _Unified2LogPacketAlert(
         logheader.packet_length = 0;
     }
 
-    if ( config->limit && (u2.current + write_len) > config->limit )
-        Unified2RotateFile(config);
+    if ( write_len > sizeof(write_pkt_buffer) )
+        return;
+
+    uint8_t* buf = Unified2Reserve(write_len);
+
+    if ( !buf )
+        return;
 
     hdr.length = htonl(sizeof(Serial_Unified2Packet) - 4 + pkt_length);
     hdr.type = htonl(UNIFIED2_PACKET);
 
-    memcpy_s(write_pkt_buffer, sizeof(write_pkt_buffer), &hdr, sizeof(hdr));
+    memcpy_s(buf, write_len, &hdr, sizeof(hdr));
 
     size_t offset = sizeof(hdr);
 
-    memcpy_s(write_pkt_buffer + offset, sizeof(write_pkt_buffer) - offset,
-        &logheader, sizeof(logheader) - 4);
+    memcpy_s(buf + offset, write_len - offset, &logheader, sizeof(logheader) - 4);
 
     offset += sizeof(logheader) - 4;
 
     if (pkt_length != 0)
     {
-        if (pkt_length > sizeof(write_pkt_buffer) - offset)
-            return;
+        uint8_t *start = buf + offset;
 
-        uint8_t *start = write_pkt_buffer + offset;
-
-        memcpy_s(start, sizeof(write_pkt_buffer) - offset,
-            p->is_data() ? p->data : p->pkt, pkt_length);
+        memcpy_s(start, write_len - offset, p->is_data() ? p->data : p->pkt, pkt_length);
 
         if ( p->obfuscator )
         {
@@ -558,13 +849,56 @@ static void _Unified2LogPacketAlert(
         }
     }
 
-    Unified2Write(write_pkt_buffer, write_len, config);
+    Unified2Commit(buf, write_len, config);
+}
+
+// writes all of iov; returns 0 or errno.  iov is updated on partial writes
+// so a retry picks up where this left off.
+static int Unified2WriteAll(int fd, struct iovec* iov, int cnt)
+{
+    while ( cnt > 0 )
+    {
+        ssize_t n = writev(fd, iov, cnt);
+
+        if ( n < 0 )
+            return errno;
+
+        while ( cnt > 0 and (size_t)n >= iov->iov_len )
+        {
+            n -= iov->iov_len;
+            ++iov;
+            --cnt;
+        }
+
+        if ( cnt > 0 )
+        {
+            iov->iov_base = (uint8_t*)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+static void Unified2WriteError(U2& f, Unified2Config* config, int error)
+{
+    if (config->nostamp)
+    {
+        ErrorMessage("%s(%d) Failed to write to unified2 file (%s): %s\n",
+            __FILE__, __LINE__, f.filepath, get_error(error));
+    }
+    else
+    {
+        ErrorMessage("%s(%d) Failed to write to unified2 file (%s.%u): %s\n",
+            __FILE__, __LINE__, f.filepath, f.timestamp, get_error(error));
+    }
 }
 
 /******************************************************************************
  * Function: Unified2Write()
  *
- * Main function for writing to the unified2 file.
+ * Main function for writing to the unified2 file.  This is called by the
+ * packet thread when there is no ring and by the ring's writer thread
+ * otherwise.  iov holds one or more whole records.
  *
  * For low level I/O errors, the current unified2 file is closed and a new
  * one created and a write to the new unified2 file is done.  It was found
@@ -582,166 +916,88 @@ static void _Unified2LogPacketAlert(
  * unified2 file.
  *
  * Arguments
- *  uint8_t *
- *      The buffer containing the data to write
- *  uint32_t
- *      The length of the data to write
+ *  U2&
+ *      The file to write to
  *  Unified2Config *
  *      A pointer to the unified2 configuration data
+ *  const struct iovec *, int
+ *      The data to write
+ *  uint32_t
+ *      The total length of the data to write
  *
  * Returns: None
  *
  ******************************************************************************/
-static void Unified2Write(uint8_t* buf, uint32_t buf_len, Unified2Config* config)
+static void Unified2Write(
+    U2& f, Unified2Config* config, const struct iovec* iov, int cnt, uint32_t len)
 {
-    size_t fwcount = 0;
-    int ffstatus = 0;
-
     /* Nothing to write or nothing to write to */
-    if ((buf == NULL) || (config == NULL) || (u2.stream == NULL))
+    if ((iov == NULL) || (config == NULL) || (f.fd < 0))
         return;
 
+    struct iovec v[u2_max_iov];
+    memcpy(v, iov, cnt * sizeof(*iov));
+
     /* Don't use fsync().  It is a total performance killer */
-    if (((fwcount = fwrite(buf, (size_t)buf_len, 1, u2.stream)) != 1) ||
-        ((ffstatus = fflush(u2.stream)) != 0))
-    {
-        /* errno is saved just to avoid other intervening calls
-         * (e.g. ErrorMessage) potentially reseting it to something else. */
-        int error = errno;
-        int max_retries = 3;
-
-        /* On iterations other than the first, the only non-zero error will be
-         * EINTR or interrupt.  Only iterate a maximum of max_retries times so
-         * there is no chance of infinite looping if for some reason the write
-         * is constantly interrupted */
-        while ((error != 0) && (max_retries != 0))
+    int error = Unified2WriteAll(f.fd, v, cnt);
+    int max_retries = 3;
+    bool rotated = false;
+
+    while ( error )
+    {
+        Unified2WriteError(f, config, error);
+
+        if ( error == EINTR )
         {
-            if (config->nostamp)
-            {
-                ErrorMessage("%s(%d) Failed to write to unified2 file (%s): %s\n",
-                    __FILE__, __LINE__, u2.filepath, get_error(error));
-            }
-            else
+            /* Only retry a maximum of max_retries times so there is no
+             * chance of infinite looping if for some reason the write is
+             * constantly interrupted */
+            if ( !max_retries-- )
             {
-                ErrorMessage("%s(%d) Failed to write to unified2 file (%s.%u): %s\n",
-                    __FILE__, __LINE__, u2.filepath,
-                    u2.timestamp, get_error(error));
+                FatalError("%s(%d) Maximum number of interrupts exceeded. "
+                    "Cannot write to device.\n", __FILE__, __LINE__);
             }
+            ErrorMessage("%s(%d) Got interrupt. Retry write to unified2 "
+                "file.\n", __FILE__, __LINE__);
+        }
+        else if ( error == EIO and !rotated )
+        {
+            ErrorMessage("%s(%d) Unified2 file is possibly corrupt. "
+                "Closing this unified2 file and creating "
+                "a new one.\n", __FILE__, __LINE__);
 
-            while ((error == EINTR) && (max_retries != 0))
-            {
-                max_retries--;
-
-                /* Supposedly an interrupt can only occur before anything
-                 * has been written.  Try again */
-                ErrorMessage("%s(%d) Got interrupt. Retry write to unified2 "
-                    "file.\n", __FILE__, __LINE__);
-
-                if (fwcount != 1)
-                {
-                    /* fwrite() failed.  Redo fwrite and fflush */
-                    if (((fwcount = fwrite(buf, (size_t)buf_len, 1, u2.stream)) == 1) &&
-                        ((ffstatus = fflush(u2.stream)) == 0))
-                    {
-                        ErrorMessage("%s(%d) Write to unified2 file succeeded\n",
-                            __FILE__, __LINE__);
-                        error = 0;
-                        break;
-                    }
-                }
-                else if ((ffstatus = fflush(u2.stream)) == 0)
-                {
-                    ErrorMessage("%s(%d) Write to unified2 file succeeded\n",
-                        __FILE__, __LINE__);
-                    error = 0;
-                    break;
-                }
-
-                error = errno;
+            Unified2RotateFile(f, config);
+            rotated = true;
 
-                ErrorMessage("%s(%d) Retrying write to unified2 file failed.\n",
-                    __FILE__, __LINE__);
+            if (config->nostamp)
+            {
+                ErrorMessage("%s(%d) New unified2 file: %s\n",
+                    __FILE__, __LINE__, f.filepath);
             }
-
-            /* If we've reached the maximum number of interrupt retries,
-             * just bail out of the main while loop */
-            if (max_retries == 0)
-                continue;
-
-            switch (error)
+            else
             {
-            case 0:
-                break;
-
-            case EIO:
-                ErrorMessage("%s(%d) Unified2 file is possibly corrupt. "
-                    "Closing this unified2 file and creating "
-                    "a new one.\n", __FILE__, __LINE__);
-
-                Unified2RotateFile(config);
-
-                if (config->nostamp)
-                {
-                    ErrorMessage("%s(%d) New unified2 file: %s\n",
-                        __FILE__, __LINE__, u2.filepath);
-                }
-                else
-                {
-                    ErrorMessage("%s(%d) New unified2 file: %s.%u\n",
-                        __FILE__, __LINE__,
-                        u2.filepath, u2.timestamp);
-                }
-
-                if (((fwcount = fwrite(buf, (size_t)buf_len, 1, u2.stream)) == 1) &&
-                    ((ffstatus = fflush(u2.stream)) == 0))
-                {
-                    ErrorMessage("%s(%d) Write to unified2 file succeeded\n",
-                        __FILE__, __LINE__);
-                    error = 0;
-                    break;
-                }
-
-                error = errno;
-
-                /* Loop again if interrupt */
-                if (error == EINTR)
-                    break;
-
-                /* Write out error message again, then fall through and fatal */
-                if (config->nostamp)
-                {
-                    ErrorMessage("%s(%d) Failed to write to unified2 file (%s): %s\n",
-                        __FILE__, __LINE__, u2.filepath, get_error(error));
-                }
-                else
-                {
-                    ErrorMessage("%s(%d) Failed to write to unified2 file (%s.%u): %s\n",
-                        __FILE__, __LINE__, u2.filepath,
-                        u2.timestamp, get_error(error));
-                }
-
-            /* Fall through */
-
-            case EAGAIN:      /* We're not in non-blocking mode */
-            case EBADF:
-            case EFAULT:
-            case EFBIG:
-            case EINVAL:
-            case ENOSPC:
-            case EPIPE:
-            default:
-                FatalError("%s(%d) Cannot write to device.\n", __FILE__, __LINE__);
+                ErrorMessage("%s(%d) New unified2 file: %s.%u\n",
+                    __FILE__, __LINE__, f.filepath, f.timestamp);
             }
+
+            /* start the records over in the new file */
+            memcpy(v, iov, cnt * sizeof(*iov));
+        }
+        else
+        {
+            /* EAGAIN (we're not in non-blocking mode), EBADF, EFAULT,
+             * EFBIG, EINVAL, ENOSPC, EPIPE, or a second EIO */
+            FatalError("%s(%d) Cannot write to device.\n", __FILE__, __LINE__);
         }
 
-        if ((max_retries == 0) && (error != 0))
+        if ( !(error = Unified2WriteAll(f.fd, v, cnt)) )
         {
-            FatalError("%s(%d) Maximum number of interrupts exceeded. "
-                "Cannot write to device.\n", __FILE__, __LINE__);
+            ErrorMessage("%s(%d) Write to unified2 file succeeded\n",
+                __FILE__, __LINE__);
         }
     }
 
-    u2.current += buf_len;
+    f.current += len;
 }
 
 //-------------------------------------------------------------------------
@@ -765,6 +1021,12 @@ static const Parameter s_params[] =
     { "vlan_event_types", Parameter::PT_BOOL, nullptr, "false",
       "include vlan IDs in events" },
 
+    { "ring_size", Parameter::PT_INT, "0:4194304", "0",
+      "per thread record buffer size in KB written by a separate thread (0 writes from the packet thread)" },
+
+    { "ring_policy", Parameter::PT_ENUM, "block | drop", "block",
+      "wait for the writer or drop the record when the ring is full" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -780,12 +1042,19 @@ public:
     bool begin(const char*, int, SnortConfig*) override;
     bool end(const char*, int, SnortConfig*) override;
 
+    const PegInfo* get_pegs() const override
+    { return u2_pegs; }
+
+    PegCount* get_counts() const override;
+
 public:
     unsigned limit;
     unsigned units;
+    size_t ring_size;
     bool nostamp;
     bool mpls;
     bool vlan;
+    bool ring_drop;
 };
 
 bool U2Module::set(const char*, Value& v, SnortConfig*)
@@ -805,6 +1074,12 @@ bool U2Module::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("vlan_event_types") )
         vlan = v.get_bool();
 
+    else if ( v.is("ring_size") )
+        ring_size = (size_t)v.get_long() * 1024;
+
+    else if ( v.is("ring_policy") )
+        ring_drop = v.get_long() == 1;
+
     else
         return false;
 
@@ -817,6 +1092,8 @@ bool U2Module::begin(const char*, int, SnortConfig*)
     units = 0;
     nostamp = SnortConfig::output_no_timestamp();
     mpls = vlan = false;
+    ring_size = 0;
+    ring_drop = false;
     return true;
 }
 
@@ -828,6 +1105,18 @@ bool U2Module::end(const char*, int, SnortConfig*)
     return true;
 }
 
+PegCount* U2Module::get_counts() const
+{
+    // the writer thread counts its own writes
+    if ( u2.ring )
+    {
+        PegCount w = u2.ring->get_writes();
+        u2_stats.writes += w - u2_ring_writes;
+        u2_ring_writes = w;
+    }
+    return (PegCount*)&u2_stats;
+}
+
 //-------------------------------------------------------------------------
 // logger stuff
 //-------------------------------------------------------------------------
@@ -854,6 +1143,8 @@ U2Logger::U2Logger(U2Module* m)
     config.nostamp = m->nostamp;
     config.mpls_event_types = m->mpls;
     config.vlan_event_types = m->vlan;
+    config.ring_size = m->ring_size;
+    config.ring_drop = m->ring_drop;
 }
 
 U2Logger::~U2Logger()
@@ -876,15 +1167,30 @@ void U2Logger::open()
     }
     u2.base_proto = htonl(SFDAQ::get_base_protocol());
 
-    Unified2InitFile(&config);
+    Unified2InitFile(u2, &config);
+
+    if ( config.ring_size and u2.fd >= 0 )
+    {
+        u2_ring_writes = 0;
+        u2.ring = new U2Ring(&u2, &config);
+    }
 
     stream.reg_xtra_data_log(AlertExtraData, &config);
 }
 
 void U2Logger::close()
 {
-    if ( u2.stream )
-        fclose(u2.stream);
+    if ( u2.ring )
+    {
+        delete u2.ring;
+        u2.ring = nullptr;
+    }
+
+    if ( u2.fd >= 0 )
+    {
+        ::close(u2.fd);
+        u2.fd = -1;
+    }
 }
 
 void U2Logger::alert(Packet* p, const char* msg, Event* event)
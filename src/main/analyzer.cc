@@ -181,6 +181,10 @@ bool Analyzer::handle_command()
                 return false;
             }
             Snort::thread_init_unprivileged();
+
+            if ( Snort::batching() )
+                main_func = Snort::batch_callback;
+
             state = State::RUNNING;
             DebugMessage(DEBUG_ANALYZER, "Handled RUN command\n");
             command = AC_NONE;
@@ -243,7 +247,13 @@ void Analyzer::analyze()
             this_thread::sleep_for(ms);
             continue;
         }
-        if (daq_instance->acquire(0, main_func))
+        int err = daq_instance->acquire(0, main_func);
+
+        // anything left over from a partial batch must be processed before
+        // idling or handling the next command (eg swap or stop)
+        Snort::flush_batch();
+
+        if (err)
             break;
 
         // FIXIT-L acquire(0) makes idle processing unlikely under high traffic
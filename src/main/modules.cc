@@ -78,6 +78,15 @@ static const Parameter detection_params[] =
     { "pcre_match_limit_recursion", Parameter::PT_INT, "-1:10000", "1500",
       "limit pcre stack consumption, -1 = max, 0 = off" },
 
+    { "pcre_jit", Parameter::PT_BOOL, nullptr, "true",
+      "compile pcre to machine code if the library supports it" },
+
+    { "pcre_jit_stack", Parameter::PT_INT, "0:", "1048576",
+      "maximum size in bytes of each packet thread's pcre JIT stack, 0 = 32K on the machine stack" },
+
+    { "pcre_prefilter", Parameter::PT_BOOL, nullptr, "false",
+      "skip pcre evaluation when a hyperscan prefilter of the regex doesn't match" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 /* *INDENT-ON* */
@@ -109,6 +118,15 @@ bool DetectionModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("pcre_match_limit_recursion") )
         sc->pcre_match_limit_recursion = v.get_long();
 
+    else if ( v.is("pcre_jit") )
+        sc->pcre_jit = v.get_bool();
+
+    else if ( v.is("pcre_jit_stack") )
+        sc->pcre_jit_stack = v.get_long();
+
+    else if ( v.is("pcre_prefilter") )
+        sc->pcre_prefilter = v.get_bool();
+
     else
         return false;
 
@@ -236,6 +254,18 @@ static const Parameter search_engine_params[] =
     { "search_optimize", Parameter::PT_BOOL, nullptr, "true",
       "tweak state machine construction for better performance" },
 
+    { "batch_search", Parameter::PT_BOOL, nullptr, "false",
+      "search all fast pattern buffers of a packet before evaluating rules" },
+
+    { "cache_dir", Parameter::PT_STRING, nullptr, nullptr,
+      "directory for compiled pattern databases reused when the patterns are unchanged" },
+
+    { "compile_threads", Parameter::PT_INT, "0:", "0",
+      "threads used to compile rule groups at startup and reload (0 means one per core)" },
+
+    { "reload_reuse", Parameter::PT_BOOL, nullptr, "true",
+      "on reload, share search engines with the running configuration if their patterns are unchanged" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -333,6 +363,18 @@ bool SearchEngineModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("search_optimize") )
         fp->set_search_opt(v.get_long());
 
+    else if ( v.is("batch_search") )
+        fp->set_batch_search(v.get_bool());
+
+    else if ( v.is("cache_dir") )
+        fp->set_cache_dir(v.get_string());
+
+    else if ( v.is("compile_threads") )
+        fp->set_compile_threads(v.get_long());
+
+    else if ( v.is("reload_reuse") )
+        fp->set_reload_reuse(v.get_bool());
+
     else
         return false;
 
@@ -963,6 +1005,9 @@ static const Parameter network_params[] =
       "all | ip | noip | tcp | notcp | udp | noudp | icmp | noicmp | none", "none",
       "checksums to verify" },
 
+    { "checksum_offload", Parameter::PT_BOOL, nullptr, "false",
+      "skip tcp checksum verification when the DAQ reports the hardware checked it" },
+
     { "decode_drops", Parameter::PT_BOOL, nullptr, "false",
       "enable dropping of packets by the decoder" },
 
@@ -1010,6 +1055,9 @@ bool NetworkModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("checksum_eval") )
         ConfigChecksumMode(sc, v.get_string());
 
+    else if ( v.is("checksum_offload") )
+        p->checksum_offload = v.get_bool();
+
     else if ( v.is("decode_drops") )
         p->decoder_drop = v.get_bool();
 
@@ -1334,6 +1382,9 @@ static const Parameter event_filter_params[] =
     { "ip", Parameter::PT_STRING, nullptr, nullptr,
       "restrict filter to these addresses according to track" },
 
+    { "shared", Parameter::PT_BOOL, nullptr, "false",
+      "count events from all packet threads together" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -1376,6 +1427,9 @@ bool EventFilterModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("type") )
         thdx.type = v.get_long();
 
+    else if ( v.is("shared") )
+        thdx.shared = v.get_bool();
+
     else
         return false;
 
@@ -1432,6 +1486,9 @@ static const Parameter rate_filter_params[] =
     { "apply_to", Parameter::PT_STRING, nullptr, nullptr,
       "restrict filter to these addresses according to track" },
 
+    { "shared", Parameter::PT_BOOL, nullptr, "false",
+      "count events from all packet threads together" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -1484,6 +1541,9 @@ bool RateFilterModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("new_action") )
         thdx.newAction = (RuleType)(v.get_long() + 1);
 
+    else if ( v.is("shared") )
+        thdx.shared = v.get_bool();
+
     else
         return false;
 
@@ -80,6 +80,7 @@ public:
     uint32_t normal_mask;
 
     bool decoder_drop;
+    bool checksum_offload;
 };
 
 //-------------------------------------------------------------------------
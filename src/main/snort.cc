@@ -64,13 +64,17 @@
 #include "managers/script_manager.h"
 #include "packet_io/sfdaq.h"
 #include "packet_io/active.h"
+#include "packet_io/packet_batch.h"
+#include "packet_io/sfdaq_config.h"
 #include "packet_io/trough.h"
 #include "parser/cmd_line.h"
 #include "parser/parser.h"
 #include "perf_monitor/perf_monitor.h"
 #include "profiler/profiler.h"
+#include "protocols/layer.h"
 #include "protocols/packet.h"
 #include "protocols/packet_manager.h"
+#include "protocols/packet_pool.h"
 #include "side_channel/side_channel.h"
 #include "stream/stream.h"
 #include "target_based/sftarget_reader.h"
@@ -104,6 +108,12 @@ static THREAD_LOCAL DAQ_PktHdr_t s_pkth;
 static THREAD_LOCAL uint8_t s_data[65536];
 static THREAD_LOCAL Packet* s_packet = nullptr;
 
+// only instantiated when daq.batch_size > 1 and not inline
+static THREAD_LOCAL PacketBatch* s_batch = nullptr;
+
+// number of batched packets to look ahead when prefetching flows
+static const unsigned s_batch_lookahead = 4;
+
 //-------------------------------------------------------------------------
 // perf stats
 // FIXIT-M move these to appropriate modules
@@ -638,7 +648,15 @@ bool Snort::thread_init_privileged(const char* intf)
 void Snort::thread_init_unprivileged()
 {
     s_packet = new Packet(false);
+
+    // the verdict must be rendered before an inline packet is released
+    // so batching is limited to passive and readback modes
+    if ( snort_conf->daq_config->batch_size > 1 and !SnortConfig::adaptor_inline_mode() )
+        s_batch = new PacketBatch(snort_conf->daq_config->batch_size, SFDAQ::get_snap_len());
+
     CodecManager::thread_init(snort_conf);
+    PacketManager::thread_init();
+    PacketPool::thread_init();
 
     // this depends on instantiated daq capabilities
     // so it is done here instead of init()
@@ -683,6 +701,14 @@ void Snort::thread_term()
         s_packet = nullptr;
     }
 
+    if ( s_batch )
+    {
+        delete s_batch;
+        s_batch = nullptr;
+    }
+
+    PacketPool::thread_term();
+
     SFDAQInstance *daq_instance = SFDAQ::get_local_instance();
     if ( daq_instance->was_started() )
         daq_instance->stop();
@@ -723,11 +749,15 @@ void Snort::detect_rebuilt_packet(Packet* p)
 }
 
 DAQ_Verdict Snort::process_packet(
-    Packet* p, const DAQ_PktHdr_t* pkthdr, const uint8_t* pkt, bool is_frag)
+    Packet* p, const DAQ_PktHdr_t* pkthdr, const uint8_t* pkt, bool is_frag, bool decoded)
 {
     set_default_policy();
 
-    PacketManager::decode(p, pkthdr, pkt);
+    if ( decoded )
+        layer::set_packet_pointer(p);
+    else
+        PacketManager::decode(p, pkthdr, pkt);
+
     assert(p->pkth && p->pkt);
 
     if (is_frag)
@@ -818,6 +848,12 @@ static DAQ_Verdict update_verdict(DAQ_Verdict verdict, int& inject)
 
 DAQ_Verdict Snort::packet_callback(
     void*, const DAQ_PktHdr_t* pkthdr, const uint8_t* pkt)
+{
+    return inspect_packet(pkthdr, pkt, false);
+}
+
+// decoded is true if s_packet was already decoded from pkt
+DAQ_Verdict Snort::inspect_packet(const DAQ_PktHdr_t* pkthdr, const uint8_t* pkt, bool decoded)
 {
     Profile profile(totalPerfStats);
 
@@ -836,7 +872,7 @@ DAQ_Verdict Snort::packet_callback(
     sfthreshold_reset();
     ActionManager::reset_queue();
 
-    DAQ_Verdict verdict = process_packet(s_packet, pkthdr, pkt);
+    DAQ_Verdict verdict = process_packet(s_packet, pkthdr, pkt, false, decoded);
     ActionManager::execute(s_packet);
 
     int inject = 0;
@@ -867,3 +903,88 @@ DAQ_Verdict Snort::packet_callback(
     return verdict;
 }
 
+//-------------------------------------------------------------------------
+// batch mode
+//-------------------------------------------------------------------------
+
+bool Snort::batching()
+{
+    return s_batch != nullptr;
+}
+
+// packets are copied so the daq buffer can be released immediately; the
+// batch is processed here when full or by the analyzer when acquire returns
+DAQ_Verdict Snort::batch_callback(
+    void*, const DAQ_PktHdr_t* pkthdr, const uint8_t* pkt)
+{
+    if ( !s_batch->add(pkthdr, pkt) )
+    {
+        flush_batch();
+        s_batch->add(pkthdr, pkt);
+    }
+
+    if ( s_batch->full() )
+        flush_batch();
+
+    return DAQ_VERDICT_PASS;
+}
+
+static inline void prefetch_flow(unsigned i, unsigned n)
+{
+    if ( i < n and s_batch->is_decoded(i) )
+        flow_con->prefetch_flow(s_batch->get_packet(i));
+}
+
+// the batch is decoded first so that flow lookups can be prefetched a few
+// packets ahead of inspection.  only packets the fast path decodes are done
+// ahead since the rest can raise events and set active state which belong
+// to the packet being inspected; those are decoded in turn as usual.
+void Snort::flush_batch()
+{
+    if ( !s_batch or s_batch->empty() )
+        return;
+
+    unsigned n = s_batch->size();
+
+    // don't process beyond -n even if the batch has more
+    if ( snort_conf->pkt_cnt )
+    {
+        uint64_t left = snort_conf->pkt_cnt > pc.total_from_daq ?
+            snort_conf->pkt_cnt - pc.total_from_daq : 0;
+
+        if ( left < n )
+            n = (unsigned)left;
+    }
+
+    aux_counts.batches++;
+    aux_counts.batched += n;
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        // packets skipped with --skip are not decoded
+        bool skip = snort_conf->pkt_skip and pc.total_from_daq + i < snort_conf->pkt_skip;
+
+        s_batch->set_decoded(i, !skip and PacketManager::predecode(
+            s_batch->get_packet(i), s_batch->get_header(i), s_batch->get_data(i)));
+    }
+
+    if ( flow_con )
+    {
+        for ( unsigned i = 0; i < s_batch_lookahead; ++i )
+            prefetch_flow(i, n);
+    }
+
+    Packet* save = s_packet;
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        if ( flow_con )
+            prefetch_flow(i + s_batch_lookahead, n);
+
+        s_packet = s_batch->get_packet(i);
+        inspect_packet(s_batch->get_header(i), s_batch->get_data(i), s_batch->is_decoded(i));
+    }
+    s_packet = save;
+    s_batch->clear();
+}
+
@@ -60,16 +60,22 @@ public:
     static void detect_rebuilt_packet(Packet*);
 
     static DAQ_Verdict process_packet(
-        Packet*, const DAQ_PktHdr_t*, const uint8_t* pkt, bool is_frag=false);
+        Packet*, const DAQ_PktHdr_t*, const uint8_t* pkt, bool is_frag=false,
+        bool decoded=false);
 
     static DAQ_Verdict packet_callback(void*, const DAQ_PktHdr_t*, const uint8_t*);
 
+    static bool batching();
+    static DAQ_Verdict batch_callback(void*, const DAQ_PktHdr_t*, const uint8_t*);
+    static void flush_batch();
+
     static void set_main_hook(MainHook_f);
 
 private:
     static void init(int, char**);
     static void term();
     static void clean_exit(int);
+    static DAQ_Verdict inspect_packet(const DAQ_PktHdr_t*, const uint8_t*, bool decoded);
 
 private:
     static bool initializing;
@@ -143,6 +143,8 @@ struct SnortState
     void* regex_scratch;
     void* hyperscan_scratch;
     void* sdpattern_scratch;
+    void* pcre_scratch;
+    void* pcre_jit_stack;
 };
 
 struct SnortConfig
@@ -190,6 +192,9 @@ public:
     long int pcre_match_limit = 1500;
     long int pcre_match_limit_recursion = 1500;
     int pcre_ovector_size = 0;
+    unsigned pcre_jit_stack = 1048576;
+    bool pcre_jit = true;
+    bool pcre_prefilter = false;
 
     int asn1_mem = 0;
     uint32_t run_flags = 0;
@@ -459,6 +464,13 @@ public:
     static bool tcp_checksum_drops()
     { return ::get_network_policy()->checksum_drop & CHECKSUM_FLAG__TCP; }
 
+    // the DAQ only reports good checksums so bad ones are still verified
+    static bool tcp_checksum_offloaded(const DAQ_PktHdr_t* h)
+    {
+        return (h->flags & DAQ_PKT_FLAG_HW_TCP_CS_GOOD) &&
+            ::get_network_policy()->checksum_offload;
+    }
+
     static bool icmp_checksums()
     { return ::get_network_policy()->checksum_eval & CHECKSUM_FLAG__ICMP; }
 
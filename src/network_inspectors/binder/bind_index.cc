@@ -0,0 +1,319 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "bind_index.h"
+
+#include <algorithm>
+#include <map>
+
+#include "sfip/sf_ip.h"
+#include "sfip/sf_ipvar.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+static inline void set_bit(std::vector<uint64_t>& map, unsigned base, unsigned idx)
+{
+    map[base + idx / 64] |= (uint64_t)1 << (idx % 64);
+}
+
+//-------------------------------------------------------------------------
+// criteria tables
+//-------------------------------------------------------------------------
+
+// distinct bitmaps are numbered in order of first appearance
+template <typename Pred>
+void BindIndex::build(Dim& d, unsigned size, Pred pred)
+{
+    std::map<std::vector<uint64_t>, uint32_t> seen;
+    std::vector<uint64_t> map(words), last;
+
+    d.cls.resize(size);
+
+    for ( unsigned v = 0; v < size; ++v )
+    {
+        std::fill(map.begin(), map.end(), 0);
+
+        for ( unsigned i = 0; i < bindings.size(); ++i )
+            if ( pred(bindings[i], v) )
+                set_bit(map, 0, i);
+
+        // neighboring values usually match the same bindings
+        if ( v and map == last )
+        {
+            d.cls[v] = d.cls[v - 1];
+            continue;
+        }
+
+        auto it = seen.find(map);
+
+        if ( it == seen.end() )
+        {
+            uint32_t c = (uint32_t)seen.size();
+            it = seen.emplace(map, c).first;
+            d.maps.insert(d.maps.end(), map.begin(), map.end());
+        }
+        d.cls[v] = it->second;
+        last = map;
+    }
+}
+
+const uint64_t* BindIndex::get_service(const char* s) const
+{
+    if ( !s )
+        return no_service.data();
+
+    auto it = services.find(s);
+    return it == services.end() ? none.data() : it->second.data();
+}
+
+//-------------------------------------------------------------------------
+// address tries
+//-------------------------------------------------------------------------
+
+void BindIndex::add_net(Trie& t, const uint8_t* addr, unsigned bits, unsigned idx)
+{
+    if ( t.nodes.empty() )
+        t.nodes.push_back({ { -1, -1 }, -1 });
+
+    int n = 0;
+
+    for ( unsigned i = 0; i < bits; ++i )
+    {
+        unsigned b = (addr[i / 8] >> (7 - i % 8)) & 1;
+
+        if ( t.nodes[n].child[b] < 0 )
+        {
+            t.nodes[n].child[b] = (int)t.nodes.size();
+            t.nodes.push_back({ { -1, -1 }, -1 });
+        }
+        n = t.nodes[n].child[b];
+    }
+
+    if ( t.nodes[n].map < 0 )
+    {
+        t.nodes[n].map = (int)t.maps.size();
+        t.maps.resize(t.maps.size() + words, 0);
+    }
+    set_bit(t.maps, t.nodes[n].map, idx);
+}
+
+// only lists of plain cidrs are indexed; anything else is left to
+// sfvar_ip_in() which knows how negations and unset addresses work
+bool BindIndex::add_nets(const sfip_var_t* var, unsigned idx)
+{
+    if ( var->neg_head or !var->head )
+        return false;
+
+    for ( const sfip_node_t* p = var->head; p; p = p->next )
+    {
+        if ( (p->flags & SFIP_NEGATED) or !sfip_is_set(p->ip) )
+            return false;
+
+        unsigned bits = sfip_bits(p->ip);
+
+        if ( p->ip->is_ip4() ? bits > 32 : (!p->ip->is_ip6() or bits > 128) )
+            return false;
+    }
+
+    for ( const sfip_node_t* p = var->head; p; p = p->next )
+    {
+        Trie& t = p->ip->is_ip4() ? ip4 : ip6;
+        add_net(t, p->ip->ip8, sfip_bits(p->ip), idx);
+    }
+    return true;
+}
+
+unsigned BindIndex::find_nets(const sfip_t* ip, const uint64_t** hits, unsigned n) const
+{
+    const Trie* t;
+    unsigned bits;
+
+    if ( ip->is_ip4() )
+    {
+        t = &ip4;
+        bits = 32;
+    }
+    else if ( ip->is_ip6() )
+    {
+        t = &ip6;
+        bits = 128;
+    }
+    else
+        return n;
+
+    if ( t->nodes.empty() )
+        return n;
+
+    int node = 0;
+
+    for ( unsigned i = 0; ; ++i )
+    {
+        if ( t->nodes[node].map >= 0 )
+            hits[n++] = t->maps.data() + t->nodes[node].map;
+
+        if ( i == bits )
+            break;
+
+        unsigned b = (ip->ip8[i / 8] >> (7 - i % 8)) & 1;
+        node = t->nodes[node].child[b];
+
+        if ( node < 0 )
+            break;
+    }
+    return n;
+}
+
+//-------------------------------------------------------------------------
+// index
+//-------------------------------------------------------------------------
+
+BindIndex::BindIndex(const std::vector<Binding*>& v) : bindings(v)
+{
+    words = (bindings.size() + 63) / 64;
+    none.resize(words, 0);
+
+    build(protos, 256, [](const Binding* pb, unsigned v)
+        { return (pb->when.protos & v) != 0; });
+
+    build(ifaces, 256, [](const Binding* pb, unsigned v)
+        { return pb->when.ifaces.test(v); });
+
+    build(vlans, 4096, [](const Binding* pb, unsigned v)
+        { return pb->when.vlans.test(v); });
+
+    build(ports, 65536, [](const Binding* pb, unsigned v)
+        { return pb->when.ports.test(v); });
+
+    // the extra id at the end stands for all ids no binding names
+    unsigned max_id = 0;
+
+    for ( auto* pb : bindings )
+        if ( pb->when.id > max_id )
+            max_id = pb->when.id;
+
+    build(policies, max_id + 2, [](const Binding* pb, unsigned v)
+        { return !pb->when.id or pb->when.id == v; });
+
+    no_service.resize(words, 0);
+    any_addr.resize(words, 0);
+    verify_addr.resize(words, 0);
+
+    for ( unsigned i = 0; i < bindings.size(); ++i )
+    {
+        const Binding* pb = bindings[i];
+
+        if ( pb->when.svc.empty() )
+            set_bit(no_service, 0, i);
+        else
+        {
+            auto& map = services[pb->when.svc];
+            map.resize(words, 0);
+            set_bit(map, 0, i);
+        }
+
+        if ( !pb->when.nets )
+            set_bit(any_addr, 0, i);
+
+        else if ( !add_nets(pb->when.nets, i) )
+        {
+            set_bit(any_addr, 0, i);
+            set_bit(verify_addr, 0, i);
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+// bindings that match any flow except for the given policy ids
+static std::vector<Binding*> make_bindings(const std::vector<unsigned>& ids)
+{
+    std::vector<Binding*> v;
+
+    for ( auto id : ids )
+    {
+        Binding* pb = new Binding;
+        pb->when.id = id;
+        v.push_back(pb);
+    }
+    return v;
+}
+
+static void free_bindings(std::vector<Binding*>& v)
+{
+    for ( auto* pb : v )
+        delete pb;
+}
+
+// finds the bindings for a flow with policy id 1 where the first match
+// switches the flow to policy 2 as Binder::use_binding() does
+static std::vector<unsigned> find_with_switch(const std::vector<Binding*>& v)
+{
+    BindIndex index(v);
+    FlowKey key;
+    Flow flow;
+
+    memset(&key, 0, sizeof(key));
+    flow.key = &key;
+    flow.pkt_type = PktType::TCP;
+    flow.policy_id = 1;
+
+    std::vector<unsigned> found;
+
+    index.find(&flow, [&](Binding* pb)
+    {
+        found.push_back(std::find(v.begin(), v.end(), pb) - v.begin());
+        flow.policy_id = 2;
+        return false;
+    });
+    return found;
+}
+
+TEST_CASE("policy switch within a word", "[BindIndex]")
+{
+    auto v = make_bindings({ 1, 2, 1, 0 });
+    std::vector<unsigned> expect = { 0, 1, 3 };
+
+    CHECK(find_with_switch(v) == expect);
+    free_bindings(v);
+}
+
+TEST_CASE("policy switch across words", "[BindIndex]")
+{
+    std::vector<unsigned> ids(130, 3);
+    ids[0] = 1;
+    ids[64] = 1;
+    ids[65] = 2;
+    ids[129] = 2;
+
+    auto v = make_bindings(ids);
+    std::vector<unsigned> expect = { 0, 65, 129 };
+
+    CHECK(find_with_switch(v) == expect);
+    free_bindings(v);
+}
+#endif
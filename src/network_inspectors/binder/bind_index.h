@@ -0,0 +1,169 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef BIND_INDEX_H
+#define BIND_INDEX_H
+
+// BindIndex finds the bindings that match a flow without checking each
+// one.  Each binding is a bit in a bitmap and each match criterion is
+// compiled into a table from flow value to the bitmap of bindings that
+// accept that value.  Values with the same bitmap share one copy so the
+// port table, for example, is 64K small class numbers and a few bitmaps.
+// Networks are indexed by prefix in a binary trie per address family and
+// a lookup ORs the bitmaps found along the path.  The matches are the AND
+// of the criteria bitmaps, visited in binding order.
+//
+// Networks with negations or wildcards aren't indexed; those bindings
+// always pass the address bitmaps and are checked with check_addr().
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "binding.h"
+#include "flow/flow.h"
+
+class BindIndex
+{
+public:
+    BindIndex(const std::vector<Binding*>&);
+
+    // calls f(Binding*) for each match in order until f returns true
+    template <typename F>
+    void find(const Flow*, F f) const;
+
+private:
+    // a table from a criterion value to a bitmap
+    struct Dim
+    {
+        std::vector<uint32_t> cls;
+        std::vector<uint64_t> maps;
+    };
+
+    // prefix trie for one address family
+    struct Trie
+    {
+        struct Node
+        {
+            int child[2];
+            int map;
+        };
+        std::vector<Node> nodes;
+        std::vector<uint64_t> maps;
+    };
+
+    // more than enough for two 128 bit paths including the roots
+    static const unsigned max_hits = 2 * 129;
+
+    template <typename Pred>
+    void build(Dim&, unsigned size, Pred);
+
+    void add_net(Trie&, const uint8_t* addr, unsigned bits, unsigned idx);
+    bool add_nets(const sfip_var_t*, unsigned idx);
+    unsigned find_nets(const sfip_t*, const uint64_t** hits, unsigned n) const;
+
+    const uint64_t* get(const Dim& d, unsigned v) const
+    { return v < d.cls.size() ? d.maps.data() + d.cls[v] * words : none.data(); }
+
+    const uint64_t* get_service(const char*) const;
+
+    const uint64_t* get_policy(unsigned id) const
+    { return get(policies, id < policies.cls.size() ? id : policies.cls.size() - 1); }
+
+private:
+    const std::vector<Binding*>& bindings;
+    unsigned words;
+
+    Dim protos, ifaces, vlans, ports, policies;
+
+    std::vector<uint64_t> no_service;
+    std::unordered_map<std::string, std::vector<uint64_t>> services;
+
+    Trie ip4, ip6;
+    std::vector<uint64_t> any_addr;     // no nets or nets that aren't indexed
+    std::vector<uint64_t> verify_addr;  // nets that aren't indexed
+
+    std::vector<uint64_t> none;
+};
+
+template <typename F>
+void BindIndex::find(const Flow* flow, F f) const
+{
+    const uint64_t* hits[max_hits];
+    unsigned num_hits = find_nets(&flow->client_ip, hits, 0);
+    num_hits = find_nets(&flow->server_ip, hits, num_hits);
+
+    const uint64_t* proto = get(protos, (unsigned)flow->pkt_type);
+    const uint64_t* svc = get_service(flow->service);
+    const uint64_t* vlan = get(vlans, flow->key->vlan_tag);
+    const uint64_t* port = get(ports, flow->server_port);
+    const uint64_t* if_in = get(ifaces, flow->iface_in < 0 ? 0 : flow->iface_in);
+    const uint64_t* if_out = get(ifaces, flow->iface_out < 0 ? 0 : flow->iface_out);
+
+    // f may switch the flow to another policy so the policy bitmap is
+    // redone whenever the id changes
+    unsigned id = flow->policy_id;
+    const uint64_t* policy = get_policy(id);
+
+    auto mask = [&](unsigned w)
+    {
+        uint64_t m = proto[w] & policy[w] & svc[w] & vlan[w] & port[w] & (if_in[w] | if_out[w]);
+
+        if ( !m )
+            return m;
+
+        uint64_t addr = any_addr[w];
+
+        for ( unsigned i = 0; i < num_hits; ++i )
+            addr |= hits[i][w];
+
+        return m & addr;
+    };
+
+    for ( unsigned w = 0; w < words; ++w )
+    {
+        uint64_t m = mask(w);
+
+        while ( m )
+        {
+            unsigned b = __builtin_ctzll(m);
+            m &= m - 1;
+
+            Binding* pb = bindings[w * 64 + b];
+
+            if ( (verify_addr[w] & ((uint64_t)1 << b)) and !pb->check_addr(flow) )
+                continue;
+
+            if ( f(pb) )
+                return;
+
+            if ( flow->policy_id != id )
+            {
+                id = flow->policy_id;
+                policy = get_policy(id);
+
+                // the rest of this word beyond b
+                m = mask(w) & ~(((uint64_t)2 << b) - 1);
+            }
+        }
+    }
+}
+
+#endif
+
@@ -17,10 +17,12 @@
 //--------------------------------------------------------------------------
 // binder.cc author Russ Combs <rucombs@cisco.com>
 
+#include <assert.h>
 #include <vector>
 using namespace std;
 
 #include "binding.h"
+#include "bind_index.h"
 #include "bind_module.h"
 #include "flow/flow.h"
 #include "flow/session.h"
@@ -400,21 +402,30 @@ private:
     void apply(const Stuff&, Flow*);
 
     void set_binding(SnortConfig*, Binding*);
+    bool use_binding(Flow*, Stuff&, Binding*);
     void get_bindings(Flow*, Stuff&);
     void apply(Flow*, Stuff&);
     Inspector* find_gadget(Flow*);
 
+#ifndef NDEBUG
+    void verify(const Flow*);
+#endif
+
 private:
     vector<Binding*> bindings;
+    BindIndex* index;
 };
 
 Binder::Binder(vector<Binding*>& v)
 {
     bindings = std::move(v);
+    index = nullptr;
 }
 
 Binder::~Binder()
 {
+    delete index;
+
     for ( auto* p : bindings )
         delete p;
 }
@@ -431,6 +442,10 @@ bool Binder::configure(SnortConfig* sc)
         if ( !pb->use.index )
             set_binding(sc, pb);
     }
+
+    delete index;
+    index = new BindIndex(bindings);
+
     return true;
 }
 
@@ -513,39 +528,58 @@ void Binder::set_binding(SnortConfig*, Binding* pb)
         ParseError("can't bind %s", key);
 }
 
-// FIXIT-P this is a simple linear search until functionality is nailed
-// down.  performance should be the focus of the next iteration.
-void Binder::get_bindings(Flow* flow, Stuff& stuff)
+// returns true when no more bindings should be applied
+bool Binder::use_binding(Flow* flow, Stuff& stuff, Binding* pb)
 {
-    Binding* pb;
-    unsigned i, sz = bindings.size();
+    if ( !pb->use.index )
+        return stuff.update(pb);
 
-    for ( i = 0; i < sz; i++ )
-    {
-        pb = bindings[i];
+    set_policies(snort_conf, pb->use.index - 1);
+    flow->policy_id = pb->use.index - 1;
 
-        if ( !pb->check_all(flow) )
-            continue;
+    Binder* sub = (Binder*)InspectorManager::get_binder();
 
-        if ( !pb->use.index )
-        {
-            if ( stuff.update(pb) )
-                return;
-            else
-                continue;
-        }
+    if ( !sub )
+        return false;
 
-        set_policies(snort_conf, pb->use.index - 1);
-        flow->policy_id = pb->use.index - 1;
+    sub->get_bindings(flow, stuff);
+    return true;
+}
 
-        Binder* sub = (Binder*)InspectorManager::get_binder();
+#ifndef NDEBUG
+// the index must find the same bindings in the same order as checking
+// each binding in turn
+void Binder::verify(const Flow* flow)
+{
+    vector<Binding*> scan, found;
 
-        if ( sub )
-        {
-            sub->get_bindings(flow, stuff);
-            return;
-        }
+    for ( auto* pb : bindings )
+        if ( pb->check_all(flow) )
+            scan.push_back(pb);
+
+    index->find(flow, [&found](Binding* pb)
+        { found.push_back(pb); return false; });
+
+    assert(scan == found);
+}
+#endif
+
+void Binder::get_bindings(Flow* flow, Stuff& stuff)
+{
+    if ( !index )
+    {
+        for ( auto* pb : bindings )
+            if ( pb->check_all(flow) and use_binding(flow, stuff, pb) )
+                return;
+        return;
     }
+
+#ifndef NDEBUG
+    verify(flow);
+#endif
+
+    index->find(flow, [&](Binding* pb)
+        { return use_binding(flow, stuff, pb); });
 }
 
 Inspector* Binder::find_gadget(Flow* flow)
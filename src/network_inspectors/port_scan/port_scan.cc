@@ -57,6 +57,7 @@
 #include "managers/inspector_manager.h"
 #include "protocols/packet_manager.h"
 #include "protocols/packet.h"
+#include "protocols/packet_pool.h"
 #include "events/event.h"
 #include "events/event_wrapper.h"
 #include "filters/sfthreshold.h"
@@ -873,7 +874,7 @@ bool PortScan::configure(SnortConfig* sc)
 
 void PortScan::tinit()
 {
-    g_tmp_pkt = new Packet;
+    g_tmp_pkt = PacketPool::acquire();
     ps_init_hash(config->common->memcap);
 
     if ( !config->logfile )
@@ -898,7 +899,7 @@ void PortScan::tterm()
         g_logfile = nullptr;
     }
     ps_cleanup();
-    delete g_tmp_pkt;
+    PacketPool::release(g_tmp_pkt);
     g_tmp_pkt = nullptr;
 }
 
@@ -0,0 +1,171 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "packet_batch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log/messages.h"
+#include "protocols/packet.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+static const uint32_t slot_align = 64;
+
+static inline size_t align_up(size_t n)
+{ return (n + slot_align - 1) & ~(size_t)(slot_align - 1); }
+
+PacketBatch::PacketBatch(unsigned n, uint32_t snap)
+{
+    max = n ? n : 1;
+    count = 0;
+    snaplen = snap;
+    used = 0;
+
+    hdrs = new DAQ_PktHdr_t[max];
+    offsets = new size_t[max];
+    pkts = new Packet*[max];
+    decoded = new bool[max];
+
+    for ( unsigned i = 0; i < max; ++i )
+    {
+        pkts[i] = new Packet(false);
+        decoded[i] = false;
+    }
+
+    // room for a full batch of snaplen packets so add() only fails when full
+    void* p = nullptr;
+
+    if ( posix_memalign(&p, slot_align, max * align_up(snaplen)) )
+        FatalError("can't allocate %u packet batch slots\n", max);
+
+    data = (uint8_t*)p;
+}
+
+PacketBatch::~PacketBatch()
+{
+    for ( unsigned i = 0; i < max; ++i )
+        delete pkts[i];
+
+    delete[] pkts;
+    delete[] decoded;
+    delete[] offsets;
+    delete[] hdrs;
+    free(data);
+}
+
+bool PacketBatch::add(const DAQ_PktHdr_t* h, const uint8_t* pkt)
+{
+    if ( full() )
+        return false;
+
+    uint32_t len = h->caplen < snaplen ? h->caplen : snaplen;
+
+    hdrs[count] = *h;
+    hdrs[count].caplen = len;
+
+    offsets[count] = used;
+    decoded[count] = false;
+
+    memcpy(data + used, pkt, len);
+    used += align_up(len);
+    ++count;
+
+    return true;
+}
+
+//--------------------------------------------------------------------------
+// unit tests
+//--------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+TEST_CASE("fill and clear", "[PacketBatch]")
+{
+    PacketBatch pb(2, 100);
+    DAQ_PktHdr_t h;
+    memset(&h, 0, sizeof(h));
+
+    uint8_t a[16] = { 'a' };
+    uint8_t b[16] = { 'b' };
+
+    CHECK(pb.empty());
+    CHECK(pb.capacity() == 2);
+
+    h.caplen = h.pktlen = sizeof(a);
+    CHECK(pb.add(&h, a));
+    CHECK(pb.add(&h, b));
+    CHECK(pb.full());
+    CHECK(!pb.add(&h, a));
+
+    REQUIRE(pb.size() == 2);
+    CHECK(pb.get_header(1)->caplen == sizeof(b));
+    CHECK(*pb.get_data(0) == 'a');
+    CHECK(*pb.get_data(1) == 'b');
+
+    pb.clear();
+    CHECK(pb.empty());
+}
+
+TEST_CASE("packed copies", "[PacketBatch]")
+{
+    PacketBatch pb(3, 1500);
+    DAQ_PktHdr_t h;
+    memset(&h, 0, sizeof(h));
+
+    uint8_t a[10] = { 'a' };
+    uint8_t b[100] = { 'b' };
+    uint8_t c[1] = { 'c' };
+
+    h.caplen = h.pktlen = sizeof(a);
+    CHECK(pb.add(&h, a));
+    h.caplen = h.pktlen = sizeof(b);
+    CHECK(pb.add(&h, b));
+    h.caplen = h.pktlen = sizeof(c);
+    CHECK(pb.add(&h, c));
+
+    // each copy starts on the cache line after the last
+    CHECK(pb.get_data(1) == pb.get_data(0) + 64);
+    CHECK(pb.get_data(2) == pb.get_data(1) + 128);
+    CHECK(*pb.get_data(2) == 'c');
+
+    CHECK(pb.get_packet(0) != pb.get_packet(1));
+    CHECK(!pb.is_decoded(0));
+}
+
+TEST_CASE("caplen clipped to snaplen", "[PacketBatch]")
+{
+    PacketBatch pb(1, 64);
+    DAQ_PktHdr_t h;
+    memset(&h, 0, sizeof(h));
+
+    uint8_t big[256] = { 0 };
+    h.caplen = h.pktlen = sizeof(big);
+
+    CHECK(pb.add(&h, big));
+    CHECK(pb.get_header(0)->caplen == 64);
+    CHECK(pb.get_header(0)->pktlen == sizeof(big));
+}
+#endif
+
@@ -0,0 +1,96 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef PACKET_BATCH_H
+#define PACKET_BATCH_H
+
+// PacketBatch holds up to N packets acquired from the DAQ along with a
+// Packet for each so that the whole batch can be decoded first, the flows
+// prefetched, and then each packet inspected in turn.
+//
+// DAQ 2.x releases the packet buffer when the callback returns so the data
+// must be copied.  Copies are packed back to back in one slab, each taking
+// only its caplen rounded up to a cache line, so a batch of small packets
+// touches little more memory than the packets themselves.
+//
+// This is only usable when the verdict is not needed before the DAQ callback
+// returns, ie passive and readback modes.
+
+extern "C" {
+#include <daq.h>
+}
+
+#include "main/snort_types.h"
+
+struct Packet;
+
+class PacketBatch
+{
+public:
+    PacketBatch(unsigned max, uint32_t snaplen);
+    ~PacketBatch();
+
+    // returns false if the batch is already full
+    bool add(const DAQ_PktHdr_t*, const uint8_t*);
+
+    void clear()
+    { count = used = 0; }
+
+    unsigned size() const
+    { return count; }
+
+    unsigned capacity() const
+    { return max; }
+
+    bool empty() const
+    { return count == 0; }
+
+    bool full() const
+    { return count == max; }
+
+    const DAQ_PktHdr_t* get_header(unsigned i) const
+    { return hdrs + i; }
+
+    const uint8_t* get_data(unsigned i) const
+    { return data + offsets[i]; }
+
+    Packet* get_packet(unsigned i) const
+    { return pkts[i]; }
+
+    // set when packet i was decoded ahead of inspection
+    void set_decoded(unsigned i, bool b)
+    { decoded[i] = b; }
+
+    bool is_decoded(unsigned i) const
+    { return decoded[i]; }
+
+private:
+    unsigned max;
+    unsigned count;
+    uint32_t snaplen;
+    size_t used;
+
+    DAQ_PktHdr_t* hdrs;
+    size_t* offsets;
+    Packet** pkts;
+    bool* decoded;
+    uint8_t* data;
+};
+
+#endif
+
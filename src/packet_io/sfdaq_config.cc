@@ -70,6 +70,7 @@ SFDAQConfig::SFDAQConfig()
 {
     mru_size = -1;
     timeout = DEFAULT_PKT_TIMEOUT;
+    batch_size = 1;
 }
 
 SFDAQConfig::~SFDAQConfig()
@@ -121,6 +122,11 @@ void SFDAQConfig::set_mru_size(int mru_size_value)
     mru_size = mru_size_value;
 }
 
+void SFDAQConfig::set_batch_size(unsigned batch_size_value)
+{
+    batch_size = batch_size_value ? batch_size_value : 1;
+}
+
 void SFDAQConfig::set_variable(const char* varkvp, int instance_id)
 {
     if (instance_id >= 0)
@@ -159,6 +165,9 @@ void SFDAQConfig::overlay(const SFDAQConfig* other)
     if (other->mru_size != -1)
         mru_size = other->mru_size;
 
+    if (other->batch_size > 1)
+        batch_size = other->batch_size;
+
     for (auto oit = other->instances.begin(); oit != other->instances.end(); oit++)
     {
         SFDAQInstanceConfig* oic = oit->second;
@@ -58,6 +58,7 @@ static const Parameter s_params[] =
     { "instances", Parameter::PT_LIST, instance_params, nullptr, "DAQ instance overrides" },
     { "snaplen", Parameter::PT_INT, "0:65535", nullptr, "set snap length (same as -s)" },
     { "no_promisc", Parameter::PT_BOOL, nullptr, "false", "whether to put DAQ device into promiscuous mode" },
+    { "batch_size", Parameter::PT_INT, "1:1024", "1", "number of packets to acquire before processing (passive and readback modes only)" },
 
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
@@ -109,6 +110,10 @@ bool SFDAQModule::set(const char* fqn, Value& v, SnortConfig* sc)
     {
         config->set_mru_size(v.get_long());
     }
+    else if (!strcmp(fqn, "daq.batch_size"))
+    {
+        config->set_batch_size(v.get_long());
+    }
     else if (!strcmp(fqn, "daq.no_promisc"))
     {
         v.update_mask(sc->run_flags, RUN_FLAG__NO_PROMISCUOUS);
@@ -53,6 +53,9 @@ TEST_CASE("Kitchen Sink", "[SFDAQModule]")
     Value snaplen(static_cast<double>(6666));
     CHECK(sfdm.set("daq.snaplen", snaplen, &sc));
 
+    Value batch_size(static_cast<double>(32));
+    CHECK(sfdm.set("daq.batch_size", batch_size, &sc));
+
     Value no_promisc(true);
     CHECK(sfdm.set("daq.no_promisc", no_promisc, &sc));
 
@@ -95,6 +98,7 @@ TEST_CASE("Kitchen Sink", "[SFDAQModule]")
     CHECK(cfg->variables[2].second == "world");
 
     CHECK(cfg->mru_size == 6666);
+    CHECK(cfg->batch_size == 32);
 
     REQUIRE(cfg->instances.size() == 1);
     for (auto it : cfg->instances)
@@ -133,6 +137,7 @@ TEST_CASE("Kitchen Sink", "[SFDAQModule]")
     CHECK(cfg->variables[0].first == "cli_global_variable");
     CHECK(cfg->variables[0].second == "abc");
     CHECK(cfg->mru_size == 3333);
+    CHECK(cfg->batch_size == 32);
     REQUIRE(cfg->instances.size() == 2);
     for (auto it : cfg->instances)
     {
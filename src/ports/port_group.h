@@ -31,6 +31,8 @@
 // patterns.  it will always run nfp rules since there is no way to filter
 // them out.
 
+#include <stdint.h>
+
 enum PmType
 {
     PM_TYPE_PKT,
@@ -57,6 +59,10 @@ struct PortGroup
     // pattern matchers
     class Mpse* mpse[PM_TYPE_MAX];
 
+    // hash of the patterns added to each mpse, to find the same
+    // engine in the running configuration on reload
+    uint64_t mpse_key[PM_TYPE_MAX];
+
     // detection option tree
     void* nfp_tree;
 
@@ -31,6 +31,7 @@ Packet::Packet(bool packet_data)
 {
     layers = new Layer[CodecManager::get_max_layers()];
     allocated = packet_data;
+    pooled = false;
 
     if (!packet_data)
     {
@@ -51,11 +52,29 @@ Packet::Packet(bool packet_data)
     reset();
 }
 
+Packet::Packet(Layer* lyr, uint8_t* b)
+{
+    layers = lyr;
+    allocated = false;
+    pooled = true;
+
+    pkth = (DAQ_PktHdr_t*)b;
+    b += sizeof(*pkth);
+    b += SPARC_TWIDDLE;
+    pkt = b;
+
+    obfuscator = nullptr;
+
+    reset();
+}
+
 Packet::~Packet()
 {
     if (allocated)
         delete[] (uint8_t*)pkth;
-    delete[] layers;
+
+    if (!pooled)
+        delete[] layers;
 }
 
 void Packet::reset()
@@ -126,6 +126,10 @@ constexpr uint8_t DEFAULT_LAYERMAX = 40;
 struct SO_PUBLIC Packet
 {
     Packet(bool packet_data = true);
+
+    // layers and data are owned by the caller (see PacketPool)
+    Packet(Layer*, uint8_t* buf);
+
     ~Packet();
 
     class Flow* flow;   /* for session tracking */
@@ -278,6 +282,7 @@ struct SO_PUBLIC Packet
 
 private:
     bool allocated;
+    bool pooled;
 };
 
 /* Macros to deal with sequence numbers - p810 TCP Illustrated vol 2 */
@@ -38,6 +38,10 @@
 #include "protocols/eth.h"
 #include "protocols/icmp4.h"
 #include "protocols/icmp6.h"
+#include "protocols/tcp.h"
+#include "protocols/tcp_options.h"
+#include "protocols/teredo.h"
+#include "protocols/udp.h"
 #include "profiler/profiler.h"
 #include "parser/parser.h"
 
@@ -70,7 +74,8 @@ const std::array<const char*, PacketManager::stat_offset> PacketManager::stat_na
     {
         "total",
         "other",
-        "discards"
+        "discards",
+        "fast path"
     }
 };
 
@@ -115,6 +120,412 @@ void PacketManager::pop_teredo(Packet* p, RawData& raw)
     raw.len += lyr_len;
 }
 
+//-------------------------------------------------------------------------
+// fast path
+//
+// eth / ip4 | ip6 / tcp | udp is decoded here in straight line code instead
+// of by the codec loop.  the checks mirror those in cd_eth, cd_ipv4,
+// cd_ipv6, cd_tcp, and cd_udp but only accept packets that none of their
+// events, anomalies, or tunnel checks would apply to.  anything else is
+// rejected before the packet is touched and gets the generic loop, which
+// is also the only place checksum failures are counted.
+//-------------------------------------------------------------------------
+
+struct FastPathCodecs
+{
+    ProtocolIndex eth;
+    ProtocolIndex ip4;
+    ProtocolIndex ip6;
+    ProtocolIndex tcp;
+    ProtocolIndex udp;
+    ProtocolIndex done;
+    bool enabled;
+};
+
+static THREAD_LOCAL FastPathCodecs fast_path;
+
+void PacketManager::thread_init()
+{
+    // returns 0 unless the builtin codec is the one loaded for id
+    auto get_fast_codec = [](ProtocolId id, const char* name) -> ProtocolIndex
+    {
+        ProtocolIndex idx = CodecManager::s_proto_map[to_utype(id)];
+        Codec* cd = CodecManager::s_protocols[idx];
+
+        if ( !idx or !cd or strcmp(cd->get_name(), name) )
+            return 0;
+
+        return idx;
+    };
+
+    Codec* root = CodecManager::s_protocols[CodecManager::grinder];
+
+    fast_path.eth = CodecManager::grinder;
+    fast_path.ip4 = get_fast_codec(ProtocolId::ETHERTYPE_IPV4, "ipv4");
+    fast_path.ip6 = get_fast_codec(ProtocolId::ETHERTYPE_IPV6, "ipv6");
+    fast_path.tcp = get_fast_codec(ProtocolId::TCP, "tcp");
+    fast_path.udp = get_fast_codec(ProtocolId::UDP, "udp");
+    fast_path.done = CodecManager::s_proto_map[to_utype(ProtocolId::FINISHED_DECODE)];
+
+    fast_path.enabled = root and !strcmp(root->get_name(), "eth") and
+        fast_path.ip4 and fast_path.ip6 and fast_path.tcp and fast_path.udp and
+        CodecManager::max_layers >= 3;
+}
+
+static inline bool fast_ip4(const ip::IP4Hdr* iph, uint32_t len)
+{
+    if ( len < ip::IP4_HEADER_LEN or iph->ver() != 4 )
+        return false;
+
+    // no options, fragments, or reserved bit; DF is ok
+    if ( iph->hlen() != ip::IP4_HEADER_LEN or (iph->off_w_flags() & ~0x4000) )
+        return false;
+
+    if ( iph->len() < ip::IP4_HEADER_LEN or iph->len() > len )
+        return false;
+
+    if ( iph->ip_src == iph->ip_dst )
+        return false;
+
+    // excludes this net, loopback, multicast, reserved, and broadcast
+    const uint8_t msb_src = *(const uint8_t*)&iph->ip_src;
+    const uint8_t msb_dst = *(const uint8_t*)&iph->ip_dst;
+
+    if ( msb_src == ip::IP4_THIS_NET or msb_src == ip::IP4_LOOPBACK or
+        (msb_src >> 4) >= ip::IP4_MULTICAST )
+        return false;
+
+    if ( msb_dst == ip::IP4_THIS_NET or msb_dst == ip::IP4_LOOPBACK or
+        (msb_dst >> 4) >= ip::IP4_MULTICAST )
+        return false;
+
+    if ( SnortConfig::ip_checksums() and
+        checksum::ip_cksum((const uint16_t*)iph, ip::IP4_HEADER_LEN) )
+        return false;
+
+    return true;
+}
+
+static inline bool fast_ip6_addr(const ip::snort_in6_addr& a)
+{
+    // multicast, or unspecified, loopback, and v4 compatible / mapped
+    return a.u6_addr8[0] != 0xFF and (a.u6_addr32[0] or a.u6_addr32[1]);
+}
+
+static inline bool fast_ip6(const ip::IP6Hdr* ip6h, uint32_t len)
+{
+    if ( len < ip::IP6_HEADER_LEN or ip6h->ver() != 6 )
+        return false;
+
+    if ( (uint32_t)ip6h->len() + ip::IP6_HEADER_LEN > len )
+        return false;
+
+    if ( !fast_ip6_addr(ip6h->ip6_src) or !fast_ip6_addr(ip6h->ip6_dst) )
+        return false;
+
+    return memcmp(&ip6h->ip6_src, &ip6h->ip6_dst, sizeof(ip6h->ip6_src)) != 0;
+}
+
+// only options seen after the handshake are accepted; anything else,
+// including EOL which leaves invalid bytes, takes the slow path
+static inline bool fast_tcp_opts(const uint8_t* opt, const uint8_t* end)
+{
+    while ( opt < end )
+    {
+        const tcp::TcpOptCode code = (tcp::TcpOptCode)opt[0];
+
+        if ( code == tcp::TcpOptCode::NOP )
+        {
+            ++opt;
+            continue;
+        }
+
+        if ( end - opt < 2 )
+            return false;
+
+        const uint8_t len = opt[1];
+
+        switch ( code )
+        {
+        case tcp::TcpOptCode::TIMESTAMP:
+            if ( len != tcp::TCPOLEN_TIMESTAMP )
+                return false;
+            break;
+
+        case tcp::TcpOptCode::SACK:
+            if ( len < 2 )
+                return false;
+            break;
+
+        case tcp::TcpOptCode::MAXSEG:
+            if ( len != tcp::TCPOLEN_MAXSEG )
+                return false;
+            break;
+
+        case tcp::TcpOptCode::SACKOK:
+            if ( len != tcp::TCPOLEN_SACKOK )
+                return false;
+            break;
+
+        case tcp::TcpOptCode::WSCALE:
+            if ( len != tcp::TCPOLEN_WSCALE or end - opt < len or opt[2] > 14 )
+                return false;
+            break;
+
+        default:
+            return false;
+        }
+
+        if ( len > end - opt )
+            return false;
+
+        opt += len;
+    }
+    return true;
+}
+
+static inline bool fast_tcp(
+    const tcp::TCPHdr* tcph, uint32_t len, const DAQ_PktHdr_t* pkth,
+    const ip::IP4Hdr* ip4h, const ip::IP6Hdr* ip6h)
+{
+    if ( len < tcp::TCP_MIN_HEADER_LEN )
+        return false;
+
+    const uint16_t hlen = tcph->hlen();
+
+    if ( hlen < tcp::TCP_MIN_HEADER_LEN or hlen > len )
+        return false;
+
+    // established traffic; SYN and URG have events the codec must raise
+    if ( !(tcph->th_flags & TH_ACK) or (tcph->th_flags & (TH_SYN | TH_URG)) )
+        return false;
+
+    if ( !tcph->th_sport or !tcph->th_dport )
+        return false;
+
+    const uint8_t* opts = (const uint8_t*)tcph + tcp::TCP_MIN_HEADER_LEN;
+
+    if ( !fast_tcp_opts(opts, (const uint8_t*)tcph + hlen) )
+        return false;
+
+    if ( !SnortConfig::tcp_checksums() )
+        return true;
+
+    // let cd_tcp count the offloaded checksum
+    if ( SnortConfig::tcp_checksum_offloaded(pkth) )
+        return false;
+
+    if ( ip4h )
+    {
+        checksum::Pseudoheader ph;
+        ph.sip = ip4h->get_src();
+        ph.dip = ip4h->get_dst();
+        ph.zero = 0;
+        ph.protocol = ip4h->proto();
+        ph.len = htons((uint16_t)len);
+        return !checksum::tcp_cksum((const uint16_t*)tcph, len, &ph);
+    }
+
+    checksum::Pseudoheader6 ph6;
+    COPY4(ph6.sip, ip6h->ip6_src.u6_addr32);
+    COPY4(ph6.dip, ip6h->ip6_dst.u6_addr32);
+    ph6.zero = 0;
+    ph6.protocol = ip6h->next();
+    ph6.len = htons((uint16_t)len);
+    return !checksum::tcp_cksum((const uint16_t*)tcph, len, &ph6);
+}
+
+static inline bool fast_udp(
+    const udp::UDPHdr* udph, uint32_t len,
+    const ip::IP4Hdr* ip4h, const ip::IP6Hdr* ip6h)
+{
+    if ( len < udp::UDP_HEADER_LEN or ntohs(udph->uh_len) != len )
+        return false;
+
+    if ( len - udp::UDP_HEADER_LEN > 4000 )
+        return false;
+
+    const uint16_t sp = udph->src_port();
+    const uint16_t dp = udph->dst_port();
+
+    if ( !sp or !dp )
+        return false;
+
+    // tunnels are decoded by the codec loop
+    if ( SnortConfig::gtp_decoding() and
+        (SnortConfig::is_gtp_port(sp) or SnortConfig::is_gtp_port(dp)) )
+        return false;
+
+    if ( teredo::is_teredo_port(sp) or teredo::is_teredo_port(dp) or
+        SnortConfig::deep_teredo_inspection() )
+        return false;
+
+    if ( !SnortConfig::udp_checksums() )
+        return true;
+
+    if ( ip4h )
+    {
+        if ( !udph->uh_chk )
+            return true;
+
+        checksum::Pseudoheader ph;
+        ph.sip = ip4h->get_src();
+        ph.dip = ip4h->get_dst();
+        ph.zero = 0;
+        ph.protocol = ip4h->proto();
+        ph.len = udph->uh_len;
+        return !checksum::udp_cksum((const uint16_t*)udph, len, &ph);
+    }
+
+    if ( !udph->uh_chk )
+        return false;
+
+    checksum::Pseudoheader6 ph6;
+    COPY4(ph6.sip, ip6h->ip6_src.u6_addr32);
+    COPY4(ph6.dip, ip6h->ip6_dst.u6_addr32);
+    ph6.zero = 0;
+    ph6.protocol = ip6h->next();
+    ph6.len = htons((uint16_t)len);
+    return !checksum::udp_cksum((const uint16_t*)udph, len, &ph6);
+}
+
+// the packet is only modified once all layers are known to be good
+bool PacketManager::fast_decode(Packet* p, const RawData& raw)
+{
+    if ( raw.len < eth::ETH_HEADER_LEN )
+        return false;
+
+    const eth::EtherHdr* eh = reinterpret_cast<const eth::EtherHdr*>(raw.data);
+    const ProtocolId ip_id = eh->ethertype();
+
+    const uint8_t* ip_start = raw.data + eth::ETH_HEADER_LEN;
+    const uint32_t ip_max = raw.len - eth::ETH_HEADER_LEN;
+
+    const ip::IP4Hdr* ip4h = nullptr;
+    const ip::IP6Hdr* ip6h = nullptr;
+
+    uint16_t ip_hlen;
+    uint32_t ip_len;
+    IpProtocol proto;
+
+    if ( ip_id == ProtocolId::ETHERTYPE_IPV4 )
+    {
+        ip4h = reinterpret_cast<const ip::IP4Hdr*>(ip_start);
+
+        if ( !fast_ip4(ip4h, ip_max) )
+            return false;
+
+        ip_hlen = ip::IP4_HEADER_LEN;
+        ip_len = ip4h->len();
+        proto = ip4h->proto();
+    }
+    else if ( ip_id == ProtocolId::ETHERTYPE_IPV6 )
+    {
+        ip6h = reinterpret_cast<const ip::IP6Hdr*>(ip_start);
+
+        if ( !fast_ip6(ip6h, ip_max) )
+            return false;
+
+        ip_hlen = ip::IP6_HEADER_LEN;
+        ip_len = ip6h->len() + ip::IP6_HEADER_LEN;
+        proto = ip6h->next();
+    }
+    else
+        return false;
+
+    const uint8_t* l4 = ip_start + ip_hlen;
+    const uint32_t l4_len = ip_len - ip_hlen;
+    uint16_t l4_hlen;
+
+    ProtocolId l4_id;
+    ProtocolIndex l4_idx;
+
+    if ( proto == IpProtocol::TCP )
+    {
+        const tcp::TCPHdr* tcph = reinterpret_cast<const tcp::TCPHdr*>(l4);
+
+        if ( !fast_tcp(tcph, l4_len, raw.pkth, ip4h, ip6h) )
+            return false;
+
+        l4_hlen = tcph->hlen();
+        l4_id = ProtocolId::TCP;
+        l4_idx = fast_path.tcp;
+
+        p->ptrs.tcph = tcph;
+        p->ptrs.sp = tcph->src_port();
+        p->ptrs.dp = tcph->dst_port();
+        p->ptrs.set_pkt_type(PktType::TCP);
+        p->proto_bits |= PROTO_BIT__TCP;
+    }
+    else if ( proto == IpProtocol::UDP )
+    {
+        const udp::UDPHdr* udph = reinterpret_cast<const udp::UDPHdr*>(l4);
+
+        if ( !fast_udp(udph, l4_len, ip4h, ip6h) )
+            return false;
+
+        l4_hlen = udp::UDP_HEADER_LEN;
+        l4_id = ProtocolId::UDP;
+        l4_idx = fast_path.udp;
+
+        p->ptrs.udph = udph;
+        p->ptrs.sp = udph->src_port();
+        p->ptrs.dp = udph->dst_port();
+        p->ptrs.set_pkt_type(PktType::UDP);
+        p->proto_bits |= PROTO_BIT__UDP;
+    }
+    else
+        return false;
+
+    if ( ip4h )
+    {
+        p->ptrs.ip_api.set(ip4h);
+        s_stats[fast_path.ip4 + stat_offset]++;
+    }
+    else
+    {
+        p->ptrs.ip_api.set(ip6h);
+        s_stats[fast_path.ip6 + stat_offset]++;
+    }
+
+    push_layer(p, CodecManager::grinder_id, raw.data, eth::ETH_HEADER_LEN);
+    push_layer(p, ip_id, ip_start, ip_hlen);
+    push_layer(p, l4_id, l4, l4_hlen);
+
+    s_stats[fast_path.eth + stat_offset]++;
+    s_stats[l4_idx + stat_offset]++;
+    s_stats[fast_path.done + stat_offset]++;
+    s_stats[fast_path_hits]++;
+
+    p->ip_proto_next = proto;
+    p->proto_bits |= PROTO_BIT__ETH | PROTO_BIT__IP;
+
+    p->data = l4 + l4_hlen;
+    p->dsize = (uint16_t)(l4_len - l4_hlen);
+
+    return true;
+}
+
+bool PacketManager::predecode(Packet* p, const DAQ_PktHdr_t* pkthdr, const uint8_t* pkt)
+{
+    if ( !fast_path.enabled )
+        return false;
+
+    Profile profile(decodePerfStats);
+
+    RawData raw(pkthdr, pkt);
+
+    p->reset();
+    p->pkth = pkthdr;
+    p->pkt = pkt;
+
+    if ( !fast_decode(p, raw) )
+        return false;
+
+    s_stats[total_processed]++;
+    return true;
+}
+
 //-------------------------------------------------------------------------
 // Initialization and setup
 //-------------------------------------------------------------------------
@@ -160,6 +571,9 @@ void PacketManager::decode(
 
     s_stats[total_processed]++;
 
+    if ( fast_path.enabled and !cooked and fast_decode(p, raw) )
+        return;
+
     // loop until the protocol id is no longer valid
     while (CodecManager::s_protocols[mapped_prot]->decode(raw, codec_data, p->ptrs))
     {
@@ -849,7 +1263,7 @@ void PacketManager::dump_stats()
     std::vector<const char*> pkt_names;
 
     // zero out the default codecs
-    g_stats[3] = 0;
+    g_stats[stat_offset] = 0;
     g_stats[CodecManager::s_proto_map[to_utype(ProtocolId::FINISHED_DECODE)] + stat_offset] = 0;
 
     for (unsigned int i = 0; i < stat_names.size(); i++)
@@ -58,6 +58,15 @@ public:
     // decode this packet and set all relevent packet fields.
     static void decode(Packet*, const struct _daq_pkthdr*, const uint8_t*, bool cooked = false);
 
+    // decode ahead of time using the fast path only since that has no side
+    // effects (events, active state) beyond the packet and decode counts.
+    // returns false if the packet must be given to decode() instead.
+    static bool predecode(Packet*, const struct _daq_pkthdr*, const uint8_t*);
+
+    // enables the fast path if the codecs it stands in for are loaded.
+    // call after CodecManager::thread_init().
+    static void thread_init();
+
     // when encoding, rather than copy the destination MAC address from the
     // inbound packet, manually set the MAC address.
     static void encode_set_dst_mac(uint8_t*);
@@ -146,6 +155,7 @@ private:
     friend void CodecManager::thread_term();
     static void accumulate();
     static void pop_teredo(Packet*, RawData&);
+    static bool fast_decode(Packet*, const RawData&);
 
     static bool encode(const Packet*, EncodeFlags,
         uint8_t lyr_start, IpProtocol next_prot, Buffer& buf);
@@ -155,7 +165,8 @@ private:
     static const uint8_t total_processed = 0;
     static const uint8_t other_codecs = 1;
     static const uint8_t discards = 2;
-    static const uint8_t stat_offset = 3;
+    static const uint8_t fast_path_hits = 3;
+    static const uint8_t stat_offset = 4;
 
     // declared in header so it can access s_protocols
     static THREAD_LOCAL std::array<PegCount, stat_offset +
@@ -0,0 +1,148 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "packet_pool.h"
+
+#include <assert.h>
+#include <new>
+
+#include "framework/codec.h"
+#include "main/thread.h"
+#include "managers/codec_manager.h"
+#include "protocols/layer.h"
+#include "protocols/packet.h"
+#include "utils/stats.h"
+#include "utils/util.h"
+
+// each buffer holds a header and the largest packet, rounded up to a
+// cache line so that buffers don't share lines
+static const size_t buf_size =
+    (sizeof(DAQ_PktHdr_t) + Codec::PKT_MAX + SPARC_TWIDDLE + 63) & ~(size_t)63;
+
+struct PoolData
+{
+    Packet* packets;
+    Layer* layers;
+    uint8_t* bufs;
+    uint8_t* mem;
+
+    Packet** free_list;
+    unsigned num_free;
+    unsigned max;
+};
+
+static THREAD_LOCAL PoolData* pool = nullptr;
+
+static inline bool is_pooled(const Packet* p)
+{
+    return pool and p >= pool->packets and p < pool->packets + pool->max;
+}
+
+//-------------------------------------------------------------------------
+// PacketPool methods
+//-------------------------------------------------------------------------
+
+void PacketPool::thread_init(unsigned max)
+{
+    assert(!pool);
+    pool = (PoolData*)snort_calloc(sizeof(*pool));
+
+    const unsigned num_layers = CodecManager::get_max_layers();
+
+    pool->max = max;
+    pool->packets = (Packet*)snort_calloc(max, sizeof(Packet));
+    pool->layers = (Layer*)snort_calloc((size_t)max * num_layers, sizeof(Layer));
+    pool->free_list = (Packet**)snort_calloc(max, sizeof(Packet*));
+
+    // the buffers are aligned by hand since the slab may not be
+    pool->mem = (uint8_t*)snort_calloc((size_t)max * buf_size + 63, 1);
+    pool->bufs = (uint8_t*)(((uintptr_t)pool->mem + 63) & ~(uintptr_t)63);
+
+    // the free list is a stack so the first packets stay hot
+    for ( unsigned i = 0; i < max; ++i )
+    {
+        unsigned idx = max - i - 1;
+        Packet* p = pool->packets + idx;
+        new(p) Packet(pool->layers + (size_t)idx * num_layers, pool->bufs + idx * buf_size);
+        pool->free_list[i] = p;
+    }
+    pool->num_free = max;
+}
+
+void PacketPool::thread_term()
+{
+    if ( !pool )
+        return;
+
+    // packets must be released before the pool is terminated
+    assert(pool->num_free == pool->max);
+
+    for ( unsigned i = 0; i < pool->max; ++i )
+    {
+        Packet* p = pool->packets + i;
+        p->reset();
+        p->~Packet();
+    }
+
+    snort_free(pool->packets);
+    snort_free(pool->layers);
+    snort_free(pool->free_list);
+    snort_free(pool->mem);
+    snort_free(pool);
+    pool = nullptr;
+}
+
+Packet* PacketPool::acquire()
+{
+    if ( !pool or !pool->num_free )
+    {
+        aux_counts.pool_misses++;
+        return new Packet();
+    }
+
+    return pool->free_list[--pool->num_free];
+}
+
+void PacketPool::release(Packet* p)
+{
+    if ( !p )
+        return;
+
+    if ( !is_pooled(p) )
+    {
+        delete p;
+        return;
+    }
+
+    assert(pool->num_free < pool->max);
+
+    // users may have pointed pkth or pkt elsewhere
+    size_t idx = p - pool->packets;
+    uint8_t* b = pool->bufs + idx * buf_size;
+
+    p->reset();
+    p->pkth = (DAQ_PktHdr_t*)b;
+    p->pkt = b + sizeof(DAQ_PktHdr_t) + SPARC_TWIDDLE;
+
+    pool->free_list[pool->num_free++] = p;
+}
+
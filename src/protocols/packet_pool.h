@@ -0,0 +1,48 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+// PacketPool holds the pseudo packets used by a packet thread, ie the
+// rebuilt packets from stream and defrag, port scan alerts, etc.  The
+// packets, their layers, and their data buffers are each allocated in one
+// slab when the thread starts so that getting a packet never allocates
+// and the packets stay close together in memory.  If the pool runs out,
+// packets come from the heap and are deleted when released.
+
+#include "main/snort_types.h"
+
+struct Packet;
+
+class SO_PUBLIC PacketPool
+{
+public:
+    static void thread_init(unsigned max_packets = default_size);
+    static void thread_term();
+
+    // returns a reset packet with its own data buffer
+    static Packet* acquire();
+    static void release(Packet*);
+
+private:
+    static const unsigned default_size = 8;
+};
+
+#endif
+
@@ -76,10 +76,22 @@ public:
         return bnfaCompile(sc, obj);
     }
 
+    bool concurrent_prep() override
+    { return true; }
+
+    bool reuse(SnortConfig* sc, Mpse* prev) override
+    {
+        return !bnfaReuse(sc, obj, ((AcBnfaMpse*)prev)->obj);
+    }
+
     int _search(
         const uint8_t* T, int n, MpseMatch match,
         void* context, int* current_state) override
     {
+        if ( obj->bnfaCompactList )
+            return _bnfa_search_compact_nfa(
+                obj, T, n, match, context, 0 /* start-state */, current_state);
+
         /* return is actually the state */
         return _bnfa_search_csparse_nfa(
             obj, T, n, match, context, 0 /* start-state */, current_state);
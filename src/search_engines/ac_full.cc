@@ -62,6 +62,9 @@ public:
     int prep_patterns(SnortConfig* sc) override
     { return acsmCompile2(sc, obj); }
 
+    bool concurrent_prep() override
+    { return true; }
+
     int _search(
         const uint8_t* T, int n, MpseMatch match,
         void* context, int* current_state) override
@@ -72,6 +75,14 @@ public:
         return acsm_search_nfa(obj, T, n, match, context, current_state);
     }
 
+    int _search_batch(MpseBatchItem* items, unsigned n, MpseMatch match) override
+    {
+        if ( obj->dfa_enabled() )
+            return acsm_search_dfa_full_batch(obj, items, n, match);
+
+        return Mpse::_search_batch(items, n, match);
+    }
+
     int search_all(
         const uint8_t* T, int n, MpseMatch match,
         void* context, int* current_state) override
@@ -0,0 +1,327 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "ac_prefilter.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AC_PREFILTER_X86
+#include <immintrin.h>
+#endif
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+// beyond these the filter finds candidates too often to beat the DFA
+static const unsigned max_first_bytes = 192;
+static const unsigned max_pairs = 65536 / 8;
+
+//-------------------------------------------------------------------------
+// kernels
+//-------------------------------------------------------------------------
+
+static const uint8_t* skip_scalar(
+    const AcPrefilter* pf, const uint8_t* T, const uint8_t* Tend)
+{
+    for ( ; T < Tend; ++T )
+    {
+        if ( pf->is_candidate(T, Tend) )
+            return T;
+    }
+    return Tend;
+}
+
+#ifdef AC_PREFILTER_X86
+__attribute__((target("ssse3")))
+static const uint8_t* skip_ssse3(
+    const AcPrefilter* pf, const uint8_t* T, const uint8_t* Tend)
+{
+    const __m128i lo = _mm_load_si128((const __m128i*)pf->lo_mask);
+    const __m128i hi = _mm_load_si128((const __m128i*)pf->hi_mask);
+    const __m128i nib = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+
+    while ( Tend - T >= 16 )
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)T);
+        __m128i l = _mm_shuffle_epi8(lo, _mm_and_si128(x, nib));
+        __m128i h = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(x, 4), nib));
+        __m128i m = _mm_cmpeq_epi8(_mm_and_si128(l, h), zero);
+        unsigned bits = ~_mm_movemask_epi8(m) & 0xFFFF;
+
+        while ( bits )
+        {
+            const uint8_t* c = T + __builtin_ctz(bits);
+
+            if ( pf->is_candidate(c, Tend) )
+                return c;
+
+            bits &= bits - 1;
+        }
+        T += 16;
+    }
+    return skip_scalar(pf, T, Tend);
+}
+
+__attribute__((target("avx2")))
+static const uint8_t* skip_avx2(
+    const AcPrefilter* pf, const uint8_t* T, const uint8_t* Tend)
+{
+    // pshufb works within each 128 bit lane so both lanes get the table
+    const __m256i lo = _mm256_broadcastsi128_si256(
+        _mm_load_si128((const __m128i*)pf->lo_mask));
+    const __m256i hi = _mm256_broadcastsi128_si256(
+        _mm_load_si128((const __m128i*)pf->hi_mask));
+    const __m256i nib = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+
+    while ( Tend - T >= 32 )
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i*)T);
+        __m256i l = _mm256_shuffle_epi8(lo, _mm256_and_si256(x, nib));
+        __m256i h = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(x, 4), nib));
+        __m256i m = _mm256_cmpeq_epi8(_mm256_and_si256(l, h), zero);
+        uint32_t bits = ~(uint32_t)_mm256_movemask_epi8(m);
+
+        while ( bits )
+        {
+            const uint8_t* c = T + __builtin_ctz(bits);
+
+            if ( pf->is_candidate(c, Tend) )
+                return c;
+
+            bits &= bits - 1;
+        }
+        T += 32;
+    }
+    return skip_ssse3(pf, T, Tend);
+}
+#endif
+
+static AcPrefilter::Kernel select_kernel()
+{
+#ifdef AC_PREFILTER_X86
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports("avx2") )
+        return skip_avx2;
+
+    if ( __builtin_cpu_supports("ssse3") )
+        return skip_ssse3;
+#endif
+    return skip_scalar;
+}
+
+//-------------------------------------------------------------------------
+// build
+//-------------------------------------------------------------------------
+
+AcPrefilter::AcPrefilter(const uint8_t* x)
+{
+    xlat = x;
+    kernel = skip_scalar;
+
+    memset(lo_mask, 0, sizeof(lo_mask));
+    memset(hi_mask, 0, sizeof(hi_mask));
+    memset(first, 0, sizeof(first));
+    memset(single, 0, sizeof(single));
+    memset(pairs, 0, sizeof(pairs));
+}
+
+// until compile(), first, single, and pairs are indexed by translated bytes
+void AcPrefilter::add(const uint8_t* pat, unsigned len)
+{
+    if ( !len )
+        return;
+
+    first[pat[0]] = 1;
+
+    if ( len == 1 )
+    {
+        single[pat[0]] = 1;
+        return;
+    }
+
+    unsigned pair = (pat[0] << 8) | pat[1];
+    pairs[pair >> 6] |= (uint64_t)1 << (pair & 63);
+}
+
+bool AcPrefilter::compile()
+{
+    uint8_t xfirst[256];
+    uint8_t xsingle[256];
+    uint64_t xpairs[1024];
+
+    memcpy(xfirst, first, sizeof(first));
+    memcpy(xsingle, single, sizeof(single));
+    memcpy(xpairs, pairs, sizeof(pairs));
+    memset(pairs, 0, sizeof(pairs));
+
+    unsigned num_first = 0;
+    unsigned num_pairs = 0;
+
+    // expand to raw bytes so searching needn't translate
+    for ( unsigned a = 0; a < 256; ++a )
+    {
+        first[a] = xfirst[xlat[a]];
+        single[a] = xsingle[xlat[a]];
+
+        if ( !first[a] )
+            continue;
+
+        ++num_first;
+        lo_mask[a & 0xF] |= 1 << ((a >> 4) & 7);
+
+        for ( unsigned b = 0; b < 256; ++b )
+        {
+            unsigned xp = (xlat[a] << 8) | xlat[b];
+
+            if ( (xpairs[xp >> 6] >> (xp & 63)) & 1 )
+            {
+                unsigned rp = (a << 8) | b;
+                pairs[rp >> 6] |= (uint64_t)1 << (rp & 63);
+                ++num_pairs;
+            }
+        }
+    }
+
+    for ( unsigned h = 0; h < 16; ++h )
+        hi_mask[h] = 1 << (h & 7);
+
+    if ( !num_first or num_first > max_first_bytes or num_pairs > max_pairs )
+        return false;
+
+    kernel = select_kernel();
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+static uint8_t s_xlat[256];
+
+static AcPrefilter* make_filter(const char** pats, unsigned n)
+{
+    for ( unsigned i = 0; i < 256; ++i )
+        s_xlat[i] = (uint8_t)toupper(i);
+
+    AcPrefilter* pf = new AcPrefilter(s_xlat);
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        uint8_t buf[64];
+        unsigned len = strlen(pats[i]);
+
+        for ( unsigned j = 0; j < len; ++j )
+            buf[j] = s_xlat[(uint8_t)pats[i][j]];
+
+        pf->add(buf, len);
+    }
+    return pf;
+}
+
+TEST_CASE("candidates", "[AcPrefilter]")
+{
+    const char* pats[] = { "abc", "XY", "z" };
+    AcPrefilter* pf = make_filter(pats, 3);
+    REQUIRE(pf->compile());
+
+    const uint8_t* s = (const uint8_t*)"..ax..aB..xy..Z";
+    const uint8_t* e = s + strlen((const char*)s);
+
+    // ax isn't a prefix pair
+    CHECK(pf->skip(s, e) == s + 6);
+    CHECK(pf->skip(s + 7, e) == s + 10);
+    CHECK(pf->skip(s + 11, e) == s + 14);
+    CHECK(pf->skip(s + 15, e) == e);
+
+    // a pair cut off by the end of the buffer is a candidate
+    CHECK(pf->skip(s, s + 3) == s + 2);
+
+    delete pf;
+}
+
+TEST_CASE("kernels agree", "[AcPrefilter]")
+{
+    const char* pats[] = { "GET", "POST", "\x90\x90", "/bin", "%u", "<scr" };
+    AcPrefilter* pf = make_filter(pats, 6);
+    REQUIRE(pf->compile());
+
+    uint8_t buf[1024];
+    uint32_t r = 12345;
+
+    for ( unsigned i = 0; i < sizeof(buf); ++i )
+    {
+        r = r * 1103515245 + 12345;
+        buf[i] = (uint8_t)(r >> 16);
+    }
+    memcpy(buf + 100, "get", 3);
+    memcpy(buf + 517, "<SCRIPT", 7);
+    buf[sizeof(buf) - 1] = '%';
+
+    const uint8_t* e = buf + sizeof(buf);
+
+    for ( unsigned start = 0; start < 64; ++start )
+    {
+        const uint8_t* a = buf + start;
+        const uint8_t* b = buf + start;
+
+        do
+        {
+            a = skip_scalar(pf, a, e);
+            b = pf->skip(b, e);
+            REQUIRE(a == b);
+#ifdef AC_PREFILTER_X86
+            CHECK(skip_ssse3(pf, b, e) == a);
+#endif
+            if ( a < e )
+            {
+                ++a;
+                ++b;
+            }
+        }
+        while ( a < e );
+    }
+    delete pf;
+}
+
+TEST_CASE("too many candidates", "[AcPrefilter]")
+{
+    for ( unsigned i = 0; i < 256; ++i )
+        s_xlat[i] = (uint8_t)i;
+
+    AcPrefilter pf(s_xlat);
+
+    for ( unsigned i = 0; i < 256; ++i )
+    {
+        uint8_t pat[2] = { (uint8_t)i, (uint8_t)i };
+        pf.add(pat, 2);
+    }
+    CHECK(!pf.compile());
+}
+#endif
+
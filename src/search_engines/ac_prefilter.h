@@ -0,0 +1,80 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef AC_PREFILTER_H
+#define AC_PREFILTER_H
+
+// AcPrefilter finds the next position in a buffer where a pattern could
+// start based on the first two bytes of all patterns.  While a DFA is in
+// its root state every other byte takes it straight back to the root so
+// those bytes can be skipped without walking the state table.
+//
+// Candidates for the first byte are found 16 or 32 at a time with nibble
+// lookup tables (shufti) using SSSE3 or AVX2 when the CPU has them and then
+// checked exactly against the first byte and byte pair tables.  The kernel
+// is selected at runtime; the scalar version is always available.
+
+#include <cstdint>
+
+class AcPrefilter
+{
+public:
+    // xlat maps each byte to the case used by the patterns
+    AcPrefilter(const uint8_t* xlat);
+
+    // pattern must already be translated
+    void add(const uint8_t* pat, unsigned len);
+
+    // returns false if too many positions would be candidates to pay off
+    bool compile();
+
+    // returns the first candidate in [T, Tend) or Tend
+    const uint8_t* skip(const uint8_t* T, const uint8_t* Tend) const
+    { return kernel(this, T, Tend); }
+
+    bool is_candidate(const uint8_t* T, const uint8_t* Tend) const
+    {
+        if ( !first[T[0]] )
+            return false;
+
+        if ( single[T[0]] or T + 1 == Tend )
+            return true;
+
+        unsigned pair = (T[0] << 8) | T[1];
+        return (pairs[pair >> 6] >> (pair & 63)) & 1;
+    }
+
+public:
+    // for use by the kernels
+    typedef const uint8_t* (* Kernel)(const AcPrefilter*, const uint8_t*, const uint8_t*);
+
+    alignas(16) uint8_t lo_mask[16];  // shufti buckets by low nibble
+    alignas(16) uint8_t hi_mask[16];  // shufti buckets by high nibble
+
+private:
+    const uint8_t* xlat;
+    Kernel kernel;
+
+    // indexed by raw (not translated) bytes
+    uint8_t first[256];       // byte can start a pattern
+    uint8_t single[256];      // byte is a whole pattern
+    uint64_t pairs[1024];     // 64K bit map of 2 byte pattern prefixes
+};
+
+#endif
+
@@ -58,6 +58,9 @@ public:
     int prep_patterns(SnortConfig* sc) override
     { return acsmCompile(sc, obj); }
 
+    bool concurrent_prep() override
+    { return true; }
+
     int _search(
         const uint8_t* T, int n, MpseMatch match,
         void* context, int* current_state) override
@@ -60,6 +60,7 @@
 #include <string.h>
 #include <ctype.h>
 
+#include <atomic>
 #include <list>
 
 #include "main/snort_debug.h"
@@ -68,7 +69,7 @@
 
 #define MEMASSERT(p,s) if (!p) { fprintf(stderr,"ACSM-No Memory: %s\n",s); exit(0); }
 
-static int max_memory = 0;
+static std::atomic<int> max_memory(0);
 
 static void* AC_MALLOC(int n)
 {
@@ -112,6 +112,7 @@
 */
 
 #include "acsmx2.h"
+#include "ac_prefilter.h"
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -122,11 +123,14 @@
 #include <string.h>
 #include <ctype.h>
 
+#include <atomic>
 #include <list>
+#include <mutex>
 
 #define ACSMX2_TRACK_Q
 
 #ifdef  ACSMX2_TRACK_Q
+#include "framework/mpse.h"
 #include "main/snort_config.h"
 #endif
 
@@ -139,15 +143,15 @@
 
 #define MEMASSERT(p,s) if (!p) { FatalError("ACSM-No Memory: %s\n",s); }
 
-static int acsm2_total_memory = 0;
-static int acsm2_pattern_memory = 0;
-static int acsm2_matchlist_memory = 0;
-static int acsm2_transtable_memory = 0;
-static int acsm2_dfa_memory = 0;
-static int acsm2_dfa1_memory = 0;
-static int acsm2_dfa2_memory = 0;
-static int acsm2_dfa4_memory = 0;
-static int acsm2_failstate_memory = 0;
+static std::atomic<int> acsm2_total_memory(0);
+static std::atomic<int> acsm2_pattern_memory(0);
+static std::atomic<int> acsm2_matchlist_memory(0);
+static std::atomic<int> acsm2_transtable_memory(0);
+static std::atomic<int> acsm2_dfa_memory(0);
+static std::atomic<int> acsm2_dfa1_memory(0);
+static std::atomic<int> acsm2_dfa2_memory(0);
+static std::atomic<int> acsm2_dfa4_memory(0);
+static std::atomic<int> acsm2_failstate_memory(0);
 
 struct acsm_summary_t
 {
@@ -163,7 +167,9 @@ struct acsm_summary_t
     ACSM_STRUCT2 acsm;
 };
 
+// instances may be compiled on several threads at once
 static acsm_summary_t summary;
+static std::mutex summary_mutex;
 
 void acsm_init_summary()
 {
@@ -1119,8 +1125,9 @@ int acsmAddPattern2(
 /*
 *  Copy a boolean match flag int NextState table, for caching purposes.
 */
-static void acsmUpdateMatchStates(ACSM_STRUCT2* acsm)
+static unsigned acsmUpdateMatchStates(ACSM_STRUCT2* acsm)
 {
+    unsigned num_match_states = 0;
     acstate_t state;
     acstate_t** NextState = acsm->acsmNextState;
     ACSM_PATTERN2** MatchList = acsm->acsmMatchList;
@@ -1144,9 +1151,10 @@ static void acsmUpdateMatchStates(ACSM_STRUCT2* acsm)
                 break;
             }
 
-            summary.num_match_states++;
+            num_match_states++;
         }
     }
+    return num_match_states;
 }
 
 static void acsmBuildMatchStateTrees2(SnortConfig* sc, ACSM_STRUCT2* acsm)
@@ -1196,6 +1204,7 @@ void acsmCompressStates(
 static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
 {
     ACSM_PATTERN2* plist;
+    unsigned num_characters = 0;
 
     /* Count number of possible states */
     for (plist = acsm->acsmPatterns; plist != NULL; plist = plist->next)
@@ -1221,8 +1230,7 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
     /* Add each Pattern to the State Table - This forms a keywords state table  */
     for (plist = acsm->acsmPatterns; plist != NULL; plist = plist->next)
     {
-        summary.num_patterns++;
-        summary.num_characters += plist->n;
+        num_characters += plist->n;
         AddPatternStates(acsm, plist);
     }
 
@@ -1232,20 +1240,13 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
     if (acsm->compress_states)
     {
         if (acsm->acsmNumStates < UINT8_MAX)
-        {
             acsm->sizeofstate = 1;
-            summary.num_1byte_instances++;
-        }
+
         else if (acsm->acsmNumStates < UINT16_MAX)
-        {
             acsm->sizeofstate = 2;
-            summary.num_2byte_instances++;
-        }
+
         else
-        {
             acsm->sizeofstate = 4;
-            summary.num_4byte_instances++;
-        }
     }
     else
     {
@@ -1307,12 +1308,30 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
     }
 
     /* load boolean match flags into state table */
-    acsmUpdateMatchStates(acsm);
+    unsigned num_match_states = acsmUpdateMatchStates(acsm);
 
     /* Free up the Table Of Transition Lists */
     List_FreeTransTable(acsm);
 
     /* Accrue Summary State Stats */
+    std::lock_guard<std::mutex> lock(summary_mutex);
+
+    summary.num_patterns += acsm->numPatterns;
+    summary.num_characters += num_characters;
+    summary.num_match_states += num_match_states;
+
+    if ( acsm->compress_states )
+    {
+        if ( acsm->sizeofstate == 1 )
+            summary.num_1byte_instances++;
+
+        else if ( acsm->sizeofstate == 2 )
+            summary.num_2byte_instances++;
+
+        else
+            summary.num_4byte_instances++;
+    }
+
     summary.num_states += acsm->acsmNumStates;
     summary.num_transitions += acsm->acsmNumTrans;
     summary.num_instances++;
@@ -1322,12 +1341,28 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
     return 0;
 }
 
+static void acsmBuildPrefilter2(ACSM_STRUCT2* acsm)
+{
+    AcPrefilter* pf = new AcPrefilter(xlatcase);
+
+    for ( ACSM_PATTERN2* plist = acsm->acsmPatterns; plist; plist = plist->next )
+        pf->add(plist->patrn, plist->n);
+
+    if ( pf->compile() )
+        acsm->prefilter = pf;
+    else
+        delete pf;
+}
+
 int acsmCompile2(
     SnortConfig* sc, ACSM_STRUCT2* acsm)
 {
     if ( int rval = _acsmCompile2(acsm) )
         return rval;
 
+    if ( acsm->dfa and acsm->acsmFormat == ACF_FULL )
+        acsmBuildPrefilter2(acsm);
+
     if ( acsm->agent )
         acsmBuildMatchStateTrees2(sc, acsm);
 
@@ -1627,6 +1662,41 @@ void acsmx2_print_qinfo()
         state = ps[2u + sindex]; \
     }
 
+/*
+*   Same as AC_SEARCH but whenever the DFA is back in state 0 the prefilter
+*   is used to jump to the next byte that could start a match.  State 0 has
+*   no matches and bytes that aren't candidates leave it in state 0.
+*/
+#define AC_SEARCH_PREFILTER \
+    while ( T < Tend ) \
+    { \
+        if ( !state ) \
+        { \
+            T = pf->skip(T, Tend); \
+            if ( T == Tend ) \
+                break; \
+        } \
+        ps = NextState[ state ]; \
+        sindex = xlatcase[T[0]]; \
+        if (ps[1]) \
+        { \
+            mlist = MatchList[state]; \
+            if (mlist) \
+            { \
+                index = T - Tx; \
+                nfound++; \
+                if (match (mlist->udata, mlist->rule_option_tree, index, context, \
+                    mlist->neg_list) > 0) \
+                { \
+                    *current_state = state; \
+                    return nfound; \
+                } \
+            } \
+        } \
+        state = ps[2u + sindex]; \
+        T++; \
+    }
+
 int acsm_search_dfa_full(
     ACSM_STRUCT2* acsm, const uint8_t* Tx, int n, MpseMatch match,
     void* context, int* current_state
@@ -1640,6 +1710,7 @@ int acsm_search_dfa_full(
     int nfound = 0;
     acstate_t state;
     ACSM_PATTERN2** MatchList = acsm->acsmMatchList;
+    const AcPrefilter* pf = acsm->prefilter;
 
     T = Tx;
     Tend = Tx + n;
@@ -1655,21 +1726,45 @@ int acsm_search_dfa_full(
     {
         uint8_t* ps;
         uint8_t** NextState = (uint8_t**)acsm->acsmNextState;
-        AC_SEARCH;
+
+        if ( pf )
+        {
+            AC_SEARCH_PREFILTER;
+        }
+        else
+        {
+            AC_SEARCH;
+        }
     }
     break;
     case 2:
     {
         uint16_t* ps;
         uint16_t** NextState = (uint16_t**)acsm->acsmNextState;
-        AC_SEARCH;
+
+        if ( pf )
+        {
+            AC_SEARCH_PREFILTER;
+        }
+        else
+        {
+            AC_SEARCH;
+        }
     }
     break;
     default:
     {
         acstate_t* ps;
         acstate_t** NextState = acsm->acsmNextState;
-        AC_SEARCH;
+
+        if ( pf )
+        {
+            AC_SEARCH_PREFILTER;
+        }
+        else
+        {
+            AC_SEARCH;
+        }
     }
     break;
     }
@@ -1796,6 +1891,112 @@ int acsm_search_dfa_full_all(
     return nfound;
 }
 
+/*
+*   Full format DFA search of several buffers at once
+*
+*   Up to ACSM_BATCH_LANES buffers are walked in lockstep, one byte from
+*   each in turn, so the state table loads of independent buffers overlap
+*   instead of each miss stalling a single walk.  Each buffer keeps its own
+*   state and a match callback > 0 stops only that buffer, so the results
+*   are the same as searching the buffers one at a time.
+*/
+#define ACSM_BATCH_LANES 4
+
+template <typename T>
+static int search_dfa_full_batch(
+    ACSM_STRUCT2* acsm, T** NextState, MpseBatchItem* items, unsigned n, MpseMatch match)
+{
+    ACSM_PATTERN2** MatchList = acsm->acsmMatchList;
+    const AcPrefilter* pf = acsm->prefilter;
+    int nfound = 0;
+
+    for ( unsigned base = 0; base < n; base += ACSM_BATCH_LANES )
+    {
+        MpseBatchItem* lane = items + base;
+        unsigned lanes = n - base < ACSM_BATCH_LANES ? n - base : ACSM_BATCH_LANES;
+
+        const uint8_t* t[ACSM_BATCH_LANES];
+        const uint8_t* tend[ACSM_BATCH_LANES];
+        acstate_t state[ACSM_BATCH_LANES];
+        bool live[ACSM_BATCH_LANES];
+        unsigned active = lanes;
+
+        for ( unsigned i = 0; i < lanes; ++i )
+        {
+            t[i] = lane[i].buf;
+            tend[i] = lane[i].buf + lane[i].len;
+            state[i] = lane[i].state;
+            live[i] = true;
+        }
+
+        while ( active )
+        {
+            for ( unsigned i = 0; i < lanes; ++i )
+            {
+                if ( !live[i] )
+                    continue;
+
+                if ( pf and !state[i] and t[i] < tend[i] )
+                    t[i] = pf->skip(t[i], tend[i]);
+
+                ACSM_PATTERN2* mlist;
+
+                if ( t[i] == tend[i] )
+                {
+                    // check the last state for a pattern match
+                    mlist = MatchList[state[i]];
+
+                    if ( mlist )
+                    {
+                        nfound++;
+                        match(mlist->udata, mlist->rule_option_tree, t[i] - lane[i].buf,
+                            lane[i].context, mlist->neg_list);
+                    }
+                    lane[i].state = state[i];
+                    live[i] = false;
+                    --active;
+                    continue;
+                }
+
+                T* ps = NextState[state[i]];
+
+                if ( ps[1] and (mlist = MatchList[state[i]]) )
+                {
+                    nfound++;
+
+                    if ( match(mlist->udata, mlist->rule_option_tree, t[i] - lane[i].buf,
+                        lane[i].context, mlist->neg_list) > 0 )
+                    {
+                        lane[i].state = state[i];
+                        live[i] = false;
+                        --active;
+                        continue;
+                    }
+                }
+                state[i] = ps[2u + xlatcase[*t[i]]];
+                t[i]++;
+            }
+        }
+    }
+    return nfound;
+}
+
+int acsm_search_dfa_full_batch(
+    ACSM_STRUCT2* acsm, MpseBatchItem* items, unsigned n, MpseMatch match)
+{
+    switch (acsm->sizeofstate)
+    {
+    case 1:
+        return search_dfa_full_batch(acsm, (uint8_t**)acsm->acsmNextState, items, n, match);
+
+    case 2:
+        return search_dfa_full_batch(acsm, (uint16_t**)acsm->acsmNextState, items, n, match);
+
+    default:
+        return search_dfa_full_batch(acsm, acsm->acsmNextState, items, n, match);
+    }
+}
+
 /*
 *   Banded-Row format DFA search
 *   Do not change anything here, caching and prefetching
@@ -1977,6 +2178,8 @@ void acsmFree2(ACSM_STRUCT2* acsm)
         plist = tmpPlist;
     }
 
+    delete acsm->prefilter;
+
     AC_FREE_DFA(acsm->acsmNextState, 0, 0);
     AC_FREE(acsm->acsmFailState, 0, ACSM2_MEMORY_TYPE__NONE);
     AC_FREE(acsm->acsmMatchList, 0, ACSM2_MEMORY_TYPE__NONE);
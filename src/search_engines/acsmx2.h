@@ -33,6 +33,9 @@
 
 #define MAX_ALPHABET_SIZE 256
 
+class AcPrefilter;
+struct MpseBatchItem;
+
 /*
    FAIL STATE for 1,2,or 4 bytes for state transitions
    Uncomment this define to use 32 bit state values
@@ -110,6 +113,9 @@ struct ACSM_STRUCT2
     acstate_t** acsmNextState;
     const MpseAgent* agent;
 
+    /* skips bytes that can't start a match while the full DFA is in state 0 */
+    AcPrefilter* prefilter;
+
     int acsmMaxStates;
     int acsmNumStates;
 
@@ -161,6 +167,8 @@ int acsm_search_dfa_full(
 int acsm_search_dfa_full_all(
     ACSM_STRUCT2*, const uint8_t* Tx, int n, MpseMatch, void* context, int* current_state);
 
+int acsm_search_dfa_full_batch(ACSM_STRUCT2*, MpseBatchItem*, unsigned n, MpseMatch);
+
 void acsmFree2(ACSM_STRUCT2*);
 int acsmPatternCount2(ACSM_STRUCT2*);
 void acsmCompressStates(ACSM_STRUCT2*, int);
@@ -55,6 +55,26 @@
 **
 **   * if a state is empty it has words 1 and 2, but no transition words.
 **
+**  ** Compact array storage **
+**
+**  Machines with less than 64K states that fit in 128K 16 bit words use a
+**  smaller format instead.  Input bytes are first mapped to byte classes;
+**  bytes that make the same transitions in every state share a class so a
+**  full row has one entry per class rather than 256.  States are laid out
+**  in breadth first order so the states near the root, which are visited
+**  most, are packed together.  Each state starts on a 2 word (4 byte)
+**  boundary and is identified by its offset / 2 which fits in 16 bits.
+**
+**   word 1 : control word = mb | fb | nt
+**   mb : 0x8000 - state has matching patterns
+**   fb : 0x4000 - full row of transitions, one per byte class
+**   nt : 0-8 number of sparse transitions
+**   word 2 : failure state index
+**   sparse : (nt+1)/2 words of byte class keys, 1 per byte,
+**            then nt words of next state index
+**   full   : one next state index per byte class, 0 is no transition
+**   last   : state number for MatchList (match states only)
+**
 **   Construction:
 **
 **   Patterns are added to a list based trie.
@@ -152,6 +172,10 @@
 #include <ctype.h>
 
 #include <list>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include "search_common.h"
 #include "main/snort_types.h"
@@ -1052,6 +1076,193 @@ static int _bnfa_conv_list_to_csparse_array(bnfa_struct_t* bnfa)
     return 0;
 }
 
+/*
+*   Convert the list based NFA to the compact format.  Returns nonzero
+*   if the machine doesn't fit so the sparse format can be used instead.
+*/
+static int _bnfa_conv_list_to_compact(bnfa_struct_t* bnfa)
+{
+    int nstates = bnfa->bnfaNumStates;
+    bnfa_state_t* FailState = bnfa->bnfaFailState;
+    bnfa_state_t full[BNFA_MAX_ALPHABET_SIZE];
+
+    if ( nstates > BNFA_COMPACT_MAX_STATE )
+        return -1;
+
+    /* bytes with the same transitions in every state are one class */
+    std::vector<std::vector<std::pair<int, bnfa_state_t> > > cols(BNFA_MAX_ALPHABET_SIZE);
+
+    for ( int k = 0; k < nstates; k++ )
+    {
+        _bnfa_list_conv_row_to_full(bnfa, (bnfa_state_t)k, full);
+
+        for ( int i = 0; i < bnfa->bnfaAlphabetSize; i++ )
+        {
+            if ( full[i] & BNFA_SPARSE_MAX_STATE )
+                cols[i].push_back(std::make_pair(k, full[i] & BNFA_SPARSE_MAX_STATE));
+        }
+    }
+
+    std::map<std::vector<std::pair<int, bnfa_state_t> >, int> classes;
+    uint8_t xclass[BNFA_MAX_ALPHABET_SIZE];
+    int nclasses = 0;
+
+    /* class 0 is reserved for bytes without transitions */
+    classes[std::vector<std::pair<int, bnfa_state_t> >()] = nclasses++;
+
+    for ( int i = 0; i < BNFA_MAX_ALPHABET_SIZE; i++ )
+    {
+        auto it = classes.find(cols[i]);
+
+        if ( it == classes.end() )
+        {
+            if ( nclasses > UINT8_MAX )
+                return -1;
+
+            it = classes.insert(std::make_pair(cols[i], nclasses++)).first;
+        }
+        xclass[i] = (uint8_t)it->second;
+    }
+
+    /* order states breadth first and size the records */
+    std::vector<int> order;
+    std::vector<unsigned> index(nstates, 0);
+    std::vector<unsigned> words(nstates, 0);
+    std::vector<uint8_t> visited(nstates, 0);
+
+    order.reserve(nstates);
+    order.push_back(0);
+    visited[0] = 1;
+
+    unsigned units = 0;
+
+    for ( unsigned q = 0; q < order.size(); q++ )
+    {
+        int k = order[q];
+        int nc = 0;
+
+        _bnfa_list_conv_row_to_full(bnfa, (bnfa_state_t)k, full);
+
+        uint8_t seen[BNFA_MAX_ALPHABET_SIZE] = { 0 };
+
+        for ( int i = 0; i < bnfa->bnfaAlphabetSize; i++ )
+        {
+            bnfa_state_t next = full[i] & BNFA_SPARSE_MAX_STATE;
+
+            if ( !next or seen[xclass[i]] )
+                continue;
+
+            seen[xclass[i]] = 1;
+            nc++;
+
+            if ( !visited[next] )
+            {
+                visited[next] = 1;
+                order.push_back(next);
+            }
+        }
+
+        unsigned w = 2;
+
+        if ( bnfa->bnfaMatchList[k] )
+            w++;
+
+        if ( k == 0 or nc > BNFA_COMPACT_MAX_SPARSE )
+            w += nclasses;
+        else
+            w += (nc + 1) / 2 + nc;
+
+        words[k] = w;
+        index[k] = units;
+        units += (w + BNFA_COMPACT_ALIGN - 1) / BNFA_COMPACT_ALIGN;
+
+        if ( units > BNFA_COMPACT_MAX_INDEX + 1 )
+            return -1;
+    }
+
+    if ( (int)order.size() != nstates )
+        return -1;
+
+    unsigned nwords = units * BNFA_COMPACT_ALIGN;
+    uint16_t* ps = (uint16_t*)BNFA_MALLOC(nwords * sizeof(uint16_t), bnfa->nextstate_memory);
+
+    if ( !ps )
+        return -1;
+
+    for ( int k : order )
+    {
+        uint16_t* pw = ps + index[k] * BNFA_COMPACT_ALIGN;
+        uint16_t cw = 0;
+        int nc = 0;
+
+        _bnfa_list_conv_row_to_full(bnfa, (bnfa_state_t)k, full);
+
+        uint16_t next[BNFA_MAX_ALPHABET_SIZE] = { 0 };
+
+        for ( int i = 0; i < bnfa->bnfaAlphabetSize; i++ )
+        {
+            bnfa_state_t s = full[i] & BNFA_SPARSE_MAX_STATE;
+
+            if ( s and !next[xclass[i]] )
+            {
+                next[xclass[i]] = (uint16_t)index[s];
+                nc++;
+            }
+        }
+
+        bool full_row = (k == 0 or nc > BNFA_COMPACT_MAX_SPARSE);
+
+        if ( full_row )
+            cw |= BNFA_COMPACT_FULL_BIT;
+        else
+            cw |= nc;
+
+        if ( bnfa->bnfaMatchList[k] )
+            cw |= BNFA_COMPACT_MATCH_BIT;
+
+        *pw++ = cw;
+        *pw++ = (uint16_t)(k ? index[FailState[k]] : 0);
+
+        if ( full_row )
+        {
+            memcpy(pw, next, nclasses * sizeof(uint16_t));
+            pw += nclasses;
+        }
+        else
+        {
+            uint8_t* keys = (uint8_t*)pw;
+            uint16_t* pn = pw + (nc + 1) / 2;
+
+            for ( int c = 1, m = 0; c < nclasses and m < nc; c++ )
+            {
+                if ( next[c] )
+                {
+                    keys[m] = (uint8_t)c;
+                    pn[m++] = next[c];
+                }
+            }
+            pw = pn + nc;
+        }
+
+        /* kept out of the way of the transitions */
+        if ( bnfa->bnfaMatchList[k] )
+            *pw = (uint16_t)k;
+    }
+
+    /* map raw input bytes the same way patterns were added */
+    for ( int i = 0; i < BNFA_MAX_ALPHABET_SIZE; i++ )
+    {
+        int c = (bnfa->bnfaCaseMode == BNFA_CASE) ? i : xlatcase[i];
+        bnfa->bnfaByteClass[i] = xclass[c];
+    }
+
+    bnfa->bnfaCompactList = ps;
+    bnfa->bnfaCompactWords = nwords;
+    bnfa->bnfaNumClasses = nclasses;
+
+    return 0;
+}
+
 /*
 *  Print the state machine - rather verbose
 */
@@ -1071,6 +1282,13 @@ void bnfaPrint(bnfa_struct_t* bnfa)
     if ( !bnfa->bnfaNumStates )
         return;
 
+    if ( bnfa->bnfaCompactList )
+    {
+        printf("Print NFA-COMPACT state machine : %d active states, %d byte classes, "
+            "%u words\n", bnfa->bnfaNumStates, bnfa->bnfaNumClasses, bnfa->bnfaCompactWords);
+        return;
+    }
+
     if ( bnfa->bnfaFormat ==BNFA_SPARSE )
     {
         printf("Print NFA-SPARSE state machine : %d active states\n", bnfa->bnfaNumStates);
@@ -1285,10 +1503,20 @@ void bnfaFree(bnfa_struct_t* bnfa)
     BNFA_FREE(bnfa->bnfaFailState,bnfa->bnfaNumStates*sizeof(bnfa_state_t),bnfa->failstate_memory);
     BNFA_FREE(bnfa->bnfaMatchList,bnfa->bnfaNumStates*sizeof(bnfa_pattern_t*),
         bnfa->matchlist_memory);
-    BNFA_FREE(bnfa->bnfaNextState,bnfa->bnfaNumStates*sizeof(bnfa_state_t*),
-        bnfa->nextstate_memory);
-    BNFA_FREE(bnfa->bnfaTransList,(2*bnfa->bnfaNumStates+bnfa->bnfaNumTrans)*sizeof(bnfa_state_t*),
-        bnfa->nextstate_memory);
+
+    /* the last instance sharing the tables frees them */
+    if ( !bnfa->bnfaTableRefs or !--*bnfa->bnfaTableRefs )
+    {
+        if ( bnfa->bnfaTableRefs )
+            snort_free(bnfa->bnfaTableRefs);
+
+        BNFA_FREE(bnfa->bnfaNextState,bnfa->bnfaNumStates*sizeof(bnfa_state_t*),
+            bnfa->nextstate_memory);
+        BNFA_FREE(bnfa->bnfaTransList,(2*bnfa->bnfaNumStates+bnfa->bnfaNumTrans)*sizeof(bnfa_state_t*),
+            bnfa->nextstate_memory);
+        BNFA_FREE(bnfa->bnfaCompactList,bnfa->bnfaCompactWords*sizeof(uint16_t),
+            bnfa->nextstate_memory);
+    }
     snort_free(bnfa);   /* cannot update memory tracker when deleting bnfa so just 'free' it !*/
 }
 
@@ -1421,7 +1649,9 @@ static inline int _bnfaCompile(bnfa_struct_t* bnfa)
     /* Convert nfa storage format from list to full or sparse */
     if ( bnfa->bnfaFormat == BNFA_SPARSE )
     {
-        if ( _bnfa_conv_list_to_csparse_array(bnfa)  )
+        /* use the compact format if it fits */
+        if ( (bnfa->bnfaForceSparse or _bnfa_conv_list_to_compact(bnfa)) and
+            _bnfa_conv_list_to_csparse_array(bnfa) )
         {
             return -1;
         }
@@ -1473,6 +1703,94 @@ int bnfaCompile(
     return 0;
 }
 
+/*
+*   Share the transition tables of prev, an instance compiled from the same
+*   patterns in the same order, eg in the configuration replaced by a
+*   reload.  The tables are read only once compiled so prev may still be
+*   searched.  Only the match lists, which point to the patterns and rule
+*   trees of this instance, are built here.  Called from the main thread.
+*/
+int bnfaReuse(SnortConfig* sc, bnfa_struct_t* bnfa, bnfa_struct_t* prev)
+{
+    if ( bnfa->bnfaMatchList or !prev->bnfaMatchList )
+        return -1;
+
+    if ( bnfa->bnfaFormat != BNFA_SPARSE or prev->bnfaFormat != BNFA_SPARSE or
+        bnfa->bnfaCaseMode != prev->bnfaCaseMode or
+        bnfa->bnfaOpt != prev->bnfaOpt or
+        bnfa->bnfaAlphabetSize != prev->bnfaAlphabetSize or
+        bnfa->bnfaForceFullZeroState != prev->bnfaForceFullZeroState or
+        bnfa->bnfaForceSparse != prev->bnfaForceSparse or
+        bnfa->bnfaPatternCnt != prev->bnfaPatternCnt )
+        return -1;
+
+    std::unordered_map<const void*, bnfa_pattern_t*> xpat;
+    bnfa_pattern_t* p = bnfa->bnfaPatterns;
+    bnfa_pattern_t* q = prev->bnfaPatterns;
+
+    for ( ; p and q; p = p->next, q = q->next )
+    {
+        if ( p->n != q->n or p->nocase != q->nocase or p->negative != q->negative or
+            memcmp(p->casepatrn, q->casepatrn, p->n) )
+            return -1;
+
+        xpat[q] = p;
+    }
+
+    if ( p or q )
+        return -1;
+
+    bnfa->bnfaMatchList = (bnfa_match_node_t**)BNFA_MALLOC(
+        sizeof(void*) * prev->bnfaNumStates, bnfa->matchlist_memory);
+
+    if ( !bnfa->bnfaMatchList )
+        return -1;
+
+    /* same states with the same patterns in the same order */
+    for ( int i = 0; i < prev->bnfaNumStates; i++ )
+    {
+        bnfa_match_node_t** tail = bnfa->bnfaMatchList + i;
+
+        for ( bnfa_match_node_t* mn = prev->bnfaMatchList[i]; mn; mn = mn->next )
+        {
+            bnfa_match_node_t* pmn = (bnfa_match_node_t*)BNFA_MALLOC(
+                sizeof(bnfa_match_node_t), bnfa->matchlist_memory);
+
+            if ( !pmn )
+                return -1;
+
+            pmn->data = xpat[mn->data];
+            *tail = pmn;
+            tail = &pmn->next;
+        }
+    }
+
+    if ( !prev->bnfaTableRefs )
+    {
+        prev->bnfaTableRefs = (unsigned*)snort_calloc(sizeof(unsigned));
+        *prev->bnfaTableRefs = 1;
+    }
+    bnfa->bnfaTableRefs = prev->bnfaTableRefs;
+    ++*bnfa->bnfaTableRefs;
+
+    bnfa->bnfaMaxStates = prev->bnfaMaxStates;
+    bnfa->bnfaNumStates = prev->bnfaNumStates;
+    bnfa->bnfaNumTrans = prev->bnfaNumTrans;
+    bnfa->bnfaMatchStates = prev->bnfaMatchStates;
+    bnfa->bnfaTransList = prev->bnfaTransList;
+    bnfa->bnfaCompactList = prev->bnfaCompactList;
+    bnfa->bnfaCompactWords = prev->bnfaCompactWords;
+    bnfa->bnfaNumClasses = prev->bnfaNumClasses;
+    memcpy(bnfa->bnfaByteClass, prev->bnfaByteClass, sizeof(bnfa->bnfaByteClass));
+
+    bnfaAccumInfo(bnfa);
+
+    if ( bnfa->agent )
+        bnfaBuildMatchStateTrees(sc, bnfa);
+
+    return 0;
+}
+
 #ifdef ALLOW_NFA_FULL
 
 /*
@@ -1908,6 +2226,113 @@ unsigned _bnfa_search_csparse_nfa(
     return nfound;
 }
 
+/*
+*   Compact format next state, see the format description at the top
+*/
+static inline unsigned _bnfa_get_next_state_compact_nfa(
+    const uint16_t* pcx, unsigned sindex, unsigned input)
+{
+    for (;; )
+    {
+        const uint16_t* ps = pcx + sindex * BNFA_COMPACT_ALIGN;
+        unsigned cw = ps[0];
+        const uint16_t* pt = ps + 2;
+
+        if ( cw & BNFA_COMPACT_FULL_BIT )
+        {
+            unsigned next = pt[input];
+
+            if ( next or !sindex )
+                return next;
+        }
+        else
+        {
+            unsigned nc = cw & BNFA_COMPACT_COUNT_BITS;
+            const uint8_t* keys = (const uint8_t*)pt;
+            const uint16_t* next = pt + ((nc + 1) >> 1);
+
+            for ( unsigned k = 0; k < nc; k++ )
+            {
+                if ( keys[k] == input )
+                    return next[k];
+            }
+        }
+
+        /* no transition found ... get the failure state and try again  */
+        sindex = ps[1];
+    }
+}
+
+/*
+ *  Same as _bnfa_search_csparse_nfa() for the compact format
+ */
+unsigned _bnfa_search_compact_nfa(
+    bnfa_struct_t* bnfa, const uint8_t* Tx, int n, MpseMatch match,
+    void* context, unsigned sindex, int* current_state)
+{
+    bnfa_match_node_t* mlist;
+    const uint8_t* Tend;
+    const uint8_t* T;
+    unsigned index;
+    bnfa_match_node_t** MatchList = bnfa->bnfaMatchList;
+    bnfa_pattern_t* patrn;
+    const uint16_t* pcx = bnfa->bnfaCompactList;
+    const uint8_t* xclass = bnfa->bnfaByteClass;
+    unsigned nclasses = bnfa->bnfaNumClasses;
+    unsigned nfound = 0;
+    unsigned last_match=LAST_STATE_INIT;
+    unsigned last_match_saved=LAST_STATE_INIT;
+    int res;
+
+    T    = Tx;
+    Tend = T + n;
+
+    for (; T<Tend; T++)
+    {
+        /* Transition to next state index */
+        sindex = _bnfa_get_next_state_compact_nfa(pcx, sindex, xclass[*T]);
+
+        const uint16_t* ps = pcx + sindex * BNFA_COMPACT_ALIGN;
+
+        /* Log matches in this state - if any */
+        if ( sindex && (ps[0] & BNFA_COMPACT_MATCH_BIT) )
+        {
+            if ( sindex == last_match )
+                continue;
+
+            last_match_saved = last_match;
+            last_match = sindex;
+
+            unsigned cw = ps[0];
+            unsigned nc = cw & BNFA_COMPACT_COUNT_BITS;
+            unsigned nt = (cw & BNFA_COMPACT_FULL_BIT) ? nclasses : ((nc + 1) >> 1) + nc;
+
+            mlist = MatchList[ ps[2 + nt] ];
+            if ( !mlist )
+                return nfound;
+
+            patrn = (bnfa_pattern_t*)mlist->data;
+            index = T - Tx + 1;
+            nfound++;
+
+            res = match(patrn->userdata, mlist->rule_option_tree, index,
+                context, mlist->neg_list);
+
+            if ( res > 0 )
+            {
+                *current_state = sindex;
+                return nfound;
+            }
+            else if ( res < 0 )
+            {
+                last_match = last_match_saved;
+            }
+        }
+    }
+    *current_state = sindex;
+    return nfound;
+}
+
 #ifdef BNFA_MAIN
 /*
  * Case specific search, global to all patterns
@@ -2051,8 +2476,10 @@ int bnfaPatternCount(bnfa_struct_t* p)
 /*
  *  Summary Info Data
  */
+// instances may be compiled on several threads at once
 static bnfa_struct_t summary;
 static int summary_cnt = 0;
+static std::mutex summary_mutex;
 
 static void bnfaPrintInfoEx(bnfa_struct_t* p)
 {
@@ -2108,6 +2535,7 @@ void bnfaInitSummary()
 void bnfaAccumInfo(bnfa_struct_t* p)
 {
     bnfa_struct_t* px = &summary;
+    std::lock_guard<std::mutex> lock(summary_mutex);
 
     summary_cnt++;
 
@@ -60,6 +60,18 @@
 #define BNFA_SPARSE_COUNT_BITS          0x3f000000
 #define BNFA_SPARSE_MAX_ROW_TRANSITIONS 0x3f
 
+/*
+*   Compact format - 16 bit words, used when the machine fits
+*/
+#define BNFA_COMPACT_MAX_STATE          0xffff
+#define BNFA_COMPACT_MAX_INDEX          0xffff
+#define BNFA_COMPACT_ALIGN              2      /* words per state index unit */
+#define BNFA_COMPACT_MAX_SPARSE         8      /* more transitions use a full row */
+
+#define BNFA_COMPACT_MATCH_BIT          0x8000
+#define BNFA_COMPACT_FULL_BIT           0x4000
+#define BNFA_COMPACT_COUNT_BITS         0x00ff
+
 typedef  unsigned int bnfa_state_t;
 
 /*
@@ -138,9 +150,19 @@ struct bnfa_struct_t
     bnfa_state_t* bnfaFailState;
     bnfa_state_t* bnfaTransList;
 
+    /* compact format, used instead of bnfaTransList when not null */
+    uint16_t* bnfaCompactList;
+    unsigned bnfaCompactWords;
+    int bnfaNumClasses;
+    uint8_t bnfaByteClass[BNFA_MAX_ALPHABET_SIZE];
+
+    /* not null if the transition tables are shared by bnfaReuse */
+    unsigned* bnfaTableRefs;
+
     const MpseAgent* agent;
 
     int bnfaForceFullZeroState;
+    int bnfaForceSparse;    /* don't use the compact format even if it fits */
 
     int bnfa_memory;
     int pat_memory;
@@ -167,11 +189,16 @@ int bnfaAddPattern(
     bool nocase, bool negative, void* userdata);
 
 int bnfaCompile(struct SnortConfig*, bnfa_struct_t*);
+int bnfaReuse(struct SnortConfig*, bnfa_struct_t*, bnfa_struct_t* prev);
 
 unsigned _bnfa_search_csparse_nfa(
     bnfa_struct_t * pstruct, const uint8_t* t, int tlen, MpseMatch,
     void* context, unsigned sindex, int* current_state);
 
+unsigned _bnfa_search_compact_nfa(
+    bnfa_struct_t * pstruct, const uint8_t* t, int tlen, MpseMatch,
+    void* context, unsigned sindex, int* current_state);
+
 int bnfaPatternCount(bnfa_struct_t* p);
 
 void bnfaPrint(bnfa_struct_t* pstruct);   /* prints the nfa states-verbose!! */
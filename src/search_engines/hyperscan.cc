@@ -22,8 +22,12 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -92,6 +96,9 @@ typedef std::vector<Pattern> PatternVector;
 
 static hs_scratch_t* s_scratch = nullptr;
 
+// instances may be prepped on several threads at once
+static std::mutex s_scratch_mutex;
+
 //-------------------------------------------------------------------------
 // mpse
 //-------------------------------------------------------------------------
@@ -108,9 +115,6 @@ public:
 
     ~HyperscanMpse()
     {
-        if ( hs_db )
-            hs_free_database(hs_db);
-
         user_dtor();
     }
 
@@ -126,7 +130,13 @@ public:
 
     int prep_patterns(SnortConfig*) override;
 
+    bool concurrent_prep() override
+    { return true; }
+
+    bool reuse(SnortConfig*, Mpse*) override;
+
     int _search(const uint8_t*, int, MpseMatch, void*, int*) override;
+    int _search_batch(MpseBatchItem*, unsigned n, MpseMatch) override;
 
     int get_pattern_count() override
     { return pvector.size(); }
@@ -141,10 +151,20 @@ private:
     void user_ctor(SnortConfig*);
     void user_dtor();
 
+    int prep_scratch(SnortConfig*);
+
+    std::string get_cache_key();
+    bool load_db(SnortConfig*, const std::string& key);
+    void save_db(SnortConfig*, const std::string& key);
+    void set_db(hs_database_t*);
+
     const MpseAgent* agent;
     PatternVector pvector;
 
+    // the database is read only once compiled and may be shared with
+    // instances in a reloaded configuration
     hs_database_t* hs_db = nullptr;
+    std::shared_ptr<hs_database_t> db_ref;
 
     MpseMatch match_cb = nullptr;
     void* match_ctx = nullptr;
@@ -152,10 +172,14 @@ private:
 public:
     static uint64_t instances;
     static uint64_t patterns;
+    static std::atomic<uint64_t> cache_hits;
+    static std::atomic<uint64_t> cache_misses;
 };
 
 uint64_t HyperscanMpse::instances = 0;
 uint64_t HyperscanMpse::patterns = 0;
+std::atomic<uint64_t> HyperscanMpse::cache_hits(0);
+std::atomic<uint64_t> HyperscanMpse::cache_misses(0);
 
 // other mpse have direct access to their fsm match states and populate
 // user list and tree with each pattern that leads to the same match state.
@@ -193,8 +217,74 @@ void HyperscanMpse::user_dtor()
     }
 }
 
+// the database depends only on the library, the mode, and the patterns
+// with their flags in id order
+std::string HyperscanMpse::get_cache_key()
+{
+    std::string key = hs_version();
+    key += "|block|";
+
+    for ( auto& p : pvector )
+    {
+        key += p.no_case ? 'i' : 'c';
+        key += p.pat;
+        key += '\0';
+    }
+    return key;
+}
+
+void HyperscanMpse::set_db(hs_database_t* db)
+{
+    hs_db = db;
+    db_ref.reset(db, hs_free_database);
+}
+
+bool HyperscanMpse::load_db(SnortConfig* sc, const std::string& key)
+{
+    size_t len;
+    const uint8_t* db = cache_map(sc, key, len);
+
+    if ( !db )
+        return false;
+
+    hs_database_t* pdb = nullptr;
+
+    // fails if the database was built for an incompatible platform
+    if ( hs_deserialize_database((const char*)db, len, &pdb) == HS_SUCCESS and pdb )
+        set_db(pdb);
+
+    cache_unmap(db);
+    return hs_db != nullptr;
+}
+
+void HyperscanMpse::save_db(SnortConfig* sc, const std::string& key)
+{
+    char* db = nullptr;
+    size_t len = 0;
+
+    if ( hs_serialize_database(hs_db, &db, &len) != HS_SUCCESS )
+        return;
+
+    cache_save(sc, key, (uint8_t*)db, len);
+    free(db);
+}
+
 int HyperscanMpse::prep_patterns(SnortConfig* sc)
 {
+    std::string key;
+
+    if ( cache_enabled(sc) )
+    {
+        key = get_cache_key();
+
+        if ( load_db(sc, key) )
+        {
+            ++cache_hits;
+            return prep_scratch(sc);
+        }
+        ++cache_misses;
+    }
+
     hs_compile_error_t* errptr = nullptr;
     std::vector<const char*> pats;
     std::vector<unsigned> flags;
@@ -209,16 +299,55 @@ int HyperscanMpse::prep_patterns(SnortConfig* sc)
         ids.push_back(id++);
     }
 
+    hs_database_t* pdb = nullptr;
+
     if ( hs_compile_multi(&pats[0], &flags[0], &ids[0], pvector.size(), HS_MODE_BLOCK,
-            nullptr, &hs_db, &errptr) or !hs_db )
+            nullptr, &pdb, &errptr) or !pdb )
     {
         // FIXIT-L emit data from errptr
         ParseError("can't compile pattern database '%s'", "hs_compile_multi");
         hs_free_compile_error(errptr);
         return -1;
     }
+    set_db(pdb);
+
+    if ( !key.empty() )
+        save_db(sc, key);
+
+    return prep_scratch(sc);
+}
+
+// the database depends only on the cache key (but user data does not)
+bool HyperscanMpse::reuse(SnortConfig* sc, Mpse* p)
+{
+    HyperscanMpse* prev = (HyperscanMpse*)p;
+
+    if ( !prev->hs_db or prev->pvector.size() != pvector.size() )
+        return false;
 
-    if ( hs_error_t err = hs_alloc_scratch(hs_db, &s_scratch) )
+    std::string key = get_cache_key();
+
+    if ( prev->get_cache_key() != key )
+        return false;
+
+    hs_db = prev->hs_db;
+    db_ref = prev->db_ref;
+
+    // keep the cache file for the next start
+    cache_keep(sc, key);
+
+    return !prep_scratch(sc);
+}
+
+int HyperscanMpse::prep_scratch(SnortConfig* sc)
+{
+    hs_error_t err;
+    {
+        std::lock_guard<std::mutex> lock(s_scratch_mutex);
+        err = hs_alloc_scratch(hs_db, &s_scratch);
+    }
+
+    if ( err )
     {
         ParseError("can't allocate search scratch space (%d)", err);
         return -2;
@@ -262,6 +391,29 @@ int HyperscanMpse::_search(
     return 0;
 }
 
+// hyperscan scans one block per call so the batch is a loop but the
+// thread's scratch is looked up once and kept hot across the buffers
+int HyperscanMpse::_search_batch(MpseBatchItem* items, unsigned n, MpseMatch mf)
+{
+    match_cb = mf;
+
+    SnortState* ss = snort_conf->state + get_instance_id();
+    hs_scratch_t* scratch = (hs_scratch_t*)ss->hyperscan_scratch;
+
+    // scratch is null for the degenerate case w/o patterns
+    assert(!hs_db or scratch);
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        items[i].state = 0;
+        match_ctx = items[i].context;
+
+        hs_scan(hs_db, (const char*)items[i].buf, items[i].len, 0, scratch,
+            HyperscanMpse::match, this);
+    }
+    return 0;
+}
+
 //-------------------------------------------------------------------------
 // public methods
 //-------------------------------------------------------------------------
@@ -317,12 +469,16 @@ static void hs_init()
 {
     HyperscanMpse::instances = 0;
     HyperscanMpse::patterns = 0;
+    HyperscanMpse::cache_hits = 0;
+    HyperscanMpse::cache_misses = 0;
 }
 
 static void hs_print()
 {
     LogCount("instances", HyperscanMpse::instances);
     LogCount("patterns", HyperscanMpse::patterns);
+    LogCount("cache hits", HyperscanMpse::cache_hits.load());
+    LogCount("cache misses", HyperscanMpse::cache_misses.load());
 }
 
 static const MpseApi hs_api =
@@ -0,0 +1,209 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// bnfa_test.cc
+// the compact format must find exactly what the sparse format finds
+
+#include "search_engines/bnfa_search.h"
+
+#include <string.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "main/snort_config.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+//-------------------------------------------------------------------------
+// stubs
+//-------------------------------------------------------------------------
+
+SnortConfig s_conf;
+THREAD_LOCAL SnortConfig* snort_conf = &s_conf;
+
+SnortConfig::SnortConfig() { }
+
+SnortConfig::~SnortConfig() { }
+
+FileIdentifier::~FileIdentifier() { }
+
+FileVerdict FilePolicy::type_lookup(Flow*, FileContext*)
+{ return FILE_VERDICT_UNKNOWN; }
+
+FileVerdict FilePolicy::type_lookup(Flow*, FileInfo*)
+{ return FILE_VERDICT_UNKNOWN; }
+
+FileVerdict FilePolicy::signature_lookup(Flow*, FileContext*)
+{ return FILE_VERDICT_UNKNOWN; }
+
+FileVerdict FilePolicy::signature_lookup(Flow*, FileInfo*)
+{ return FILE_VERDICT_UNKNOWN; }
+
+void LogValue(const char*, const char*, FILE*)
+{ }
+
+void LogMessage(const char*, ...)
+{ }
+
+void LogCount(char const*, uint64_t, FILE*)
+{ }
+
+void LogStat(const char*, double, FILE*)
+{ }
+
+static MpseAgent s_agent =
+{
+    [](struct SnortConfig*, void*, void** ppt)
+    {
+        *ppt = nullptr;
+        return 0;
+    },
+    [](void*, void** ppl)
+    {
+        *ppl = nullptr;
+        return 0;
+    },
+
+    [](void*) { },
+    [](void**) { },
+    [](void**) { }
+};
+
+//-------------------------------------------------------------------------
+// helpers
+//-------------------------------------------------------------------------
+
+typedef std::vector<std::pair<long, int>> Hits;
+
+static int record(void* user, void*, int index, void* context, void*)
+{
+    ((Hits*)context)->push_back(std::make_pair((long)user, index));
+    return 0;
+}
+
+struct Pat
+{
+    const char* s;
+    bool nocase;
+};
+
+static bnfa_struct_t* build(const std::vector<Pat>& pats, bool sparse)
+{
+    bnfa_struct_t* bnfa = bnfaNew(&s_agent);
+    bnfa->bnfaMethod = 1;
+    bnfa->bnfaForceSparse = sparse;
+
+    long id = 0;
+
+    for ( auto& p : pats )
+        bnfaAddPattern(bnfa, (const uint8_t*)p.s, strlen(p.s), p.nocase, false, (void*)++id);
+
+    CHECK(bnfaCompile(nullptr, bnfa) == 0);
+    return bnfa;
+}
+
+static Hits search(bnfa_struct_t* bnfa, const std::string& s)
+{
+    Hits hits;
+    int state = 0;
+
+    if ( bnfa->bnfaCompactList )
+        _bnfa_search_compact_nfa(
+            bnfa, (const uint8_t*)s.data(), s.size(), record, &hits, 0, &state);
+    else
+        _bnfa_search_csparse_nfa(
+            bnfa, (const uint8_t*)s.data(), s.size(), record, &hits, 0, &state);
+
+    return hits;
+}
+
+// deterministic text over a small alphabet so the patterns hit often
+static std::string make_text(unsigned len)
+{
+    const char* alpha = "abcdefoxrzFOBAX ";
+    unsigned n = strlen(alpha);
+    uint32_t seed = 12345;
+    std::string s;
+
+    while ( s.size() < len )
+    {
+        seed = seed * 1103515245 + 12345;
+        s += alpha[(seed >> 16) % n];
+    }
+    return s;
+}
+
+//-------------------------------------------------------------------------
+// tests
+//-------------------------------------------------------------------------
+
+TEST_GROUP(bnfa_compact)
+{
+    std::vector<Pat> pats;
+
+    void setup()
+    {
+        bnfa_init_xlatcase();
+
+        pats =
+        {
+            { "foo", true }, { "FOO", false }, { "oba", true }, { "bar", true },
+            { "barbaz", false }, { "a", true }, { "abc", true }, { "bcd", false },
+            { "cde", true }, { "xa", true }, { "xb", true }, { "xc", true },
+            { "xd", true }, { "xe", true }, { "xf", true }, { "xo", true },
+            { "xr", true }, { "xz", true }, { "xx", true }, { "Xab", false },
+            { "zz", true }, { "zzz", true }, { "rofl", true }, { "ofa", true },
+        };
+    }
+};
+
+TEST(bnfa_compact, same_hits)
+{
+    bnfa_struct_t* compact = build(pats, false);
+    bnfa_struct_t* sparse = build(pats, true);
+
+    CHECK(compact->bnfaCompactList != nullptr);
+    CHECK(sparse->bnfaCompactList == nullptr);
+
+    std::vector<std::string> texts =
+    {
+        "", "a", "foo", "FOO", "fOo", "barbaz", "BARBAZ", "xaxbxcxdxexfxoxrxzxx",
+        "zzzz", "Xab xab", "abcde", "rofl", make_text(4096),
+    };
+
+    for ( auto& t : texts )
+    {
+        Hits c = search(compact, t);
+        Hits s = search(sparse, t);
+        CHECK(c == s);
+    }
+
+    CHECK(!search(compact, texts.back()).empty());
+
+    bnfaFree(compact);
+    bnfaFree(sparse);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
@@ -50,6 +50,36 @@ int Mpse::search_all(
     return _search(T, n, match, context, current_state);
 }
 
+int Mpse::_search_batch(MpseBatchItem* items, unsigned n, MpseMatch match)
+{
+    int found = 0;
+
+    for ( unsigned i = 0; i < n; ++i )
+        found += _search(items[i].buf, items[i].len, match, items[i].context, &items[i].state);
+
+    return found;
+}
+
+int Mpse::search_batch(MpseBatchItem* items, unsigned n, MpseMatch match)
+{
+    return _search_batch(items, n, match);
+}
+
+bool Mpse::cache_enabled(SnortConfig*)
+{ return false; }
+
+const uint8_t* Mpse::cache_map(SnortConfig*, const std::string&, size_t&)
+{ return nullptr; }
+
+void Mpse::cache_unmap(const uint8_t*)
+{ }
+
+bool Mpse::cache_save(SnortConfig*, const std::string&, const uint8_t*, size_t)
+{ return false; }
+
+void Mpse::cache_keep(SnortConfig*, const std::string&)
+{ }
+
 uint64_t Mpse::get_pattern_byte_count()
 { return 0; }
 
@@ -254,6 +284,37 @@ TEST(mpse_hs_match, multi)
     CHECK(hits == 3);
 }
 
+static int count_hits(void*, void*, int, void* context, void*)
+{
+    ++*(unsigned*)context;
+    return 0;
+}
+
+TEST(mpse_hs_match, batch)
+{
+    Mpse::PatternDescriptor desc;
+
+    CHECK(hs->add_pattern(nullptr, (uint8_t*)"foo", 3, desc, s_user) == 0);
+    CHECK(hs->add_pattern(nullptr, (uint8_t*)"bar", 3, desc, s_user) == 0);
+
+    CHECK(hs->prep_patterns(snort_conf) == 0);
+    hyperscan_setup(snort_conf);
+
+    unsigned counts[3] = { };
+
+    MpseBatchItem items[3] =
+    {
+        { (uint8_t*)"foo bar", 7, counts, 0 },
+        { (uint8_t*)"baz", 3, counts + 1, 0 },
+        { (uint8_t*)"bar foo bar", 11, counts + 2, 0 },
+    };
+
+    CHECK(hs->search_batch(items, 3, count_hits) == 0);
+    CHECK(counts[0] == 2);
+    CHECK(counts[1] == 0);
+    CHECK(counts[2] == 3);
+}
+
 #if 0
 TEST(mpse_hs_match, regex)
 {
@@ -151,6 +151,21 @@ int Mpse::search_all(
     return _search(T, n, match, context, current_state);
 }
 
+int Mpse::_search_batch(MpseBatchItem* items, unsigned n, MpseMatch match)
+{
+    int found = 0;
+
+    for ( unsigned i = 0; i < n; ++i )
+        found += _search(items[i].buf, items[i].len, match, items[i].context, &items[i].state);
+
+    return found;
+}
+
+int Mpse::search_batch(MpseBatchItem* items, unsigned n, MpseMatch match)
+{
+    return _search_batch(items, n, match);
+}
+
 uint64_t Mpse::get_pattern_byte_count()
 { return 0; }
 
@@ -235,6 +250,62 @@ TEST(search_tool_tests, search_all_ac_full)
     delete stool;
 }
 
+static int count_hits(void*, void*, int, void* context, void*)
+{
+    ++*(unsigned*)context;
+    return 0;
+}
+
+TEST(search_tool_tests, search_batch_ac_full)
+{
+    mpse_api->init();
+    Mpse* mpse = mpse_api->ctor(snort_conf, nullptr, false, &s_agent);
+    CHECK(mpse);
+    mpse->set_opt(1);
+
+    const char* pats[] = { "the", "uba", "away", "nothere" };
+    Mpse::PatternDescriptor desc;
+
+    for ( auto p : pats )
+        mpse->add_pattern(nullptr, (const uint8_t*)p, strlen(p), desc, (void*)p);
+
+    mpse->prep_patterns(nullptr);
+
+    // more buffers than lanes and of different lengths
+    const char* bufs[] =
+    {
+        "the tuba ran away", "", "nothing", "away away away",
+        "THE", "xuba", "nothere and there", "the",
+    };
+    const unsigned num = sizeof(bufs) / sizeof(bufs[0]);
+
+    MpseBatchItem items[num];
+    unsigned batch_hits[num] = { };
+
+    for ( unsigned i = 0; i < num; ++i )
+        items[i] = { (const uint8_t*)bufs[i], (int)strlen(bufs[i]), batch_hits + i, 0 };
+
+    int found = mpse->search_batch(items, num, count_hits);
+
+    int serial_found = 0;
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        unsigned hits = 0;
+        int state = 0;
+        serial_found += mpse->search((const uint8_t*)bufs[i], strlen(bufs[i]), count_hits,
+            &hits, &state);
+
+        CHECK(batch_hits[i] == hits);
+        CHECK(items[i].state == state);
+    }
+    CHECK(found == serial_found);
+    CHECK(batch_hits[0] == 3);
+    CHECK(batch_hits[3] == 3);
+
+    mpse_api->dtor(mpse);
+}
+
 //-------------------------------------------------------------------------
 // main
 //-------------------------------------------------------------------------
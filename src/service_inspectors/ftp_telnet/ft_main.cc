@@ -202,7 +202,8 @@ void do_detection(Packet* p)
      // detection engine into the protocol module.  This idea scales much
      // better than having all these Packet struct field checks in the
      // main detection engine for each protocol field.
-    get_data_bus().publish(PACKET_EVENT, p);
+    static const unsigned pkt_event = DataBus::get_id(PACKET_EVENT);
+    get_data_bus().publish(pkt_event, p);
 
     DisableInspection();
 }
@@ -284,7 +284,8 @@ static RpcStatus RpcStatefulInspection(RpcDecodeConfig* rconfig,
                     if (RpcPrepRaw(data, rsdata->frag_len, p) != RPC_STATUS__SUCCESS)
                         return RPC_STATUS__ERROR;
 
-                    get_data_bus().publish(PACKET_EVENT, p);
+                    static const unsigned pkt_event = DataBus::get_id(PACKET_EVENT);
+                    get_data_bus().publish(pkt_event, p);
                 }
 
                 if ( (dsize > 0) )
@@ -369,7 +370,8 @@ static RpcStatus RpcStatefulInspection(RpcDecodeConfig* rconfig,
                 if ( (dsize > 0) )
                     RpcPreprocEvent(rconfig, rsdata, RPC_MULTIPLE_RECORD);
 
-                get_data_bus().publish(PACKET_EVENT, p);
+                static const unsigned pkt_event = DataBus::get_id(PACKET_EVENT);
+                get_data_bus().publish(pkt_event, p);
                 RpcBufClean(&rsdata->frag);
             }
 
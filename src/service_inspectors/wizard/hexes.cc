@@ -25,8 +25,6 @@
 
 using namespace std;
 
-#define WILD 0x100
-
 bool HexBook::translate(const char* in, HexVector& out)
 {
     bool hex = false;
@@ -70,99 +68,28 @@ bool HexBook::translate(const char* in, HexVector& out)
     return true;
 }
 
-//-------------------------------------------------------------------------
-
-void HexBook::add_spell(
-    const char* key, const char* val, HexVector& hv, unsigned i, MagicPage* p)
+bool HexBook::cast(const MagicSpell& sp, const uint8_t* s, unsigned n) const
 {
-    while ( i < hv.size() )
-    {
-        MagicPage* t = new MagicPage(*this);
-        int c = hv[i];
-
-        if ( c == WILD )
-            p->any = t;
-        else
-            p->next[c] = t;
-
-        p = t;
-        ++i;
-    }
-    p->key = key;
-    p->value = val;
-}
-
-bool HexBook::add_spell(const char* key, const char* val)
-{
-    HexVector hv;
-
-    if ( !translate(key, hv) )
+    if ( n < sp.hv.size() )
         return false;
 
-    unsigned i = 0;
-    MagicPage* p = root;
-
-    while ( i < hv.size() )
+    for ( unsigned i = 0; i < sp.hv.size(); ++i )
     {
-        int c = hv[i];
-
-        if ( c == WILD && p->any )
-            p = p->any;
-
-        else if ( p->next[c] )
-            p = p->next[c];
-
-        else
-            break;
-
-        ++i;
+        if ( sp.hv[i] != WILD and sp.hv[i] != s[i] )
+            return false;
     }
-    if ( p->key == key )
-        return false;
-
-    add_spell(key, val, hv, i, p);
     return true;
 }
 
-const MagicPage* HexBook::find_spell(
-    const uint8_t* s, unsigned n, const MagicPage* p, unsigned i) const
+unsigned HexBook::window() const
 {
-    while ( i < n )
-    {
-        int c = s[i];
+    unsigned max = 0;
 
-        if ( p->next[c] )
-        {
-            if ( p->any )
-            {
-                if ( const MagicPage* q = find_spell(s, n, p->next[c], i+1) )
-                    return q;
-            }
-            else
-            {
-                p = p->next[c];
-                ++i;
-                continue;
-            }
-        }
-        if ( p->any )
-        {
-            if ( const MagicPage* q = find_spell(s, n, p->any, i+1) )
-                return q;
-        }
-        break;
+    for ( auto* sp : spells )
+    {
+        if ( sp->hv.size() > max )
+            max = sp->hv.size();
     }
-    return p;
-}
-
-const char* HexBook::find_spell(
-    const uint8_t* data, unsigned len, const MagicPage*& p) const
-{
-    p = find_spell(data, len, p, 0);
-
-    if ( !p->value.empty() )
-        return p->value.c_str();
-
-    return nullptr;
+    return max;
 }
 
@@ -19,26 +19,232 @@
 
 #include "magic.h"
 
-MagicPage::MagicPage(const MagicBook& b) : book(b)
+#include <ctype.h>
+
+#include <algorithm>
+
+#include "search_engines/search_tool.h"
+
+//-------------------------------------------------------------------------
+// book stuff
+//-------------------------------------------------------------------------
+
+MagicBook::MagicBook(bool f)
+{ fixed = f; }
+
+MagicBook::~MagicBook()
 {
-    for ( int i = 0; i < 256; ++i )
-        next[i] = nullptr;
-    any = nullptr;
+    for ( auto* s : spells )
+        delete s;
 }
 
-MagicPage::~MagicPage()
+bool MagicBook::add_spell(const char* key, const char* val)
 {
-    for ( int i = 0; i < 256; ++i )
+    HexVector hv;
+
+    if ( !translate(key, hv) )
+        return false;
+
+    for ( auto* s : spells )
     {
-        if ( next[i] && next[i] != this )
-            delete next[i];
+        if ( s->hv == hv )
+            return false;
     }
-    delete any;
+
+    MagicSpell* s = new MagicSpell(*this);
+    s->key = key;
+    s->value = val;
+    s->hv = hv;
+    set_part(*s);
+
+    spells.push_back(s);
+    return true;
 }
 
-MagicBook::MagicBook()
-{ root = new MagicPage(*this); }
+// picks the literal run to search for.  with fixed width wild cards every
+// run is at a known offset so the longest is used.  otherwise only a
+// leading run is anchored; if there isn't one the longest floating run is
+// used and the hit is confirmed anywhere in the window.
+void MagicBook::set_part(MagicSpell& s)
+{
+    const HexVector& hv = s.hv;
 
-MagicBook::~MagicBook()
-{ delete root; }
+    s.part = s.part_len = 0;
+    s.anchored = fixed or (!hv.empty() and hv[0] != WILD);
+
+    unsigned i = 0;
+
+    while ( i < hv.size() )
+    {
+        if ( hv[i] == WILD )
+        {
+            ++i;
+            continue;
+        }
+        unsigned j = i;
+
+        while ( j < hv.size() and hv[j] != WILD )
+            ++j;
+
+        if ( j - i > s.part_len )
+        {
+            s.part = i;
+            s.part_len = j - i;
+        }
+        if ( !fixed and s.anchored )
+            break;
+
+        i = j;
+    }
+}
+
+//-------------------------------------------------------------------------
+// index stuff
+//-------------------------------------------------------------------------
+
+static bool is_suffix(const std::string& s, const std::string& of)
+{
+    return s.size() < of.size() and !of.compare(of.size() - s.size(), s.size(), s);
+}
+
+struct MagicHit
+{
+    const MagicIndex* index;
+    const uint8_t* data;
+    unsigned len;
+    unsigned rank;
+};
+
+MagicIndex::MagicIndex()
+{
+    search = nullptr;
+    max_window = 0;
+}
+
+MagicIndex::~MagicIndex()
+{
+    delete search;
+}
+
+void MagicIndex::add_book(const MagicBook* b)
+{
+    for ( auto* s : b->get_spells() )
+    {
+        unsigned rank = ranked.size();
+        ranked.push_back(s);
+
+        if ( !s->part_len )
+        {
+            always.push_back(rank);
+            continue;
+        }
+
+        // spells with the same run share one engine pattern; case is
+        // checked when cast
+        std::string key;
+
+        for ( unsigned i = 0; i < s->part_len; ++i )
+            key += (char)toupper(s->hv[s->part + i]);
+
+        parts[key].ranks.push_back(rank);
+    }
+
+    if ( b->window() > max_window )
+        max_window = b->window();
+}
+
+void MagicIndex::prep()
+{
+    if ( parts.empty() )
+        return;
+
+    // the engine reports just one of the parts that end at a position and
+    // those are all suffixes of each other (LOCK and UNLOCK).  so a part
+    // also casts the spells of every part it is a suffix of or that is a
+    // suffix of it.
+    std::map<std::string, std::vector<unsigned>> own;
+
+    for ( auto& p : parts )
+        own[p.first] = p.second.ranks;
+
+    for ( auto& p : parts )
+    {
+        std::vector<unsigned>& v = p.second.ranks;
+
+        for ( auto& q : own )
+        {
+            if ( q.first != p.first and
+                (is_suffix(q.first, p.first) or is_suffix(p.first, q.first)) )
+                v.insert(v.end(), q.second.begin(), q.second.end());
+        }
+        std::sort(v.begin(), v.end());
+    }
+
+    search = new SearchTool;
+
+    for ( auto& p : parts )
+        search->add(p.first.c_str(), p.first.size(), &p.second);
+
+    search->prep();
+}
+
+// end is the offset just past the spell's part in data or -1 if not searched
+bool MagicIndex::cast(unsigned rank, const uint8_t* data, unsigned len, int end) const
+{
+    const MagicSpell* s = ranked[rank];
+    unsigned base = s->book.skip(data, len);
+
+    if ( end >= 0 and s->anchored and (unsigned)end != base + s->part + s->part_len )
+        return false;
+
+    return s->book.cast(*s, data + base, len - base);
+}
+
+int MagicIndex::match(void* user, void*, int index, void* context, void*)
+{
+    const Part* p = (const Part*)user;
+    MagicHit* hit = (MagicHit*)context;
+
+    for ( auto rank : p->ranks )
+    {
+        if ( rank >= hit->rank )
+            break;
+
+        if ( hit->index->cast(rank, hit->data, hit->len, index) )
+        {
+            hit->rank = rank;
+            break;
+        }
+    }
+
+    // nothing can beat the first spell.  otherwise keep going and have
+    // ac_bnfa report repeated hits on this part since the spell may be at
+    // a later offset.
+    return hit->rank ? -1 : 1;
+}
+
+const char* MagicIndex::find_spell(const uint8_t* data, unsigned len) const
+{
+    if ( len > max_window )
+        len = max_window;
+
+    MagicHit hit = { this, data, len, (unsigned)ranked.size() };
+
+    for ( auto rank : always )
+    {
+        if ( cast(rank, data, len, -1) )
+        {
+            hit.rank = rank;
+            break;
+        }
+    }
+
+    if ( search and hit.rank )
+        search->find((const char*)data, len, match, false, &hit);
+
+    if ( hit.rank < ranked.size() )
+        return ranked[hit.rank]->value.c_str();
+
+    return nullptr;
+}
 
@@ -17,46 +17,70 @@
 //--------------------------------------------------------------------------
 // magic.h author Russ Combs <rucombs@cisco.com>
 
+#include <map>
 #include <string>
 #include <vector>
 
 #ifndef MAGIC_H
 #define MAGIC_H
 
+typedef std::vector<uint16_t> HexVector;
+
+// marks a wild card in a HexVector
+#define WILD 0x100
+
 class MagicBook;
 
-struct MagicPage
+// a translated spell or hex.  the literal run hv[part, part + part_len) is
+// what the search engine looks for; a hit is confirmed by cast().
+
+struct MagicSpell
 {
     std::string key;
     std::string value;
+    HexVector hv;
 
-    MagicPage* next[256];
-    MagicPage* any;
+    unsigned part;
+    unsigned part_len;
+    bool anchored;     // part is at a fixed offset from the start
 
     const MagicBook& book;
 
-    MagicPage(const MagicBook&);
-    ~MagicPage();
+    MagicSpell(const MagicBook& b) : book(b) { }
 };
 
-typedef std::vector<uint16_t> HexVector;
-
-// MagicBook is a set of MagicPages implementing a trie
+// MagicBook is the set of spells or hexes for one direction
 
 class MagicBook
 {
 public:
     virtual ~MagicBook();
 
-    virtual bool add_spell(const char* key, const char* val) = 0;
-    virtual const char* find_spell(const uint8_t*, unsigned len, const MagicPage*&) const = 0;
+    bool add_spell(const char* key, const char* val);
 
-    const MagicPage* page1()
-    { return root; }
+    // true if spell matches the start of data.  len is at most the
+    // largest window().
+    virtual bool cast(const MagicSpell&, const uint8_t* data, unsigned len) const = 0;
+
+    // bytes at the start of data that precede the spells
+    virtual unsigned skip(const uint8_t*, unsigned) const
+    { return 0; }
+
+    // bytes needed to decide every spell
+    virtual unsigned window() const = 0;
+
+    const std::vector<MagicSpell*>& get_spells() const
+    { return spells; }
 
 protected:
-    MagicBook();
-    MagicPage* root;
+    // fixed if each wild card matches exactly one byte
+    MagicBook(bool fixed);
+
+    virtual bool translate(const char*, HexVector&) = 0;
+    void set_part(MagicSpell&);
+
+    std::vector<MagicSpell*> spells;
+    bool fixed;
 };
 
 //-------------------------------------------------------------------------
@@ -67,16 +91,16 @@ protected:
 class SpellBook : public MagicBook
 {
 public:
-    SpellBook();
+    SpellBook() : MagicBook(false) { }
     ~SpellBook() { }
 
-    bool add_spell(const char*, const char*);
-    const char* find_spell(const uint8_t*, unsigned len, const MagicPage*&) const;
+    bool cast(const MagicSpell&, const uint8_t*, unsigned len) const override;
+    unsigned skip(const uint8_t*, unsigned len) const override;
+    unsigned window() const override;
 
 private:
-    bool translate(const char*, HexVector&);
-    void add_spell(const char*, const char*, HexVector&, unsigned, MagicPage*);
-    const MagicPage* find_spell(const uint8_t*, unsigned, const MagicPage*, unsigned) const;
+    bool translate(const char*, HexVector&) override;
+    bool glob(const HexVector&, unsigned, const uint8_t*, unsigned) const;
 };
 
 //-------------------------------------------------------------------------
@@ -87,16 +111,56 @@ private:
 class HexBook : public MagicBook
 {
 public:
-    HexBook() { }
+    HexBook() : MagicBook(true) { }
     ~HexBook() { }
 
-    bool add_spell(const char*, const char*);
-    const char* find_spell(const uint8_t*, unsigned len, const MagicPage*&) const;
+    bool cast(const MagicSpell&, const uint8_t*, unsigned len) const override;
+    unsigned window() const override;
+
+private:
+    bool translate(const char*, HexVector&) override;
+};
+
+//-------------------------------------------------------------------------
+// the literal runs from all the books for one direction are compiled into
+// a single search engine instance so a payload is scanned once no matter
+// how many spells are configured.  spells without a literal run are cast
+// directly.  books are searched in the order added and the first spell
+// added wins within a book.
+//-------------------------------------------------------------------------
+
+class MagicIndex
+{
+public:
+    MagicIndex();
+    ~MagicIndex();
+
+    void add_book(const MagicBook*);
+    void prep();
+
+    // returns the service of the best matching spell or nullptr
+    const char* find_spell(const uint8_t*, unsigned len) const;
+
+    unsigned window() const
+    { return max_window; }
 
 private:
-    bool translate(const char*, HexVector&);
-    void add_spell(const char*, const char*, HexVector&, unsigned, MagicPage*);
-    const MagicPage* find_spell(const uint8_t*, unsigned, const MagicPage*, unsigned) const;
+    // spells are identified by rank; lower ranks win.  ranks are the
+    // spells to cast when the engine reports this part.
+    struct Part
+    {
+        std::vector<unsigned> ranks;
+    };
+
+    bool cast(unsigned rank, const uint8_t*, unsigned len, int end) const;
+    static int match(void*, void*, int, void*, void*);
+
+    std::vector<const MagicSpell*> ranked;
+    std::map<std::string, Part> parts;
+    std::vector<unsigned> always;
+
+    class SearchTool* search;
+    unsigned max_window;
 };
 
 #endif
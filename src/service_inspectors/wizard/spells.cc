@@ -24,16 +24,8 @@
 
 using namespace std;
 
-#define WILD 0x100
-
-SpellBook::SpellBook()
-{
-    // allows skipping leading whitespace only
-    root->next[(int)' '] = root;
-    root->next[(int)'\t'] = root;
-    root->next[(int)'\r'] = root;
-    root->next[(int)'\n'] = root;
-}
+// FIXIT-L make configurable upper bound to limit globbing
+#define MAX_GLOB 16
 
 bool SpellBook::translate(const char* in, HexVector& out)
 {
@@ -47,7 +39,7 @@ bool SpellBook::translate(const char* in, HexVector& out)
             if ( in[i] != '*' )
                 out.push_back(WILD);
 
-            out.push_back(in[i]);
+            out.push_back(toupper((uint8_t)in[i]));
             wild = false;
         }
         else
@@ -55,113 +47,63 @@ bool SpellBook::translate(const char* in, HexVector& out)
             if ( in[i] == '*' )
                 wild = true;
             else
-                out.push_back(in[i]);
+                out.push_back(toupper((uint8_t)in[i]));
         }
         ++i;
     }
     return true;
 }
 
-void SpellBook::add_spell(
-    const char* key, const char* val, HexVector& hv, unsigned i, MagicPage* p)
-{
-    while ( i < hv.size() )
-    {
-        MagicPage* t = new MagicPage(*this);
-
-        if ( hv[i] == WILD )
-            p->any = t;
-        else
-            p->next[toupper(hv[i])] = t;
-
-        p = t;
-        ++i;
-    }
-    p->key = key;
-    p->value = val;
-}
-
-bool SpellBook::add_spell(const char* key, const char* val)
+// allows skipping leading whitespace only
+unsigned SpellBook::skip(const uint8_t* s, unsigned n) const
 {
-    HexVector hv;
-
-    if ( !translate(key, hv) )
-        return false;
-
     unsigned i = 0;
-    MagicPage* p = root;
-
-    while ( i < hv.size() )
-    {
-        int c = toupper(hv[i]);
-
-        if ( c == WILD && p->any )
-            p = p->any;
-
-        else if ( p->next[c] )
-            p = p->next[c];
-
-        else
-            break;
 
+    while ( i < n and (s[i] == ' ' or s[i] == '\t' or s[i] == '\r' or s[i] == '\n') )
         ++i;
-    }
-    if ( p->key == key )
-        return false;
 
-    add_spell(key, val, hv, i, p);
-    return true;
+    return i;
 }
 
-const MagicPage* SpellBook::find_spell(
-    const uint8_t* s, unsigned n, const MagicPage* p, unsigned i) const
+// true if hv[i:] is a prefix of s with each wild card matching any number
+// of bytes
+bool SpellBook::glob(const HexVector& hv, unsigned i, const uint8_t* s, unsigned n) const
 {
-    while ( i < n )
+    while ( i < hv.size() )
     {
-        int c = toupper(s[i]);
-
-        if ( p->next[c] )
-        {
-            if ( p->any )
-            {
-                if ( const MagicPage* q = find_spell(s, n, p->next[c], i+1) )
-                    return q;
-            }
-            else
-            {
-                p = p->next[c];
-                ++i;
-                continue;
-            }
-        }
-        if ( p->any )
+        if ( hv[i] == WILD )
         {
-            while ( i < n )
+            for ( unsigned k = 0; k <= n; ++k )
             {
-                if ( const MagicPage* q = find_spell(s, n, p->any, i) )
-                    return q;
-                ++i;
+                if ( glob(hv, i+1, s+k, n-k) )
+                    return true;
             }
+            return false;
         }
-        break;
+        if ( !n or toupper(*s) != hv[i] )
+            return false;
+
+        ++i;
+        ++s;
+        --n;
     }
-    return p;
+    return true;
 }
 
-const char* SpellBook::find_spell(
-    const uint8_t* data, unsigned len, const MagicPage*& p) const
+bool SpellBook::cast(const MagicSpell& sp, const uint8_t* s, unsigned n) const
 {
-    // FIXIT-L make configurable upper bound to limit globbing
-    unsigned max = 16;
-
-    if ( len > max )
-        len = max;
-
-    p = find_spell(data, len, p, 0);
+    return glob(sp.hv, 0, s, n);
+}
 
-    if ( !p->value.empty() )
-        return p->value.c_str();
+unsigned SpellBook::window() const
+{
+    unsigned max = MAX_GLOB;
 
-    return nullptr;
+    for ( auto* sp : spells )
+    {
+        if ( sp->hv.size() > max )
+            max = sp->hv.size();
+    }
+    return max;
 }
 
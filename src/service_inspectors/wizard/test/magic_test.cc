@@ -0,0 +1,240 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// magic_test.cc
+// unit test main
+
+#include "service_inspectors/wizard/magic.h"
+
+#include <string.h>
+
+#include "framework/base_api.h"
+#include "framework/mpse.h"
+#include "managers/mpse_manager.h"
+#include "main/snort_config.h"
+
+// must appear after snort_config.h to avoid broken c++ map include
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+//-------------------------------------------------------------------------
+// base stuff
+//-------------------------------------------------------------------------
+
+SnortConfig s_conf;
+THREAD_LOCAL SnortConfig* snort_conf = &s_conf;
+
+static SnortState s_state;
+
+SnortConfig::SnortConfig()
+{
+    state = &s_state;
+    memset(state, 0, sizeof(*state));
+    num_slots = 1;
+}
+
+SnortConfig::~SnortConfig() { }
+
+unsigned get_instance_id()
+{ return 0; }
+
+FileIdentifier::~FileIdentifier() { }
+
+FileVerdict FilePolicy::type_lookup(Flow*, FileContext*)
+{ return FILE_VERDICT_UNKNOWN; }
+
+FileVerdict FilePolicy::type_lookup(Flow*, FileInfo*)
+{ return FILE_VERDICT_UNKNOWN; }
+
+FileVerdict FilePolicy::signature_lookup(Flow*, FileContext*)
+{ return FILE_VERDICT_UNKNOWN; }
+
+FileVerdict FilePolicy::signature_lookup(Flow*, FileInfo*)
+{ return FILE_VERDICT_UNKNOWN; }
+
+void LogValue(const char*, const char*, FILE*) { }
+void LogMessage(const char*, ...) { }
+void LogCount(char const*, uint64_t, FILE*) { }
+void LogStat(const char*, double, FILE*) { }
+void FatalError(const char*, ...) { exit(1); }
+
+// the wizard uses the default engine
+extern const BaseApi* se_ac_bnfa;
+static const MpseApi* mpse_api = (MpseApi*)se_ac_bnfa;
+
+Mpse* MpseManager::get_search_engine(const char*)
+{
+    mpse_api->init();
+    return mpse_api->ctor(snort_conf, nullptr, false, nullptr);
+}
+
+void MpseManager::delete_search_engine(Mpse* p)
+{ mpse_api->dtor(p); }
+
+Mpse::Mpse(const char*, bool) { }
+
+int Mpse::search(
+    const unsigned char* T, int n, MpseMatch match,
+    void* context, int* current_state)
+{
+    return _search(T, n, match, context, current_state);
+}
+
+int Mpse::search_all(
+    const unsigned char* T, int n, MpseMatch match,
+    void* context, int* current_state)
+{
+    return _search(T, n, match, context, current_state);
+}
+
+int Mpse::_search_batch(MpseBatchItem*, unsigned, MpseMatch)
+{ return 0; }
+
+uint64_t Mpse::get_pattern_byte_count()
+{ return 0; }
+
+void Mpse::reset_pattern_byte_count()
+{ }
+
+//-------------------------------------------------------------------------
+// tests
+//-------------------------------------------------------------------------
+
+static const char* find(MagicIndex& m, const char* s, unsigned n = 0)
+{
+    if ( !n )
+        n = strlen(s);
+
+    return m.find_spell((const uint8_t*)s, n);
+}
+
+TEST_GROUP(magic)
+{
+    HexBook* hexes;
+    SpellBook* spells;
+    MagicIndex* magic;
+
+    void setup()
+    {
+        hexes = new HexBook;
+        spells = new SpellBook;
+        magic = new MagicIndex;
+    }
+
+    void teardown()
+    {
+        delete magic;
+        delete spells;
+        delete hexes;
+    }
+
+    void prep()
+    {
+        magic->add_book(hexes);
+        magic->add_book(spells);
+        magic->prep();
+    }
+};
+
+TEST(magic, spells)
+{
+    CHECK(spells->add_spell("GET", "http"));
+    CHECK(spells->add_spell("220*FTP", "ftp"));
+    CHECK(spells->add_spell("220*SMTP", "smtp"));
+    CHECK(spells->add_spell("**OK", "imap"));
+    CHECK(spells->add_spell("*SSH", "ssh"));
+    CHECK(!spells->add_spell("get", "http"));
+    prep();
+
+    STRCMP_EQUAL("http", find(*magic, "GET / HTTP/1.1"));
+    STRCMP_EQUAL("http", find(*magic, " \r\nget /"));
+    STRCMP_EQUAL("smtp", find(*magic, "220 mx SMTP ready"));
+    STRCMP_EQUAL("ftp", find(*magic, "220 FTP ready"));
+    STRCMP_EQUAL("imap", find(*magic, "*OK ready"));
+    STRCMP_EQUAL("ssh", find(*magic, "xxSSH-2.0"));
+
+    CHECK(!find(*magic, "xGET"));
+    CHECK(!find(*magic, "GE"));
+    CHECK(!find(*magic, "* OK"));
+}
+
+// parts that are suffixes of other parts end in the same engine state
+TEST(magic, overlapping_spells)
+{
+    CHECK(spells->add_spell("LOCK", "http"));
+    CHECK(spells->add_spell("UNLOCK", "http"));
+    CHECK(spells->add_spell("XCWD", "ftp"));
+    CHECK(spells->add_spell("CWD", "ftp"));
+    CHECK(spells->add_spell("SMS_POST", "sms"));
+    CHECK(spells->add_spell("POST", "http"));
+    prep();
+
+    STRCMP_EQUAL("http", find(*magic, "UNLOCK /"));
+    STRCMP_EQUAL("http", find(*magic, "LOCK /"));
+    STRCMP_EQUAL("ftp", find(*magic, "XCWD /"));
+    STRCMP_EQUAL("ftp", find(*magic, "CWD /"));
+    STRCMP_EQUAL("sms", find(*magic, "SMS_POST /"));
+    STRCMP_EQUAL("http", find(*magic, "POST /"));
+
+    CHECK(!find(*magic, "XLOCK /"));
+}
+
+TEST(magic, hexes)
+{
+    CHECK(hexes->add_spell("|FF|SMB", "smb"));
+    CHECK(hexes->add_spell("?????????????????|01|", "isakmp"));
+    CHECK(hexes->add_spell("??|0 0|", "modbus"));
+    prep();
+
+    STRCMP_EQUAL("smb", find(*magic, "\xff" "SMB", 4));
+    CHECK(!find(*magic, "\xff" "smb", 4));
+
+    // the part is at a later offset than an earlier hit on it
+    char isakmp[18] = { };
+    isakmp[2] = 5;
+    isakmp[3] = 1;
+    isakmp[17] = 1;
+    STRCMP_EQUAL("isakmp", find(*magic, isakmp, 18));
+    CHECK(!find(*magic, isakmp, 17));
+
+    char modbus[4] = { 9, 9, 0, 0 };
+    STRCMP_EQUAL("modbus", find(*magic, modbus, 4));
+}
+
+TEST(magic, precedence)
+{
+    CHECK(hexes->add_spell("USER", "hex"));
+    CHECK(spells->add_spell("USER", "ftp"));
+    CHECK(spells->add_spell("USER", "pop3") == false);
+    CHECK(spells->add_spell("US*", "other"));
+    prep();
+
+    STRCMP_EQUAL("hex", find(*magic, "USER bob"));
+    STRCMP_EQUAL("ftp", find(*magic, "user bob"));
+    STRCMP_EQUAL("other", find(*magic, "us bob"));
+}
+
+//-------------------------------------------------------------------------
+// main
+//-------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
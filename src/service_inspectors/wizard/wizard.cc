@@ -64,8 +64,10 @@ THREAD_LOCAL WizStats tstats;
 
 struct Wand
 {
-    const MagicPage* hex;
-    const MagicPage* spell;
+    const MagicIndex* magic;
+    std::string prefix;     // tcp data held until the window is full
+    bool tcp;
+    bool done;
 };
 
 class Wizard;
@@ -101,7 +103,7 @@ public:
 
     void reset(Wand&, bool tcp, bool c2s);
     bool cast_spell(Wand&, Flow*, const uint8_t*, unsigned);
-    bool spellbind(const MagicPage*&, Flow*, const uint8_t*, unsigned);
+    bool spellbind(const MagicIndex*, Flow*, const uint8_t*, unsigned);
 
 public:
     MagicBook* c2s_hexes;
@@ -109,6 +111,9 @@ public:
 
     MagicBook* c2s_spells;
     MagicBook* s2c_spells;
+
+    MagicIndex c2s_magic;
+    MagicIndex s2c_magic;
 };
 
 //-------------------------------------------------------------------------
@@ -154,6 +159,15 @@ Wizard::Wizard(WizardModule* m)
 
     c2s_spells = m->get_book(true, false);
     s2c_spells = m->get_book(false, false);
+
+    // hexes take precedence over spells
+    c2s_magic.add_book(c2s_hexes);
+    c2s_magic.add_book(c2s_spells);
+    c2s_magic.prep();
+
+    s2c_magic.add_book(s2c_hexes);
+    s2c_magic.add_book(s2c_spells);
+    s2c_magic.prep();
 }
 
 Wizard::~Wizard()
@@ -165,18 +179,12 @@ Wizard::~Wizard()
     delete s2c_spells;
 }
 
-void Wizard::reset(Wand& w, bool /*tcp*/, bool c2s)
+void Wizard::reset(Wand& w, bool tcp, bool c2s)
 {
-    if ( c2s )
-    {
-        w.hex = c2s_hexes->page1();
-        w.spell = c2s_spells->page1();
-    }
-    else
-    {
-        w.hex = s2c_hexes->page1();
-        w.spell = s2c_spells->page1();
-    }
+    w.magic = c2s ? &c2s_magic : &s2c_magic;
+    w.prefix.clear();
+    w.tcp = tcp;
+    w.done = false;
 }
 
 void Wizard::eval(Packet* p)
@@ -202,9 +210,9 @@ StreamSplitter* Wizard::get_splitter(bool c2s)
 }
 
 bool Wizard::spellbind(
-    const MagicPage*& m, Flow* f, const uint8_t* data, unsigned len)
+    const MagicIndex* m, Flow* f, const uint8_t* data, unsigned len)
 {
-    f->service = m->book.find_spell(data, len, m);
+    f->service = m->find_spell(data, len);
 
     if (f->service != nullptr)
     {
@@ -217,16 +225,34 @@ bool Wizard::spellbind(
     return false;
 }
 
+// spells are cast on the start of the flow so tcp segments are collected
+// until there is enough data to decide.  after a hit or a full window
+// without one there is nothing more to find.
 bool Wizard::cast_spell(
     Wand& w, Flow* f, const uint8_t* data, unsigned len)
 {
-    if ( w.hex && spellbind(w.hex, f, data, len) )
-        return true;
+    if ( w.done )
+        return false;
 
-    if ( w.spell && spellbind(w.spell, f, data, len) )
-        return true;
+    unsigned window = w.magic->window();
 
-    return false;
+    if ( w.tcp and (!w.prefix.empty() or len < window) )
+    {
+        unsigned room = window - w.prefix.size();
+        w.prefix.append((const char*)data, len < room ? len : room);
+
+        data = (const uint8_t*)w.prefix.data();
+        len = w.prefix.size();
+    }
+
+    bool hit = spellbind(w.magic, f, data, len);
+
+    if ( hit or len >= window )
+    {
+        w.done = true;
+        w.prefix.clear();
+    }
+    return hit;
 }
 
 //-------------------------------------------------------------------------
@@ -87,9 +87,12 @@
 #include "protocols/layer.h"
 #include "protocols/ipv4_options.h"
 #include "protocols/packet_manager.h"
+#include "protocols/packet_pool.h"
 #include "main/snort.h"
 #include "main/snort_debug.h"
 #include "profiler/profiler.h"
+#include "stream/stream.h"
+#include "time/timer_wheel.h"
 #include "time/timersub.h"
 #include "utils/stats.h"
 #include "detection/detect.h"
@@ -745,7 +748,7 @@ static void FragRebuild(FragTracker* ft, Packet* p)
 // XXX NOT YET IMPLEMENTED - debugging
 
     if (!defrag_pkts[encap_frag_cnt])
-        defrag_pkts[encap_frag_cnt] = new Packet();
+        defrag_pkts[encap_frag_cnt] = PacketPool::acquire();
 
     dpkt = defrag_pkts[encap_frag_cnt];
 
@@ -1039,9 +1042,41 @@ static void release_tracker(FragTracker* ft)
     delete_tracker(ft);
     ft->engine = nullptr;
 
+    if ( ft->timer.armed() )
+        flow_con->get_timers()->cancel(&ft->timer);
+
     ip_stats.trackers_released++;
 }
 
+// trackers that stop getting fragments are released by the flow timer
+// wheel instead of waiting for another fragment to find them expired.
+// the deadline follows frag_time since the timeout restarts with each
+// fragment.
+class FragTimer : public TimerHandler
+{
+public:
+    void expire(TimerNode* n, uint32_t) override
+    {
+        FragTracker* ft = (FragTracker*)n->owner;
+
+        DebugMessage(DEBUG_FRAG, "releasing expired tracker\n");
+        release_tracker(ft);
+        ip_stats.frag_timeouts++;
+    }
+};
+
+static FragTimer frag_timer;
+
+static void arm_tracker(FragTracker* ft, const Packet* p, const FragEngine* fe)
+{
+    uint32_t when = p->pkth->ts.tv_sec + fe->frag_timeout;
+
+    if ( ft->timer.armed() )
+        TimerWheel::extend(&ft->timer, when);
+    else
+        flow_con->get_timers()->schedule(&ft->timer, &frag_timer, ft, when);
+}
+
 //-------------------------------------------------------------------------
 // Defrag methods
 //-------------------------------------------------------------------------
@@ -1062,7 +1097,7 @@ void Defrag::tinit()
     for (int i = 1; i < layers; i++)
         defrag_pkts[i] = nullptr;
 
-    defrag_pkts[0] = new Packet();
+    defrag_pkts[0] = PacketPool::acquire();
     pkt_snaplen = SFDAQ::get_snap_len();
 }
 
@@ -1070,11 +1105,8 @@ void Defrag::tterm()
 {
     for (int i = 0; i < layers; i++)
     {
-        if (defrag_pkts[i] != nullptr)
-        {
-            delete defrag_pkts[i];
-            defrag_pkts[i] = nullptr;
-        }
+        PacketPool::release(defrag_pkts[i]);
+        defrag_pkts[i] = nullptr;
     }
 
     delete[] defrag_pkts;
@@ -1182,6 +1214,7 @@ void Defrag::process(Packet* p, FragTracker* ft)
     // Update frag time when we get a frag associated with this tracker
     ft->frag_time.tv_sec = p->pkth->ts.tv_sec;
     ft->frag_time.tv_usec = p->pkth->ts.tv_usec;
+    arm_tracker(ft, p, fe);
 
     //dont forward fragments to engine if some previous fragment was dropped
     if ( ft->frag_flags & FRAG_DROP_FRAGMENTS )
@@ -2083,6 +2116,7 @@ int Defrag::new_tracker(Packet* p, FragTracker* ft)
     ft->ordinal = 0;
     ft->frag_policy = p->flow->ssn_policy ? p->flow->ssn_policy : engine.frag_policy;
     ft->engine = &engine;
+    arm_tracker(ft, p, &engine);
 
     /*
      * get our first fragment storage struct
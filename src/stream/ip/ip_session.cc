@@ -72,6 +72,10 @@ static void IpSessionCleanup(Flow* lws, FragTracker* tracker)
         d->cleanup(tracker);
     }
 
+    // the tracker is reused by the next flow so it can't stay on the wheel
+    if ( tracker->timer.armed() )
+        flow_con->get_timers()->cancel(&tracker->timer);
+
     if ( lws->ssn_state.session_flags & SSNFLAG_TIMEDOUT )
         ip_stats.timeouts++;
     else if ( lws->ssn_state.session_flags & SSNFLAG_PRUNED )
@@ -25,6 +25,7 @@
 #include <sys/time.h>
 #include "flow/session.h"
 #include "framework/counts.h"
+#include "time/timer_wheel.h"
 
 struct Fragment;
 struct FragEngine;
@@ -74,6 +75,8 @@ struct FragTracker
 
     // Count of IP fragment overlap for each packet id.
     uint32_t overlap_count;
+
+    TimerNode timer;  // armed while engine is set
 };
 
 class IpSession : public Session
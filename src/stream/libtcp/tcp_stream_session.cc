@@ -21,6 +21,7 @@
 
 #include "log/messages.h"
 #include "main/snort_debug.h"
+#include "protocols/packet_pool.h"
 #include "sfip/sf_ip.h"
 
 #include "tcp_stream_session.h"
@@ -465,17 +466,14 @@ void TcpStreamSession::start_proxy()
 
 void TcpStreamSession::sinit()
 {
-    s5_pkt = new Packet();
+    s5_pkt = PacketPool::acquire();
     //AtomSplitter::init();  // FIXIT-L PAF implement
 }
 
 void TcpStreamSession::sterm()
 {
-    if (s5_pkt)
-    {
-        delete s5_pkt;
-        s5_pkt = nullptr;
-    }
+    PacketPool::release(s5_pkt);
+    s5_pkt = nullptr;
 }
 
 void TcpStreamSession::print()
@@ -25,6 +25,7 @@
 #include "stream_tcp.h"
 #include "tcp_ha.h"
 #include "tcp_module.h"
+#include "tcp_segment_node.h"
 #include "tcp_session.h"
 
 #include "stream/flush_bucket.h"
@@ -127,12 +128,14 @@ static Session* tcp_ssn(Flow* lws)
 static void tcp_tinit()
 {
     TcpSession::sinit();
+    TcpSegmentNode::setup();
 }
 
 static void tcp_tterm()
 {
     TcpSession::sterm();
     FlushBucket::clear();
+    TcpSegmentNode::clear();
 }
 
 static const InspectApi tcp_api =
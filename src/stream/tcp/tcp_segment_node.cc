@@ -21,11 +21,154 @@
 
 #include "tcp_segment_node.h"
 
+#include <vector>
+
 #include "flow/flow_control.h"
+#include "main/thread.h"
 #include "protocols/packet.h"
 #include "utils/util.h"
 #include "tcp_module.h"
 
+//-------------------------------------------------------------------------
+// segment pool
+//
+// blocks are powers of 2 from 128 bytes (a node plus a small payload) up
+// to 128K (a node plus the largest possible payload).  smaller blocks are
+// carved from 64K slabs.  released blocks go back on their class free list
+// and are only returned to the heap when the thread terminates.
+//
+// flows may outlive tcp_tterm(), eg when dirty_pig skips the purge and the
+// flow cache is deleted by another inspector's tterm, so the pool counts
+// blocks in use and is deleted by the last release after clear().
+//-------------------------------------------------------------------------
+
+class TcpSegmentPool
+{
+public:
+    TcpSegmentPool();
+    ~TcpSegmentPool();
+
+    void* alloc(size_t);
+    void release(void*, size_t);
+
+    bool in_use() const
+    { return live > 0; }
+
+    bool closing;
+
+private:
+    static unsigned get_class(size_t);
+    void refill(unsigned);
+
+private:
+    static const unsigned min_shift = 7;
+    static const unsigned max_shift = 17;
+    static const unsigned num_classes = max_shift - min_shift + 1;
+    static const size_t slab_size = 64 * 1024;
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    FreeBlock* free_list[num_classes];
+    std::vector<uint8_t*> slabs;
+    unsigned live;
+};
+
+TcpSegmentPool::TcpSegmentPool()
+{
+    closing = false;
+    live = 0;
+
+    for ( unsigned i = 0; i < num_classes; ++i )
+        free_list[i] = nullptr;
+}
+
+TcpSegmentPool::~TcpSegmentPool()
+{
+    for ( auto slab : slabs )
+        snort_free(slab);
+}
+
+unsigned TcpSegmentPool::get_class(size_t sz)
+{
+    unsigned c = 0;
+
+    while ( ((size_t)1 << (c + min_shift)) < sz )
+        ++c;
+
+    assert(c < num_classes);
+    return c;
+}
+
+void TcpSegmentPool::refill(unsigned c)
+{
+    size_t block_size = (size_t)1 << (c + min_shift);
+    size_t size = block_size < slab_size ? slab_size : block_size;
+
+    uint8_t* slab = (uint8_t*)snort_alloc(size);
+    slabs.push_back(slab);
+
+    for ( size_t off = 0; off + block_size <= size; off += block_size )
+    {
+        FreeBlock* fb = (FreeBlock*)(slab + off);
+        fb->next = free_list[c];
+        free_list[c] = fb;
+    }
+}
+
+void* TcpSegmentPool::alloc(size_t sz)
+{
+    unsigned c = get_class(sz);
+
+    if ( !free_list[c] )
+        refill(c);
+
+    FreeBlock* fb = free_list[c];
+    free_list[c] = fb->next;
+    ++live;
+    return fb;
+}
+
+void TcpSegmentPool::release(void* p, size_t sz)
+{
+    unsigned c = get_class(sz);
+    FreeBlock* fb = (FreeBlock*)p;
+
+    fb->next = free_list[c];
+    free_list[c] = fb;
+
+    assert(live);
+    --live;
+}
+
+static THREAD_LOCAL TcpSegmentPool* seg_pool = nullptr;
+
+void TcpSegmentNode::setup()
+{
+    if ( !seg_pool )
+        seg_pool = new TcpSegmentPool;
+    else
+        seg_pool->closing = false;
+}
+
+// segments still queued on flows keep the pool until they are released
+void TcpSegmentNode::clear()
+{
+    if ( !seg_pool )
+        return;
+
+    if ( seg_pool->in_use() )
+    {
+        seg_pool->closing = true;
+        return;
+    }
+
+    delete seg_pool;
+    seg_pool = nullptr;
+}
+
 TcpSegmentNode::TcpSegmentNode() :
     prev(nullptr), next(nullptr), tv({ 0, 0 }), ts(0), seq(0), orig_dsize(0),
     payload_size(0), urg_offset(0), buffered(false), data(nullptr), payload(nullptr)
@@ -34,7 +177,6 @@ TcpSegmentNode::TcpSegmentNode() :
 
 TcpSegmentNode::~TcpSegmentNode()
 {
-    // TODO Auto-generated destructor stub
 }
 
 //-------------------------------------------------------------------------
@@ -52,8 +194,12 @@ TcpSegmentNode* TcpSegmentNode::init(TcpSegmentNode& tsn)
 
 TcpSegmentNode* TcpSegmentNode::init(const struct timeval& tv, const uint8_t* data, unsigned dsize)
 {
-    TcpSegmentNode* ss = new TcpSegmentNode;
-    ss->data = ( uint8_t* )snort_alloc(dsize);
+    // segments are only queued by packet threads, after tcp_tinit()
+    assert(seg_pool and !seg_pool->closing and is_packet_thread());
+
+    void* block = seg_pool->alloc(sizeof(TcpSegmentNode) + dsize);
+    TcpSegmentNode* ss = new(block) TcpSegmentNode;
+    ss->data = (uint8_t*)(ss + 1);
     ss->payload = ss->data;
     ss->tv = tv;
     memcpy(ss->payload, data, dsize);
@@ -65,10 +211,21 @@ TcpSegmentNode* TcpSegmentNode::init(const struct timeval& tv, const uint8_t* da
 
 void TcpSegmentNode::term()
 {
-    snort_free(data);
+    size_t size = sizeof(TcpSegmentNode) + orig_dsize;
+
     tcpStats.segs_released++;
     tcpStats.mem_in_use -= orig_dsize;
-    delete this;
+
+    this->~TcpSegmentNode();
+
+    assert(seg_pool);
+    seg_pool->release(this, size);
+
+    if ( seg_pool->closing and !seg_pool->in_use() )
+    {
+        delete seg_pool;
+        seg_pool = nullptr;
+    }
 }
 
 bool TcpSegmentNode::is_retransmit(const uint8_t* rdata, uint16_t rsize, uint32_t rseq)
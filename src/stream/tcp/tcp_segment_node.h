@@ -32,18 +32,26 @@
 // we make a lot of TcpSegments so it is organized by member
 // size/alignment requirements to minimize unused space
 // ... however, use of padding below is critical, adjust if needed
+//
+// each node and its data are carved from a single block taken from
+// per thread, size classed free lists so there is no heap allocation
+// on the reassembly path once the free lists are warm.
 //-----------------------------------------------------------------
 
 class TcpSegmentNode
 {
 public:
     TcpSegmentNode();
-    virtual ~TcpSegmentNode();
+    ~TcpSegmentNode();
 
     static TcpSegmentNode* init(TcpSegmentDescriptor& tsd);
     static TcpSegmentNode* init(TcpSegmentNode& tsn);
     static TcpSegmentNode* init(const struct timeval&, const uint8_t*, unsigned);
 
+    // per packet thread pool of segment blocks
+    static void setup();
+    static void clear();
+
     void term();
     bool is_retransmit(const uint8_t*, uint16_t size, uint32_t);
 
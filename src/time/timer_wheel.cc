@@ -0,0 +1,377 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "timer_wheel.h"
+
+#ifdef UNIT_TEST
+#include <vector>
+#include "catch/catch.hpp"
+#endif
+
+//-------------------------------------------------------------------------
+// private stuff
+//-------------------------------------------------------------------------
+
+static inline void init_slot(TimerNode* head)
+{
+    head->next = head->prev = head;
+}
+
+static inline void link(TimerNode* head, TimerNode* n)
+{
+    n->prev = head->prev;
+    n->next = head;
+    head->prev->next = n;
+    head->prev = n;
+}
+
+static inline void unlink(TimerNode* n)
+{
+    n->prev->next = n->next;
+    n->next->prev = n->prev;
+    n->next = n->prev = nullptr;
+}
+
+// moves all nodes from head to the returned null terminated list
+static TimerNode* splice(TimerNode* head)
+{
+    if ( head->next == head )
+        return nullptr;
+
+    TimerNode* list = head->next;
+    head->prev->next = nullptr;
+    init_slot(head);
+
+    return list;
+}
+
+void TimerWheel::insert(TimerNode* n)
+{
+    if ( n->expires < cur )
+        n->expires = cur;
+
+    uint32_t delta = n->expires - cur;
+
+    if ( delta < l0_size )
+    {
+        link(l0 + (n->expires & (l0_size - 1)), n);
+        return;
+    }
+
+    unsigned lvl = 0;
+    unsigned shift = l0_bits;
+
+    while ( lvl + 1 < num_upper and delta >= (1u << (shift + ln_bits)) )
+    {
+        ++lvl;
+        shift += ln_bits;
+    }
+
+    // beyond the top level; expires is rechecked against the deadline
+    if ( delta >= (1u << (shift + ln_bits)) )
+        n->expires = cur + (1u << (shift + ln_bits)) - 1;
+
+    link(ln[lvl] + ((n->expires >> shift) & (ln_size - 1)), n);
+}
+
+void TimerWheel::cascade(TimerNode* slots, unsigned idx)
+{
+    TimerNode* n = splice(slots + idx);
+
+    while ( n )
+    {
+        TimerNode* next = n->next;
+        insert(n);
+        n = next;
+    }
+}
+
+// sparse wheels aren't walked a tick at a time across long gaps
+void TimerWheel::rebase(uint32_t now)
+{
+    TimerNode* list = nullptr;
+
+    auto take = [&list](TimerNode* head)
+    {
+        TimerNode* n = splice(head);
+
+        while ( n )
+        {
+            TimerNode* next = n->next;
+            n->next = list;
+            list = n;
+            n = next;
+        }
+    };
+
+    for ( unsigned i = 0; i < l0_size; ++i )
+        take(l0 + i);
+
+    for ( unsigned lvl = 0; lvl < num_upper; ++lvl )
+        for ( unsigned i = 0; i < ln_size; ++i )
+            take(ln[lvl] + i);
+
+    cur = now;
+
+    while ( list )
+    {
+        TimerNode* next = list->next;
+        insert(list);
+        list = next;
+    }
+}
+
+//-------------------------------------------------------------------------
+// public stuff
+//-------------------------------------------------------------------------
+
+TimerWheel::TimerWheel()
+{
+    for ( unsigned i = 0; i < l0_size; ++i )
+        init_slot(l0 + i);
+
+    for ( unsigned lvl = 0; lvl < num_upper; ++lvl )
+        for ( unsigned i = 0; i < ln_size; ++i )
+            init_slot(ln[lvl] + i);
+
+    cur = 0;
+    count = 0;
+}
+
+void TimerWheel::schedule(TimerNode* n, TimerHandler* h, void* owner, uint32_t when)
+{
+    if ( n->armed() )
+        cancel(n);
+
+    n->handler = h;
+    n->owner = owner;
+    n->expires = n->deadline = when;
+
+    insert(n);
+    ++count;
+}
+
+void TimerWheel::cancel(TimerNode* n)
+{
+    if ( !n->armed() )
+        return;
+
+    unlink(n);
+    --count;
+}
+
+unsigned TimerWheel::advance(uint32_t now, unsigned max_work)
+{
+    if ( now < cur )
+        return 0;
+
+    if ( !count )
+    {
+        cur = now + 1;
+        return 0;
+    }
+
+    if ( now - cur > l0_size * ln_size )
+        rebase(now);
+
+    unsigned work = 0;
+    unsigned fired = 0;
+
+    while ( cur <= now )
+    {
+        TimerNode* head = l0 + (cur & (l0_size - 1));
+
+        while ( head->next != head )
+        {
+            if ( work++ >= max_work )
+                return fired;
+
+            TimerNode* n = head->next;
+            unlink(n);
+
+            if ( n->deadline > now )
+            {
+                n->expires = n->deadline;
+                insert(n);
+                continue;
+            }
+
+            --count;
+            ++fired;
+
+            // may schedule or cancel any node
+            n->handler->expire(n, now);
+        }
+
+        if ( !count )
+        {
+            cur = now + 1;
+            break;
+        }
+
+        if ( ++cur & (l0_size - 1) )
+            continue;
+
+        unsigned shift = l0_bits;
+
+        for ( unsigned lvl = 0; lvl < num_upper; ++lvl )
+        {
+            unsigned idx = (cur >> shift) & (ln_size - 1);
+            cascade(ln[lvl], idx);
+
+            if ( idx )
+                break;
+
+            shift += ln_bits;
+        }
+    }
+
+    return fired;
+}
+
+void TimerWheel::clear()
+{
+    auto drop = [](TimerNode* head)
+    {
+        TimerNode* n = splice(head);
+
+        while ( n )
+        {
+            TimerNode* next = n->next;
+            n->next = n->prev = nullptr;
+            n = next;
+        }
+    };
+
+    for ( unsigned i = 0; i < l0_size; ++i )
+        drop(l0 + i);
+
+    for ( unsigned lvl = 0; lvl < num_upper; ++lvl )
+        for ( unsigned i = 0; i < ln_size; ++i )
+            drop(ln[lvl] + i);
+
+    count = 0;
+}
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+class TestHandler : public TimerHandler
+{
+public:
+    void expire(TimerNode* n, uint32_t now) override
+    {
+        fired.push_back((uintptr_t)n->owner);
+        times.push_back(now);
+    }
+
+    std::vector<uintptr_t> fired;
+    std::vector<uint32_t> times;
+};
+
+TEST_CASE("near and far", "[TimerWheel]")
+{
+    TimerWheel tw;
+    TestHandler th;
+    TimerNode n[4] = { };
+
+    tw.advance(1000, 100);
+    tw.schedule(n + 0, &th, (void*)0, 1005);
+    tw.schedule(n + 1, &th, (void*)1, 1000 + 300);
+    tw.schedule(n + 2, &th, (void*)2, 1000 + 20000);
+    tw.schedule(n + 3, &th, (void*)3, 1000 + 2000000);
+    CHECK(tw.get_count() == 4);
+
+    CHECK(tw.advance(1004, 100) == 0);
+    CHECK(tw.advance(1005, 100) == 1);
+    CHECK(!n[0].armed());
+
+    // walk a tick at a time through the cascades
+    for ( uint32_t t = 1006; t < 1000 + 20000; ++t )
+        CHECK(tw.advance(t, 100) == (t == 1300 ? 1 : 0));
+
+    CHECK(tw.advance(1000 + 20000, 100) == 1);
+    CHECK(tw.advance(1000 + 2000000, 100) == 1);
+
+    REQUIRE(th.fired.size() == 4);
+    CHECK(th.fired[0] == 0);
+    CHECK(th.fired[1] == 1);
+    CHECK(th.fired[2] == 2);
+    CHECK(th.fired[3] == 3);
+    CHECK(th.times[3] == 1000 + 2000000);
+    CHECK(tw.get_count() == 0);
+}
+
+TEST_CASE("cancel and extend", "[TimerWheel]")
+{
+    TimerWheel tw;
+    TestHandler th;
+    TimerNode n[3] = { };
+
+    tw.advance(50, 10);
+    tw.schedule(n + 0, &th, (void*)0, 60);
+    tw.schedule(n + 1, &th, (void*)1, 60);
+    tw.schedule(n + 2, &th, (void*)2, 60);
+
+    tw.cancel(n + 1);
+    CHECK(!n[1].armed());
+    TimerWheel::extend(n + 2, 400);
+
+    CHECK(tw.advance(60, 10) == 1);
+    CHECK(n[2].armed());
+    CHECK(tw.advance(399, 10) == 0);
+    CHECK(tw.advance(400, 10) == 1);
+
+    REQUIRE(th.fired.size() == 2);
+    CHECK(th.fired[0] == 0);
+    CHECK(th.fired[1] == 2);
+}
+
+TEST_CASE("budget and gaps", "[TimerWheel]")
+{
+    TimerWheel tw;
+    TestHandler th;
+    TimerNode n[10] = { };
+
+    // the first advance may be far from zero
+    for ( uintptr_t i = 0; i < 10; ++i )
+        tw.schedule(n + i, &th, (void*)i, 1000000 + i);
+
+    CHECK(tw.advance(5, 3) == 0);
+    CHECK(tw.advance(2000000, 3) == 3);
+    CHECK(tw.advance(2000000, 3) == 3);
+    CHECK(tw.advance(2000000, 100) == 4);
+    CHECK(tw.get_count() == 0);
+
+    // past times expire next
+    tw.schedule(n, &th, (void*)0, 10);
+    CHECK(tw.advance(2000001, 1) == 1);
+
+    tw.schedule(n, &th, (void*)0, 2000100);
+    tw.clear();
+    CHECK(!n[0].armed());
+    CHECK(tw.advance(2000100, 1) == 0);
+}
+#endif
+
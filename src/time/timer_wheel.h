@@ -0,0 +1,117 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+// TimerWheel is a hierarchical timing wheel with one second ticks.  There
+// is one per packet thread; it is not thread safe.
+//
+// The first level has a slot for each of the next 256 seconds and each
+// higher level has 64 slots, each covering a whole lap of the level below.
+// Timers further out than the top level are clamped to it.  When the
+// first level wraps, the next slot of the level above is cascaded down.
+// Scheduling and canceling are O(1) and each timer is cascaded at most
+// once per level.
+//
+// Nodes are intrusive so owners embed a TimerNode and the wheel never
+// allocates.  A zeroed node is not armed.  extend() moves the deadline
+// out without relinking; the node is relinked when its slot comes due.
+// Owners that track activity themselves may instead check it when
+// expire() is called and schedule again.
+
+#include <cstdint>
+
+struct TimerNode;
+
+class TimerHandler
+{
+public:
+    virtual ~TimerHandler() { }
+
+    // the node is no longer armed when this is called and may be
+    // scheduled again
+    virtual void expire(TimerNode*, uint32_t now) = 0;
+};
+
+struct TimerNode
+{
+    TimerNode* next;
+    TimerNode* prev;
+
+    TimerHandler* handler;
+    void* owner;
+
+    uint32_t expires;   // time of the slot the node is in
+    uint32_t deadline;  // expire() is called at or after this time
+
+    bool armed() const
+    { return next != nullptr; }
+};
+
+class TimerWheel
+{
+public:
+    TimerWheel();
+
+    // arms or rearms the node to expire at the given time; times already
+    // past expire on the next advance
+    void schedule(TimerNode*, TimerHandler*, void* owner, uint32_t when);
+
+    // disarms the node if armed
+    void cancel(TimerNode*);
+
+    // postpones an armed node; the deadline can only move out
+    static void extend(TimerNode* n, uint32_t when)
+    {
+        if ( when > n->deadline )
+            n->deadline = when;
+    }
+
+    // expires nodes due at or before now.  at most max_work nodes are
+    // expired or relinked per call; the rest are handled next call.
+    // returns the number of nodes expired.
+    unsigned advance(uint32_t now, unsigned max_work);
+
+    // disarms all nodes without expiring them
+    void clear();
+
+    unsigned get_count() const
+    { return count; }
+
+private:
+    void insert(TimerNode*);
+    void cascade(TimerNode* slots, unsigned idx);
+    void rebase(uint32_t now);
+
+private:
+    static const unsigned l0_bits = 8;
+    static const unsigned ln_bits = 6;
+    static const unsigned l0_size = 1 << l0_bits;
+    static const unsigned ln_size = 1 << ln_bits;
+    static const unsigned num_upper = 3;
+
+    TimerNode l0[l0_size];
+    TimerNode ln[num_upper][ln_size];
+
+    uint32_t cur;  // next tick to process
+    unsigned count;
+};
+
+#endif
+
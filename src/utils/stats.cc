@@ -183,6 +183,9 @@ const PegInfo daq_names[] =
     { "internal whitelist", "packets whitelisted internally due to lack of DAQ support" },
     { "skipped", "packets skipped at startup" },
     { "idle", "attempts to acquire from DAQ without available packets" },
+    { "batches", "packet batches processed" },
+    { "batched", "packets processed from batches" },
+    { "pool misses", "pseudo packets allocated when the packet pool was empty" },
     { nullptr, nullptr }
 };
 
@@ -198,6 +201,7 @@ const PegInfo pc_names[] =
     { "header searches", "fast pattern searches in header buffer" },
     { "body searches", "fast pattern searches in body buffer" },
     { "file searches", "fast pattern searches in file buffer" },
+    { "batch searches", "fast pattern searches of all buffers in a packet at once" },
     { "alerts", "alerts not including IP reputation" },
     { "total alerts", "alerts including IP reputation" },
     { "logged", "logged packets" },
@@ -276,6 +280,9 @@ void get_daq_stats(DAQStats& daq_stats)
     daq_stats.internal_whitelist = gaux.internal_whitelist;
     daq_stats.skipped = snort_conf->pkt_skip;
     daq_stats.idle = gaux.idle;
+    daq_stats.batches = gaux.batches;
+    daq_stats.batched = gaux.batched;
+    daq_stats.pool_misses = gaux.pool_misses;
 }
 
 void DropStats()
@@ -50,6 +50,7 @@ struct PacketCount
     PegCount header_searches;
     PegCount body_searches;
     PegCount file_searches;
+    PegCount batch_searches;
     PegCount alert_pkts;
     PegCount total_alert_pkts;
     PegCount log_pkts;
@@ -76,6 +77,9 @@ struct AuxCount
     PegCount internal_blacklist;
     PegCount internal_whitelist;
     PegCount idle;
+    PegCount batches;
+    PegCount batched;
+    PegCount pool_misses;
 };
 
 //-------------------------------------------------------------------------
@@ -100,6 +104,9 @@ struct DAQStats
     PegCount internal_whitelist;
     PegCount skipped;
     PegCount idle;
+    PegCount batches;
+    PegCount batched;
+    PegCount pool_misses;
 };
 
 extern ProcessCount proc_stats;